@@ -0,0 +1,359 @@
+#include <algorithm>
+#include <set>
+#include "analysis.hpp"
+
+namespace {
+const int I_UNVISITED = -2; // block not reached by the value propagation yet
+const int I_UNKNOWN = -1;
+
+/**
+ * \brief Rom in memory with helpers for walking its code.
+ */
+struct Walker {
+  const unsigned char *rom = nullptr;
+  std::size_t size = 0;
+  const Chip8::AnalysisOptions &options;
+  std::vector<bool> code = std::vector<bool>(Chip8::MEMORY_SIZE, false); // instruction starts at address
+  std::set<unsigned int> leaders{}; // addresses where blocks must start
+
+  [[nodiscard]] Chip8::Mode mode() const {
+	return Chip8::mode_of(options.schip, options.xo_chip);
+  }
+
+  [[nodiscard]] bool in_rom(unsigned int address) const {
+	return address >= Chip8::PC_INIT && address + 1 < Chip8::PC_INIT + size && address + 1 < Chip8::MEMORY_SIZE;
+  }
+
+  [[nodiscard]] unsigned short opcode(unsigned int address) const {
+	std::size_t offset = address - Chip8::PC_INIT;
+	return static_cast<unsigned short>((rom[offset] << 8u) | rom[offset + 1]);
+  }
+
+  [[nodiscard]] bool is_write(Chip8::InstructionId id) const {
+	return id == Chip8::ID_Fx33 || id == Chip8::ID_Fx55 || id == Chip8::ID_5xy2;
+  }
+
+  /**
+   * \brief Address executed when skip instruction at given address skips, XO-CHIP skips F000 nnnn as a whole.
+   */
+  [[nodiscard]] unsigned int skip_target(unsigned int address) const {
+	if (options.xo_chip && in_rom(address + 2) && opcode(address + 2) == 0xF000)
+	  return address + 6;
+	return address + 4;
+  }
+
+  /**
+   * \brief Instruction after which block ends, because it changes control flow or (optionally) writes memory.
+   */
+  [[nodiscard]] bool ends_block(Chip8::InstructionId id) const {
+	switch (id) {
+	case Chip8::ID_00EE:
+	case Chip8::ID_00FD:
+	case Chip8::ID_1nnn:
+	case Chip8::ID_2nnn:
+	case Chip8::ID_3xkk:
+	case Chip8::ID_4xkk:
+	case Chip8::ID_5xy0:
+	case Chip8::ID_9xy0:
+	case Chip8::ID_Bnnn:
+	case Chip8::ID_Ex9E:
+	case Chip8::ID_ExA1:
+	case Chip8::ID_Fx0A:
+	case Chip8::ID_F000:
+	  return true;
+	default:
+	  return options.end_blocks_after_writes && is_write(id);
+	}
+  }
+
+  [[nodiscard]] static bool is_skip(Chip8::InstructionId id) {
+	return id == Chip8::ID_3xkk || id == Chip8::ID_4xkk || id == Chip8::ID_5xy0 || id == Chip8::ID_9xy0
+		|| id == Chip8::ID_Ex9E || id == Chip8::ID_ExA1;
+  }
+
+  void walk() {
+	std::vector<unsigned int> pending{Chip8::PC_INIT};
+	leaders.insert(Chip8::PC_INIT);
+	auto branch = [&](unsigned int target) {
+	  leaders.insert(target);
+	  pending.push_back(target);
+	};
+
+	while (!pending.empty()) {
+	  unsigned int address = pending.back();
+	  pending.pop_back();
+
+	  while (in_rom(address) && !code[address]) {
+		unsigned short op = opcode(address);
+		Chip8::InstructionId id = Chip8::Instruction::decode(op, mode());
+		if (id == Chip8::UNKNOWN)
+		  break;
+		code[address] = true;
+
+		if (id == Chip8::ID_1nnn) {
+		  branch(op & 0x0FFFu);
+		  break;
+		} else if (id == Chip8::ID_2nnn) {
+		  branch(op & 0x0FFFu);
+		  branch(address + 2);
+		  break;
+		} else if (id == Chip8::ID_00EE || id == Chip8::ID_Bnnn || id == Chip8::ID_00FD) {
+		  break;
+		} else if (id == Chip8::ID_F000) {
+		  branch(address + 4); // followed by the address, not an instruction
+		  break;
+		} else if (ends_block(id)) {
+		  branch(address + 2);
+		  if (is_skip(id))
+			branch(skip_target(address));
+		  break;
+		}
+		address += 2;
+	  }
+	}
+  }
+
+  [[nodiscard]] bool is_code(unsigned int address) const {
+	return address < Chip8::MEMORY_SIZE && code[address];
+  }
+
+  std::vector<Chip8::BasicBlock> split_blocks() {
+	std::vector<Chip8::BasicBlock> blocks;
+	std::set<unsigned int> starts(leaders.cbegin(), leaders.cend());
+
+	for (auto start = starts.cbegin(); start != starts.cend(); start++) {
+	  unsigned int address = *start;
+	  if (!is_code(address))
+		continue;
+
+	  Chip8::BasicBlock block{static_cast<unsigned short>(address), 0, {}};
+	  Chip8::InstructionId id;
+	  while (true) {
+		unsigned short op = opcode(address);
+		id = Chip8::Instruction::decode(op, mode());
+		block.length++;
+		address += 2;
+
+		if (id == Chip8::ID_2nnn)
+		  block.call = op & 0x0FFF;
+		if (ends_block(id) || !is_code(address) || leaders.count(address))
+		  break;
+		if (block.length == options.max_block_length) {
+		  // rest of the straight-line code continues in the next block
+		  leaders.insert(address);
+		  starts.insert(address);
+		  break;
+		}
+	  }
+
+	  unsigned int last = address - 2;
+	  unsigned short op = opcode(last);
+	  if (id == Chip8::ID_1nnn)
+		block.successors.push_back(op & 0x0FFF);
+	  else if (id == Chip8::ID_00EE)
+		block.returns = true;
+	  else if (id == Chip8::ID_Bnnn)
+		block.computed_jump = true;
+	  else if (id == Chip8::ID_F000)
+		block.successors.push_back(static_cast<unsigned short>(address + 2));
+	  else if (id != Chip8::ID_00FD) // exit has no successor
+		block.successors.push_back(static_cast<unsigned short>(address));
+	  if (is_skip(id))
+		block.successors.push_back(static_cast<unsigned short>(skip_target(last)));
+
+	  block.successors.erase(std::remove_if(block.successors.begin(), block.successors.end(), [&](unsigned short a) {
+		return !is_code(a);
+	  }), block.successors.end());
+	  blocks.push_back(block);
+	}
+	return blocks;
+  }
+};
+
+int meet(int a, int b) {
+  if (a == I_UNVISITED)
+	return b;
+  return a == b ? a : I_UNKNOWN;
+}
+
+/**
+ * \brief Value of I after executing instruction.
+ */
+int transfer(int index, unsigned short opcode, Chip8::InstructionId id, const Chip8::AnalysisOptions &options) {
+  switch (id) {
+  case Chip8::ID_Annn:
+	return opcode & 0x0FFF;
+  case Chip8::ID_Fx1E:
+  case Chip8::ID_Fx29:
+  case Chip8::ID_F000: // may point above MEMORY_SIZE
+	return I_UNKNOWN;
+  case Chip8::ID_Fx55:
+  case Chip8::ID_Fx65:
+	if (options.load_store_quirk || index < 0)
+	  return index;
+	return index + ((opcode & 0x0F00) >> 8) + 1;
+  default:
+	return index;
+  }
+}
+
+/**
+ * \brief Finds value of I at the start of each block, I_UNKNOWN if it depends on the path.
+ */
+std::vector<int> propagate_index(const std::vector<Chip8::BasicBlock> &blocks, const Walker &walker,
+								 const std::map<unsigned short, std::size_t> &block_index) {
+  std::vector<int> entry(blocks.size(), I_UNVISITED);
+  std::vector<std::size_t> pending;
+  auto flow = [&](unsigned short target, int index) {
+	auto found = block_index.find(target);
+	if (found == block_index.end())
+	  return;
+	int merged = meet(entry[found->second], index);
+	if (merged != entry[found->second]) {
+	  entry[found->second] = merged;
+	  pending.push_back(found->second);
+	}
+  };
+
+  flow(Chip8::PC_INIT, 0); // cpu starts with I = 0
+  while (!pending.empty()) {
+	std::size_t i = pending.back();
+	pending.pop_back();
+
+	const Chip8::BasicBlock &block = blocks[i];
+	int index = entry[i];
+	for (unsigned int address = block.start; address < block.end(); address += 2) {
+	  unsigned short opcode = walker.opcode(address);
+	  index = transfer(index, opcode, Chip8::Instruction::decode(opcode, walker.mode()), walker.options);
+	}
+
+	if (block.call >= 0) {
+	  flow(static_cast<unsigned short>(block.call), index);
+	  // subroutine may change I before returning
+	  for (auto successor : block.successors)
+		flow(successor, I_UNKNOWN);
+	} else {
+	  for (auto successor : block.successors)
+		flow(successor, index);
+	}
+  }
+  return entry;
+}
+
+std::vector<Chip8::DataRegion> merge_regions(std::vector<std::pair<unsigned int, unsigned int>> ranges) {
+  std::sort(ranges.begin(), ranges.end());
+  std::vector<Chip8::DataRegion> regions;
+  for (const auto &range : ranges) {
+	if (!regions.empty() && range.first <= regions.back().start + regions.back().size) {
+	  unsigned int end = std::max<unsigned int>(regions.back().start + regions.back().size, range.second);
+	  regions.back().size = static_cast<unsigned short>(end - regions.back().start);
+	} else {
+	  regions.push_back(Chip8::DataRegion{static_cast<unsigned short>(range.first),
+										  static_cast<unsigned short>(range.second - range.first)});
+	}
+  }
+  return regions;
+}
+}
+
+bool Chip8::RomAnalysis::is_code(unsigned int address) const {
+  auto found = std::lower_bound(instructions.cbegin(), instructions.cend(), address,
+								[](const AnalyzedInstruction &i, unsigned int a) { return i.address < a; });
+  return found != instructions.cend() && found->address == address;
+}
+
+const Chip8::BasicBlock *Chip8::RomAnalysis::block_containing(unsigned int address) const {
+  for (const auto &block : blocks) {
+	if (address >= block.start && address < block.end() && (address - block.start) % 2 == 0)
+	  return &block;
+  }
+  return nullptr;
+}
+
+Chip8::RomAnalysis Chip8::analyze(const unsigned char *rom, std::size_t size, const AnalysisOptions &options) {
+  if (size >= MEMORY_SIZE - PC_INIT)
+	throw std::runtime_error("rom size is too large");
+
+  Walker walker{rom, size, options};
+  walker.walk();
+
+  RomAnalysis analysis;
+  analysis.blocks = walker.split_blocks();
+  for (unsigned int address = PC_INIT; address < MEMORY_SIZE; address++) {
+	if (walker.code[address]) {
+	  unsigned short opcode = walker.opcode(address);
+	  analysis.instructions.push_back(AnalyzedInstruction{static_cast<unsigned short>(address), opcode,
+														  Instruction::decode(opcode, walker.mode())});
+	}
+  }
+
+  std::map<unsigned short, std::size_t> block_index;
+  for (std::size_t i = 0; i < analysis.blocks.size(); i++)
+	block_index[analysis.blocks[i].start] = i;
+
+  // subroutine consists of blocks reachable from its entry without entering called subroutines
+  std::set<unsigned short> entries{PC_INIT};
+  for (const auto &block : analysis.blocks) {
+	if (block.call >= 0)
+	  entries.insert(static_cast<unsigned short>(block.call));
+  }
+  for (auto entry : entries) {
+	std::set<unsigned short> callees;
+	std::set<unsigned short> visited;
+	std::vector<unsigned short> pending{entry};
+	while (!pending.empty()) {
+	  unsigned short start = pending.back();
+	  pending.pop_back();
+	  auto found = block_index.find(start);
+	  if (found == block_index.end() || !visited.insert(start).second)
+		continue;
+
+	  const BasicBlock &block = analysis.blocks[found->second];
+	  if (block.call >= 0)
+		callees.insert(static_cast<unsigned short>(block.call));
+	  pending.insert(pending.end(), block.successors.cbegin(), block.successors.cend());
+	}
+	analysis.call_graph[entry] = std::vector<unsigned short>(callees.cbegin(), callees.cend());
+  }
+
+  // with I known at each block's start, sprites and write targets are found in a single pass
+  std::vector<int> entry_index = propagate_index(analysis.blocks, walker, block_index);
+  std::vector<std::pair<unsigned int, unsigned int>> sprites;
+  auto overlaps_code = [&](unsigned int first, unsigned int last) {
+	for (unsigned int address = first == 0 ? 0 : first - 1; address <= last && address < MEMORY_SIZE; address++) {
+	  if (walker.code[address])
+		return true;
+	}
+	return false;
+  };
+
+  for (std::size_t i = 0; i < analysis.blocks.size(); i++) {
+	const BasicBlock &block = analysis.blocks[i];
+	int index = entry_index[i];
+	for (unsigned int address = block.start; address < block.end(); address += 2) {
+	  unsigned short opcode = walker.opcode(address);
+	  InstructionId id = Instruction::decode(opcode, walker.mode());
+
+	  // Dxy0 draws 16x16 sprite, on the original CHIP-8 nothing
+	  bool draws = (opcode & 0x000Fu) != 0 || walker.mode() != Mode::CHIP8;
+	  if (id == ID_Dxyn && draws && index >= static_cast<int>(PC_INIT)) {
+		unsigned int bytes = (opcode & 0x000Fu) ? opcode & 0x000Fu : 32;
+		unsigned int end = std::min<unsigned int>(index + bytes, MEMORY_SIZE);
+		sprites.emplace_back(index, end);
+	  } else if (walker.is_write(id)) {
+		unsigned int x = (opcode & 0x0F00u) >> 8u, y = (opcode & 0x00F0u) >> 4u;
+		unsigned int count = id == ID_Fx33 ? 3 : id == ID_5xy2 ? (x < y ? y - x : x - y) + 1 : x + 1;
+		if (index < 0)
+		  analysis.code_writes.push_back(CodeWrite{static_cast<unsigned short>(address), 0, 0, false});
+		else if (overlaps_code(index, index + count - 1))
+		  analysis.code_writes.push_back(CodeWrite{static_cast<unsigned short>(address),
+												   static_cast<unsigned short>(index),
+												   static_cast<unsigned short>(index + count - 1), true});
+	  }
+	  index = transfer(index, opcode, id, options);
+	}
+  }
+  analysis.sprites = merge_regions(sprites);
+
+  return analysis;
+}
@@ -0,0 +1,102 @@
+#ifndef CHIP8_EMU_CPP_ANALYSIS_HPP
+#define CHIP8_EMU_CPP_ANALYSIS_HPP
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "cpu.hpp"
+#include "instructions.hpp"
+
+namespace Chip8 {
+/**
+ * \brief Settings of rom analysis.
+ */
+struct AnalysisOptions {
+  unsigned int max_block_length = 0; //!< Maximum number of instructions in a block, 0 means unlimited.
+  bool end_blocks_after_writes = false; //!< End blocks after Fx33, Fx55 and 5xy2, so that modified code can be noticed.
+  bool load_store_quirk = false; //!< Whether Fx55 and Fx65 leave I unchanged, see CPU::load_store_quirk.
+  bool schip = false; //!< Whether SUPER-CHIP instructions are decoded, see CPU::set_schip.
+  bool xo_chip = false; //!< Whether XO-CHIP instructions are decoded and skips step over F000 nnnn as a whole.
+};
+
+/**
+ * \brief Instruction reachable from PC_INIT.
+ */
+struct AnalyzedInstruction {
+  unsigned short address; //!< Address of the instruction.
+  unsigned short opcode; //!< Opcode of the instruction.
+  InstructionId id; //!< Decoded instruction.
+};
+
+/**
+ * \brief Straight-line sequence of instructions, entered only at the first one.
+ */
+struct BasicBlock {
+  unsigned short start; //!< Address of the first instruction.
+  unsigned short length; //!< Number of instructions.
+  std::vector<unsigned short> successors; //!< Blocks executed next in the same subroutine, after a call its return address.
+  int call = -1; //!< Subroutine called by the last instruction, -1 if none.
+  bool returns = false; //!< Whether the last instruction returns from subroutine.
+  bool computed_jump = false; //!< Whether the last instruction is Bnnn, which target isn't known.
+
+  /** \brief Address right after the last instruction. */
+  [[nodiscard]] unsigned int end() const { return start + 2u * length; }
+};
+
+/**
+ * \brief Range of memory holding data.
+ */
+struct DataRegion {
+  unsigned short start; //!< First address.
+  unsigned short size; //!< Size in bytes.
+};
+
+/**
+ * \brief Instruction writing memory (Fx33, Fx55) which can modify reachable code.
+ */
+struct CodeWrite {
+  unsigned short address; //!< Address of the writing instruction.
+  unsigned short first; //!< First written address, valid only when target_known.
+  unsigned short last; //!< Last written address, valid only when target_known.
+  bool target_known; //!< Whether value of I is known, otherwise the write can go anywhere.
+};
+
+/**
+ * \brief Result of static rom analysis.
+ */
+struct RomAnalysis {
+  std::vector<AnalyzedInstruction> instructions; //!< Reachable instructions sorted by address.
+  std::vector<BasicBlock> blocks; //!< Basic blocks sorted by start address.
+  std::map<unsigned short, std::vector<unsigned short>> call_graph; //!< Subroutines called from each subroutine, PC_INIT included.
+  std::vector<DataRegion> sprites; //!< Memory drawn by Dxyn while I was known, merged into regions.
+  std::vector<CodeWrite> code_writes; //!< Writes which modify, or may modify, reachable code.
+
+  /**
+   * \brief Whether a reachable instruction starts at address.
+   */
+  [[nodiscard]] bool is_code(unsigned int address) const;
+
+  /**
+   * \brief Finds block containing instruction at address.
+   *
+   * @return block or nullptr if address isn't reachable code
+   */
+  [[nodiscard]] const BasicBlock *block_containing(unsigned int address) const;
+};
+
+/**
+ * \brief Analyzes code reachable from PC_INIT with recursive descent.
+ *
+ * Every statically known path is followed: jumps, calls, returns and both outcomes of skips. Targets of computed
+ * jumps (Bnnn) aren't known, so code reachable only through them is missing. Value of I is tracked across blocks,
+ * which finds sprites drawn by Dxyn and targets of memory writes.
+ *
+ * @param rom rom loaded at PC_INIT
+ * @param size size of the rom in bytes
+ * @param options analysis settings
+ * @return analysis of the rom
+ */
+RomAnalysis analyze(const unsigned char *rom, std::size_t size, const AnalysisOptions &options = AnalysisOptions());
+}
+
+#endif //CHIP8_EMU_CPP_ANALYSIS_HPP
@@ -1,13 +1,23 @@
+#include <algorithm>
+#include <iostream>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <thread>
 #include "chip8/cpu.hpp"
 #include "app.hpp"
 
-App::App(const AppConf &conf) {
+namespace {
+const char *const WINDOW_TITLE = "Chip8 emulator";
+}
+
+App::App(const AppConf &conf)
+	: upscaler(conf.upscale_filter, static_cast<unsigned int>(conf.screen_width),
+			   static_cast<unsigned int>(conf.screen_height)) {
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
 	throw std::runtime_error(SDL_GetError());
 
-  window = SDL_CreateWindow("Chip8 emulator", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+  window = SDL_CreateWindow(WINDOW_TITLE, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
 							conf.screen_width, conf.screen_height, SDL_WINDOW_SHOWN);
   if (!window)
 	throw std::runtime_error(SDL_GetError());
@@ -16,22 +26,32 @@ App::App(const AppConf &conf) {
   if (!renderer)
 	throw std::runtime_error(SDL_GetError());
 
-  if (SDL_RenderSetLogicalSize(renderer, Chip8::SCREEN_WIDTH, Chip8::SCREEN_HEIGHT) < 0)
+  texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+							  conf.screen_width, conf.screen_height);
+  if (!texture)
 	throw std::runtime_error(SDL_GetError());
 
   beeper.init();
 
   screen_update_period = 1.0 / conf.refresh_rate;
 
+  keymap.fill(-1);
   for (const auto &key : conf.keymap) {
 	SDL_Keycode key_code = SDL_GetKeyFromName(key.second.c_str());
 	if (key_code == SDLK_UNKNOWN)
 	  throw std::runtime_error(SDL_GetError());
-	keymap[key_code] = key.first;
+	SDL_Scancode scan_code = SDL_GetScancodeFromKey(key_code);
+	keymap[scan_code] = static_cast<signed char>(std::stoul(key.first, nullptr, 16));
   }
+
+  turbo_key = SDL_GetKeyFromName(conf.turbo_key.c_str());
+  if (turbo_key == SDLK_UNKNOWN)
+	throw std::runtime_error(SDL_GetError());
+  turbo_speed = conf.turbo_speed;
 }
 
 App::~App() {
+  SDL_DestroyTexture(texture);
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
@@ -39,60 +59,150 @@ App::~App() {
 
 void App::run() {
   running = true;
-  auto start = std::chrono::high_resolution_clock::now();
+  auto start = Emulator::Clock::now();
+  auto screen_update = std::chrono::duration_cast<Emulator::Clock::duration>(
+	  std::chrono::duration<double>(screen_update_period));
+  auto last_present = start - screen_update;
 
   while (running) {
 	process_input();
 
-	SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
-	SDL_RenderClear(renderer);
-
-	SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-	auto display = chip8_emu.cpu.get_display();
-	std::vector<SDL_Point> points_to_draw;
-
-	for (unsigned int y = 0; y < Chip8::SCREEN_HEIGHT; y++) {
-	  for (unsigned int x = 0; x < Chip8::SCREEN_WIDTH; x++) {
-		if (display[y * Chip8::SCREEN_WIDTH + x]) {
-		  points_to_draw.push_back(SDL_Point{static_cast<int>(x), static_cast<int>(y)});
-		}
-	  }
+	bool present = !turbo || start - last_present >= screen_update;
+	if (present) {
+	  void *pixels;
+	  int pitch;
+	  if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) < 0)
+		throw std::runtime_error(SDL_GetError());
+	  upscaler.render(chip8_emu.cpu, static_cast<std::uint32_t *>(pixels), static_cast<std::size_t>(pitch));
+	  SDL_UnlockTexture(texture);
+	  if (SDL_RenderCopy(renderer, texture, nullptr, nullptr) < 0)
+		throw std::runtime_error(SDL_GetError());
 	}
 
-	SDL_RenderDrawPoints(renderer, points_to_draw.data(), static_cast<int>(points_to_draw.size()));
-
-	auto end = std::chrono::high_resolution_clock::now();
+	auto end = Emulator::Clock::now();
 	std::chrono::duration<double> delta = end - start;
-	start = std::chrono::high_resolution_clock::now();
-	chip8_emu.run(delta);
-
-	if (chip8_emu.sound_on())
+	start = end;
+	if (turbo)
+	  delta = std::chrono::duration<double>(screen_update_period); // one frame, speed is kept by sleeping less
+	chip8_emu.run(delta, end);
+	if (chip8_emu.cpu.exited())
+	  running = false; // SCHIP program quit with 00FD
+	if (recorder)
+	  recorder->update(chip8_emu);
+	if (exporter)
+	  exporter->publish(chip8_emu.cpu, chip8_emu.sound_on());
+
+	if (chip8_emu.cpu.audio_pattern_loaded())
+	  beeper.set_pattern(chip8_emu.cpu.audio_pattern(), chip8_emu.cpu.audio_pitch());
+	if (chip8_emu.sound_on() && !turbo)
 	  beeper.play();
 	else
 	  beeper.stop();
 
-	SDL_RenderPresent(renderer);
+	if (present) {
+	  SDL_RenderPresent(renderer);
+	  last_present = end;
+	}
 
-	std::this_thread::sleep_for(std::chrono::duration<double>(screen_update_period));
+	if (turbo) {
+	  turbo_emulated += screen_update_period;
+	  update_turbo_speed(end);
+	  if (turbo_speed > 0)
+		std::this_thread::sleep_until(turbo_start + std::chrono::duration_cast<Emulator::Clock::duration>(
+			std::chrono::duration<double>(turbo_emulated / turbo_speed)));
+	} else {
+	  std::this_thread::sleep_for(std::chrono::duration<double>(screen_update_period));
+	}
   }
 
+  if (recorder)
+	recorder->finish(chip8_emu);
+  if (frame_recorder)
+	frame_recorder->finish();
 }
 void App::process_input() {
+  // SDL timestamps events in milliseconds since initialization, translate them to emulator's clock
+  auto now = Emulator::Clock::now();
+  Uint32 ticks = SDL_GetTicks();
+
   while (SDL_PollEvent(&e) != 0) {
 	if (e.type == SDL_QUIT)
 	  running = false;
-	else if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) {
-	  try {
-		std::string changed_key = keymap.at(e.key.keysym.sym);
-		bool key_value = e.type == SDL_KEYDOWN;
-		chip8_emu.set_key(changed_key, key_value);
-	  } catch (std::out_of_range &) {
-		// dont do anything
+	else if (e.type == SDL_KEYDOWN && !e.key.repeat && e.key.keysym.sym == turbo_key)
+	  toggle_turbo();
+	else if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) && !e.key.repeat) {
+	  signed char changed_key = keymap[e.key.keysym.scancode];
+	  if (changed_key >= 0) {
+		auto timestamp = now - std::chrono::milliseconds(ticks - std::min(ticks, e.key.timestamp));
+		chip8_emu.push_key(static_cast<unsigned int>(changed_key), e.type == SDL_KEYDOWN, timestamp);
 	  }
 	}
   }
 }
 
 void App::init_emulation(const RomConf &config) {
+  rom_config = config;
   chip8_emu.load_config(config);
 }
+
+void App::restore_snapshot(const std::string &path) {
+  chip8_emu.restore(Snapshot::load(path));
+}
+
+void App::record_movie(const std::string &path, const std::filesystem::path &resources_path) {
+  recorder = std::make_unique<MovieRecorder>(path, rom_config, chip8_emu.random_seed(), resources_path);
+}
+
+void App::export_frames(const std::string &name) {
+  exporter = std::make_unique<FrameExporter>(name);
+}
+
+void App::capture_frames(const std::string &path) {
+  frame_recorder = std::make_unique<FrameRecorder>(path);
+  chip8_emu.capture_frames(frame_recorder.get());
+}
+
+void App::enable_trace(std::size_t capacity) {
+  chip8_emu.enable_trace(capacity);
+}
+
+void App::enable_turbo(double speed) {
+  turbo_speed = speed;
+  if (!turbo)
+	toggle_turbo();
+}
+
+void App::toggle_turbo() {
+  turbo = !turbo;
+  if (turbo) {
+	turbo_start = Emulator::Clock::now();
+	turbo_emulated = 0;
+	turbo_total_real = 0;
+	turbo_total_emulated = 0;
+  } else {
+	std::chrono::duration<double> real = Emulator::Clock::now() - turbo_start;
+	turbo_total_real += real.count();
+	turbo_total_emulated += turbo_emulated;
+	if (turbo_total_real > 0)
+	  std::cout << "turbo: " << turbo_total_emulated / turbo_total_real << "x real time over "
+				<< turbo_total_real << " s" << std::endl;
+	SDL_SetWindowTitle(window, WINDOW_TITLE);
+  }
+}
+
+void App::update_turbo_speed(Emulator::Clock::time_point now) {
+  // speed is measured over roughly a second, which also bounds how much the pacing can catch up
+  std::chrono::duration<double> real = now - turbo_start;
+  if (real.count() < 1.0)
+	return;
+
+  std::ostringstream title;
+  title.precision(3);
+  title << WINDOW_TITLE << " - turbo " << turbo_emulated / real.count() << "x";
+  SDL_SetWindowTitle(window, title.str().c_str());
+
+  turbo_total_real += real.count();
+  turbo_total_emulated += turbo_emulated;
+  turbo_start = now;
+  turbo_emulated = 0;
+}
@@ -1,12 +1,16 @@
 #ifndef CHIP8_EMU_CPP_APP_HPP
 #define CHIP8_EMU_CPP_APP_HPP
 
+#include <array>
+#include <memory>
 #include <string>
-#include <map>
 #include <SDL2/SDL.h>
 #include "emulator.hpp"
 #include "conf.hpp"
 #include "beeper.hpp"
+#include "movie.hpp"
+#include "frame_export.hpp"
+#include "upscaler.hpp"
 
 /**
  * \brief  Represents whole emulator applications.
@@ -16,23 +20,40 @@
 class App {
   SDL_Window *window = nullptr;
   SDL_Renderer *renderer = nullptr;
+  SDL_Texture *texture = nullptr; // streaming texture of window size the upscaler draws into
   SDL_Event e{};
 
   Emulator chip8_emu;
+  RomConf rom_config;
+  std::unique_ptr<MovieRecorder> recorder; // set when session is recorded
+  std::unique_ptr<FrameExporter> exporter; // set when frames are exported to shared memory
+  std::unique_ptr<FrameRecorder> frame_recorder; // set when every emulated frame is recorded
   Beeper beeper;
+  Upscaler upscaler;
   double screen_update_period;
-  std::map<SDL_Keycode, std::string> keymap; // maps from pressed key to cpu key name
+  std::array<signed char, SDL_NUM_SCANCODES> keymap{}; // maps from pressed key scancode to cpu key, -1 if unmapped
+
+  SDL_Keycode turbo_key;
+  double turbo_speed; // multiple of real time, 0 is uncapped
+  bool turbo = false;
+  Emulator::Clock::time_point turbo_start; // start of the current speed measurement
+  double turbo_emulated = 0; // emulated seconds since turbo_start
+  double turbo_total_real = 0; // seconds spent in turbo since it was turned on
+  double turbo_total_emulated = 0;
 
   bool running = false;
 
   void process_input();
+  void toggle_turbo();
+  void update_turbo_speed(Emulator::Clock::time_point now);
 
 public:
   /**
    * \brief Creates app from configuration.
    *
-   * Initializes SDL2 with video and audio, creates window and renderer, initializes Beeper, sets screen update period
-   * from refresh rate and creates keymap from SDL2 key to cpu key. Throws runtime error when any of the SDL2 function
+   * Initializes SDL2 with video and audio, creates window, renderer and streaming texture of window size, initializes
+   * Beeper, sets screen update period
+   * from refresh rate and creates keymap from SDL2 scancode to cpu key. Throws runtime error when any of the SDL2 function
    * return error.
    *
    * \warning Constructor doesn't initialize emulation. In order for emulation to work correctly init_emulation
@@ -52,14 +73,67 @@ public:
    */
   void init_emulation(const RomConf &config);
 
+  /**
+   * \brief Continues emulation from warm start snapshot instead of booting the rom.
+   *
+   * Must be called after init_emulation, see Emulator::restore.
+   *
+   * @param path snapshot file
+   */
+  void restore_snapshot(const std::string &path);
+
+  /**
+   * \brief Records the session into a movie.
+   *
+   * Must be called after init_emulation. Movie is saved when main loop ends.
+   *
+   * @param path file to which movie is saved
+   * @param resources_path resources directory containing the rom
+   */
+  void record_movie(const std::string &path, const std::filesystem::path &resources_path);
+
+  /**
+   * \brief Publishes every frame into POSIX shared memory segment, see FrameReader.
+   *
+   * @param name name of the segment e.g. "/chip8"
+   */
+  void export_frames(const std::string &name);
+
+  /**
+   * \brief Records every emulated frame into a file, see FrameRecorder.
+   *
+   * @param path recording file
+   */
+  void capture_frames(const std::string &path);
+
+  /**
+   * \brief Remembers last executed instructions, which are printed when emulation fails.
+   *
+   * @param capacity number of remembered instructions
+   */
+  void enable_trace(std::size_t capacity);
+
+  /**
+   * \brief Starts in turbo mode with given speed instead of the configured one.
+   *
+   * In turbo mode every loop iteration emulates one frame, as fast as speed allows. Screen is updated only once per
+   * screen update period, so just every Nth frame is shown, sound is muted and achieved speed is shown in the window
+   * title. Turbo key toggles the mode.
+   *
+   * @param speed multiple of real time, 0 is uncapped
+   */
+  void enable_turbo(double speed);
+
   /**
    * \brief Runs main loop of the application.
    *
    * Main loop consists of a few stages:
    * 1. Read input.
-   * 2. Process input - either quit the application or set key in emulator.
-   * 3. Draw to the screen.
-   * 4. Run emulation cycle.
+   * 2. Process input - either quit the application, toggle turbo mode or queue timestamped key transition in emulator.
+   * 3. Upscale display into the texture and draw it to the screen, in turbo mode once per screen update period.
+   * 4. Run emulation cycle, one frame long in turbo mode.
+   * 5. Record and export the frame if enabled.
+   * 6. Sleep for screen update period, in turbo mode only as long as needed to keep the speed.
    * Main loop will run until SDL_Quit event is emitted.
    */
   void run();
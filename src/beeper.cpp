@@ -14,12 +14,34 @@ Beeper::~Beeper() {
 }
 
 void Beeper::generate_samples(Sint16 *stream, int len) {
+  if (has_pattern) {
+	for (int i = 0; i < len; i++) {
+	  auto bit = static_cast<unsigned int>(pattern_position);
+	  bool high = (pattern[bit / 8] >> (7u - bit % 8)) & 1u;
+	  stream[i] = static_cast<Sint16>(high ? AMPLITUDE : -AMPLITUDE);
+	  pattern_position = std::fmod(pattern_position + pattern_rate / SAMPLE_RATE, PATTERN_BITS);
+	}
+	return;
+  }
+
   for (int i = 0; i < len; i++, sample++) {
 	double time = (double)sample / (double)SAMPLE_RATE;
 	stream[i] = (Sint16)(AMPLITUDE * sin(2.0f * M_PI * 441.0f * time)); // render 441 HZ sine wave
   }
 }
 
+void Beeper::set_pattern(const std::array<unsigned char, PATTERN_BITS / 8> &bits, unsigned char pitch) {
+  double rate = 4000.0 * std::pow(2.0, (pitch - 64) / 48.0);
+  if (has_pattern && bits == pattern && rate == pattern_rate)
+	return;
+
+  SDL_LockAudioDevice(dev);
+  pattern = bits;
+  pattern_rate = rate;
+  has_pattern = true;
+  SDL_UnlockAudioDevice(dev);
+}
+
 void Beeper::init() {
   desired.freq = 44100;
   desired.format = AUDIO_S16SYS;
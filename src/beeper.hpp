@@ -1,10 +1,12 @@
 #ifndef CHIP8_EMU_CPP_BEEPER_HPP
 #define CHIP8_EMU_CPP_BEEPER_HPP
 
+#include <array>
 #include <SDL_audio.h>
 
 const int AMPLITUDE = 28000;
 const int SAMPLE_RATE = 44100;
+const int PATTERN_BITS = 128; // XO-CHIP audio pattern length
 
 void audio_callback(void *userdata, Uint8 *stream, int len);
 
@@ -17,6 +19,10 @@ class Beeper {
   SDL_AudioDeviceID dev{};
   int sample = 0;
   bool playing = false;
+  std::array<unsigned char, PATTERN_BITS / 8> pattern{}; // XO-CHIP pattern, accessed under audio device lock
+  bool has_pattern = false; // plays sine wave until pattern is set
+  double pattern_rate = 4000; // pattern bits per second
+  double pattern_position = 0; // in bits
 
 public:
   /**
@@ -28,6 +34,15 @@ public:
    * @param len length of stream to fill
    */
   void generate_samples(Sint16 *stream, int len);
+  /**
+   * \brief Plays XO-CHIP audio pattern instead of sine wave.
+   *
+   * Pattern is looped, each bit is either high or low output.
+   *
+   * @param bits 16-byte pattern played from the most significant bit of the first byte
+   * @param pitch XO-CHIP pitch, pattern is played at 4000 * 2 ^ ((pitch - 64) / 48) bits per second
+   */
+  void set_pattern(const std::array<unsigned char, PATTERN_BITS / 8> &bits, unsigned char pitch);
   /**
    * \brief Initializes audio device and spec.
    */
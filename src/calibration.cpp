@@ -0,0 +1,114 @@
+#include <cmath>
+#include <stdexcept>
+#include "calibration.hpp"
+#include "emulator.hpp"
+#include "instructions.hpp"
+#include "movie.hpp"
+
+namespace {
+const std::uint64_t SPIN_WINDOW = 16; // max cycles between Fx07 reads of one polling loop
+}
+
+double SpeedProfile::idle_fraction() const {
+  if (cycles == 0)
+	return 0;
+  return static_cast<double>(timer_wait_cycles + key_wait_cycles) / static_cast<double>(cycles);
+}
+
+double SpeedProfile::settled_fraction() const {
+  if (frames == 0)
+	return 0;
+  return static_cast<double>(settled.size()) / static_cast<double>(frames);
+}
+
+SpeedProfile profile_speed(const RomConf &rom, unsigned int speed, const CalibrationConf &conf) {
+  Emulator emulator;
+  emulator.load_config(rom, conf.seed);
+  Chip8::CPU &cpu = emulator.cpu;
+
+  SpeedProfile profile;
+  double cycles_per_frame = static_cast<double>(speed) * Chip8::TIMER_PERIOD;
+  std::uint64_t last_idle = 0; // cycle after the last idle cycle
+  unsigned int last_spin_pc = 0; // Fx07 which was executed last
+  std::uint64_t last_spin_cycle = 0;
+  unsigned char last_spin_timer = 0;
+
+  try {
+	for (; profile.frames < conf.frames; profile.frames++) {
+	  std::size_t settled = profile.settled.size();
+	  if (conf.key_period && settled % conf.key_period == 0 && settled > 0
+		  && profile.settled.back().frame + 1 == profile.frames) {
+		std::uint64_t hash = (settled / conf.key_period) * 0x9E3779B97F4A7C15u;
+		cpu.set_key(static_cast<unsigned int>((hash >> 32u) & 0xFu), (hash >> 40u) & 1u);
+	  }
+
+	  auto last = static_cast<std::uint64_t>(std::floor(static_cast<double>(profile.frames + 1) * cycles_per_frame));
+	  for (; profile.cycles < last; profile.cycles++) {
+		unsigned int pc = cpu.pc();
+		auto opcode = static_cast<unsigned short>(cpu.read_data(pc) << 8u | cpu.read_data(pc + 1));
+		Chip8::InstructionId id = Chip8::Instruction::decode(opcode, cpu.mode());
+
+		if (id == Chip8::ID_Fx07) {
+		  // polling loop reads the timer again before it changes
+		  if (pc == last_spin_pc && profile.cycles - last_spin_cycle <= SPIN_WINDOW
+			  && cpu.delay_timer() == last_spin_timer) {
+			profile.timer_wait_cycles += profile.cycles - last_spin_cycle;
+			last_idle = profile.cycles + 1;
+		  }
+		  last_spin_pc = pc;
+		  last_spin_cycle = profile.cycles;
+		  last_spin_timer = cpu.delay_timer();
+		}
+
+		cpu.cycle();
+		if (cpu.pc() == pc && (id == Chip8::ID_Fx0A || id == Chip8::ID_1nnn)) {
+		  profile.key_wait_cycles++;
+		  last_idle = profile.cycles + 1;
+		}
+	  }
+	  cpu.update_timers();
+	  if (last_idle > 0 && profile.cycles - last_idle < SPIN_WINDOW)
+		profile.settled.push_back(SettledFrame{profile.frames, frame_hash(cpu)});
+	}
+  } catch (const std::runtime_error &e) {
+	profile.error = e.what();
+  }
+
+  return profile;
+}
+
+Calibration calibrate(const RomConf &rom, const CalibrationConf &conf) {
+  if (conf.step == 0)
+	throw std::runtime_error("calibration step can't be 0");
+
+  Calibration calibration;
+  calibration.configured_speed = static_cast<unsigned int>(std::lround(1.0 / rom.emulation_period));
+  calibration.recommended_speed = calibration.configured_speed;
+  const SpeedProfile &reference = calibration.reference = profile_speed(rom, calibration.configured_speed, conf);
+  calibration.throttled = reference.settled_fraction() >= conf.min_settled;
+  if (!calibration.throttled)
+	return calibration;
+
+  for (unsigned int speed = calibration.configured_speed; speed >= conf.min_speed + conf.step;) {
+	speed -= conf.step;
+	SpeedProfile candidate = profile_speed(rom, speed, conf);
+
+	const auto &expected = reference.settled, &actual = candidate.settled;
+	std::size_t i = 0;
+	for (; i < expected.size() && i < actual.size(); i++) {
+	  if (actual[i].hash != expected[i].hash || actual[i].frame < expected[i].frame
+		  || actual[i].frame > expected[i].frame + conf.max_lag)
+		break;
+	}
+	// run ends at the same frame, so lagging candidate may miss the last few settled frames
+	bool matched = i == expected.size() || (i == actual.size() && expected[i].frame + conf.max_lag >= conf.frames);
+	if (!matched || candidate.error != reference.error) {
+	  calibration.rejected_speed = speed;
+	  calibration.first_mismatch = i < expected.size() ? expected[i].frame : reference.frames;
+	  break;
+	}
+	calibration.recommended_speed = speed;
+  }
+
+  return calibration;
+}
@@ -0,0 +1,98 @@
+#ifndef CHIP8_EMU_CPP_CALIBRATION_HPP
+#define CHIP8_EMU_CPP_CALIBRATION_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "conf.hpp"
+
+/**
+ * \brief Settings of speed calibration.
+ */
+struct CalibrationConf {
+  unsigned int frames = 3600; //!< Number of 60 Hz frames emulated at each speed, one minute by default.
+  unsigned int key_period = 20; //!< Settled frames between scripted key changes.
+  unsigned int min_speed = 60; //!< Lowest speed tried in cycles per second.
+  unsigned int step = 10; //!< Difference between tried speeds.
+  std::uint32_t seed = 0xC8C8C8C8; //!< Seed of cpu's random number generator, same for every speed.
+  double min_settled = 0.5; //!< Fraction of settled frames below which rom is considered not throttled.
+  unsigned int max_lag = 6; //!< Frames by which settled frames may come later than at configured speed.
+};
+
+/**
+ * \brief Settled frame, i.e. frame which ended with cpu waiting because its work for the frame was done.
+ */
+struct SettledFrame {
+  std::uint64_t frame; //!< Number of the frame.
+  std::uint64_t hash; //!< Hash of the display, see frame_hash.
+};
+
+/**
+ * \brief Output and idle time of a rom run at one speed.
+ */
+struct SpeedProfile {
+  std::uint64_t frames = 0; //!< Emulated frames.
+  std::vector<SettledFrame> settled; //!< Frames which ended with cpu waiting, in order.
+  std::uint64_t cycles = 0; //!< Executed cycles.
+  std::uint64_t timer_wait_cycles = 0; //!< Cycles spent in loops polling delay timer with Fx07.
+  std::uint64_t key_wait_cycles = 0; //!< Cycles spent blocked in Fx0A or jumping to itself.
+  std::string error; //!< Cpu error which stopped the run, empty when rom ran for all frames.
+
+  /**
+   * \brief Gets fraction of cycles spent waiting.
+   *
+   * @return idle cycles divided by all cycles, 0 when nothing was executed
+   */
+  [[nodiscard]] double idle_fraction() const;
+
+  /**
+   * \brief Gets fraction of frames which ended with cpu waiting.
+   *
+   * @return settled frames divided by all frames, 0 when no frame was emulated
+   */
+  [[nodiscard]] double settled_fraction() const;
+};
+
+/**
+ * \brief Result of speed calibration of a rom.
+ */
+struct Calibration {
+  unsigned int configured_speed = 0; //!< Speed from rom configuration.
+  unsigned int recommended_speed = 0; //!< Lowest speed with output identical to configured speed.
+  bool throttled = false; //!< Does rom wait often enough to be calibrated, otherwise configured speed is kept.
+  SpeedProfile reference; //!< Run at configured speed.
+  unsigned int rejected_speed = 0; //!< Highest speed with different output, 0 if every tried speed matched.
+  std::uint64_t first_mismatch = 0; //!< Frame of the first settled frame which differed at rejected speed.
+};
+
+/**
+ * \brief Runs rom at given speed with scripted input.
+ *
+ * Key changes come after every key_period settled frames, so runs at different speeds get them at the same point
+ * of the game as long as they settle the same frames. Cycles are split into frames the same way as in VecEnv,
+ * timers are updated after every frame.
+ *
+ * @param rom rom configuration, its speed is ignored
+ * @param speed cycles per second
+ * @param conf calibration settings
+ * @return output and idle time of the run
+ */
+SpeedProfile profile_speed(const RomConf &rom, unsigned int speed, const CalibrationConf &conf);
+
+/**
+ * \brief Finds the lowest speed giving the same output as rom's configured speed.
+ *
+ * Output is the sequence of displays of settled frames, frames in which the rom is still working hold whatever was
+ * drawn until the frame ended and aren't compared. Candidate speed must produce the same sequence, each frame at
+ * most max_lag frames later, e.g. when setup drawing without waits takes a frame longer. Speeds are tried downwards
+ * from the configured one in steps, search stops at the first speed with different output. Roms which settle less
+ * than min_settled of frames pace themselves by speed and keep the configured one. Throws runtime error if rom
+ * can't be loaded.
+ *
+ * @param rom rom configuration
+ * @param conf calibration settings
+ * @return configured and recommended speed with idle time at configured speed
+ */
+Calibration calibrate(const RomConf &rom, const CalibrationConf &conf);
+
+#endif //CHIP8_EMU_CPP_CALIBRATION_HPP
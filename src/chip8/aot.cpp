@@ -0,0 +1,64 @@
+#include <algorithm>
+#include "aot.hpp"
+
+Chip8::AotEngine::AotEngine(CPU &cpu, const AotProgram &program) :
+	cpu(cpu), program(program), valid(program.n_blocks, false) {
+  block_at.fill(-1);
+  offset_at.fill(0);
+
+  for (std::size_t i = 0; i < program.n_blocks; i++) {
+	const AotBlock &block = program.blocks[i];
+	unsigned int end = block.start + 2u * block.length; // one past the last byte
+	if (end > MEMORY_SIZE)
+	  throw std::runtime_error("compiled block outside of memory");
+
+	for (unsigned int n = 0; n < block.length; n++) {
+	  block_at[block.start + 2 * n] = static_cast<std::int16_t>(i);
+	  offset_at[block.start + 2 * n] = static_cast<unsigned char>(n);
+	}
+	for (unsigned int page = block.start / PAGE_SIZE; page <= (end - 1) / PAGE_SIZE; page++)
+	  page_blocks[page].push_back(static_cast<std::uint16_t>(i));
+  }
+
+  cpu.take_written_pages();
+  verify(ALL_PAGES);
+}
+
+void Chip8::AotEngine::verify(std::uint16_t written) {
+  for (unsigned int page = 0; page < N_PAGES; page++) {
+	if (!((written >> page) & 1u))
+	  continue;
+
+	for (auto i : page_blocks[page]) {
+	  const AotBlock &block = program.blocks[i];
+	  bool same = true;
+	  for (unsigned int address = block.start; same && address < block.start + 2u * block.length; address++) {
+		std::size_t offset = address - PC_INIT;
+		unsigned char compiled_byte = address >= PC_INIT && offset < program.rom_size ? program.rom[offset] : 0;
+		same = cpu.read(address) == compiled_byte;
+	  }
+	  valid[i] = same;
+	}
+  }
+}
+
+void Chip8::AotEngine::run(std::uint64_t cycles) {
+  while (cycles > 0) {
+	if (std::uint16_t written = cpu.take_written_pages())
+	  verify(written);
+
+	unsigned short address = cpu.pc();
+	int block = address < MEMORY_SIZE ? block_at[address] : -1;
+	if (block >= 0 && valid[block]) {
+	  unsigned int offset = offset_at[address];
+	  auto count = static_cast<unsigned int>(std::min<std::uint64_t>(program.blocks[block].length - offset, cycles));
+	  program.run_block(cpu, static_cast<std::size_t>(block), offset, count);
+	  compiled += count;
+	  cycles -= count;
+	} else {
+	  cpu.cycle();
+	  interpreted++;
+	  cycles--;
+	}
+  }
+}
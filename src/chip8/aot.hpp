@@ -0,0 +1,94 @@
+#ifndef CHIP8_EMU_CPP_AOT_HPP
+#define CHIP8_EMU_CPP_AOT_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "cpu.hpp"
+
+namespace Chip8 {
+const unsigned int AOT_MAX_BLOCK = 32; // maximum number of instructions in compiled block
+
+/**
+ * \brief Straight-line sequence of instructions compiled ahead of time.
+ */
+struct AotBlock {
+  unsigned short start; //!< Address of the first instruction.
+  unsigned short length; //!< Number of instructions, at most AOT_MAX_BLOCK.
+};
+
+/**
+ * \brief Rom compiled into native code by chip8_aot.
+ *
+ * Block functions call instruction handlers directly with constant opcodes, so neither fetching nor decoding is left.
+ * Block can be entered at any of its instructions and left after any number of them, so that emulation can stop at
+ * exact cycle e.g. for timers update.
+ */
+struct AotProgram {
+  const char *name; //!< Name of the rom in roms.json.
+  const unsigned char *rom; //!< Compiled rom.
+  std::size_t rom_size; //!< Size of the rom in bytes.
+  double emulation_period; //!< Time between cycles in seconds.
+  bool load_store_quirk; //!< Load store quirk flag.
+  bool shift_quirk; //!< Shift quirk flag.
+  bool wrapping; //!< Wrapping flag.
+  bool schip; //!< SUPER-CHIP mode flag.
+  bool xo_chip; //!< XO-CHIP mode flag.
+  const AotBlock *blocks; //!< Compiled blocks.
+  std::size_t n_blocks; //!< Number of compiled blocks.
+  /**
+   * Executes count instructions of block with given index starting with the instruction at offset. Count is at
+   * least 1 and at most block's length - offset.
+   */
+  void (*run_block)(CPU &cpu, std::size_t block, unsigned int offset, unsigned int count);
+};
+
+/**
+ * \brief Executes cpu with compiled blocks, falling back to CPU::cycle.
+ *
+ * Cpu falls back to interpreting when PC isn't at an instruction of a compiled block, e.g. after computed jump (Bnnn), and
+ * when block's bytes in memory differ from the compiled rom, e.g. after self-modification or loading other rom.
+ * Blocks end after instructions writing memory, so modified code is noticed before it's executed.
+ */
+class AotEngine {
+  CPU &cpu;
+  const AotProgram &program;
+  std::array<std::int16_t, MEMORY_SIZE> block_at; // index of block containing instruction at each address or -1
+  std::array<unsigned char, MEMORY_SIZE> offset_at; // index of the instruction within its block
+  std::array<std::vector<std::uint16_t>, N_PAGES> page_blocks; // blocks overlapping each page
+  std::vector<bool> valid; // whether block's bytes in memory match the compiled rom
+  std::uint64_t compiled = 0;
+  std::uint64_t interpreted = 0;
+
+  /**
+   * \brief Compares blocks overlapping written pages with the compiled rom.
+   */
+  void verify(std::uint16_t written);
+
+public:
+  /**
+   * \brief Creates engine running given cpu.
+   *
+   * @param cpu cpu to run, must outlive the engine
+   * @param program compiled rom
+   */
+  AotEngine(CPU &cpu, const AotProgram &program);
+
+  /**
+   * \brief Executes given number of cpu cycles.
+   *
+   * Has the same effect as calling CPU::cycle given number of times.
+   *
+   * @param cycles number of cycles
+   */
+  void run(std::uint64_t cycles);
+
+  /** \brief Number of cycles executed by compiled blocks. */
+  [[nodiscard]] std::uint64_t compiled_cycles() const { return compiled; }
+
+  /** \brief Number of cycles executed by interpreter. */
+  [[nodiscard]] std::uint64_t interpreted_cycles() const { return interpreted; }
+};
+}
+
+#endif //CHIP8_EMU_CPP_AOT_HPP
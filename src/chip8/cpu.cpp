@@ -1,165 +1,374 @@
 #include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
 #include "cpu.hpp"
 #include "instructions.hpp"
 
-unsigned short Chip8::CPU::get_opcode() {
-  try {
-	unsigned short big = mem.at(PC);
-	unsigned short small = mem.at(PC + 1u);
-
-	return (big << 8u) + small;
-  } catch (const std::out_of_range &e) {
+unsigned short Chip8::CPU::get_opcode() const {
+  if (hot.PC + 1u >= MEMORY_SIZE)
 	throw std::runtime_error("tried to access out of memory");
-  }
+
+  unsigned short big = read(hot.PC);
+  unsigned short small = read(hot.PC + 1u);
+
+  return (big << 8u) + small;
 }
 
 void Chip8::CPU::cycle() {
   unsigned short opcode = get_opcode();
+  record_trace(opcode);
   execute(opcode);
 }
 
-using FP = void(Chip8::CPU &, unsigned short);
-
 void Chip8::CPU::execute(unsigned short opcode) {
-  FP *fp = nullptr;
-
-  switch ((opcode & 0xF000u) >> 12u) {
-  case 0x0: {
-	switch (opcode) {
-	case 0x0000:fp = Instruction::i_0000;
-	  break;
-	case 0x00E0:fp = Instruction::i_00E0;
-	  break;
-	case 0x00EE:fp = Instruction::i_00EE;
-	  break;
-	default:break;
-	}
-	break;
-  }
-  case 0x1:fp = Instruction::i_1nnn;
-	break;
-  case 0x2:fp = Instruction::i_2nnn;
-	break;
-  case 0x3:fp = Instruction::i_3xkk;
-	break;
-  case 0x4:fp = Instruction::i_4xkk;
-	break;
-  case 0x5: {
-	switch (opcode & 0x000Fu) {
-	case 0x0:fp = Instruction::i_5xy0;
-	  break;
-	default:break;
-	}
-	break;
-  }
-  case 0x6:fp = Instruction::i_6xkk;
-	break;
-  case 0x7:fp = Instruction::i_7xkk;
-	break;
-  case 0x8: {
-	switch (opcode & 0x000Fu) {
-	case 0x0:fp = Instruction::i_8xy0;
-	  break;
-	case 0x1:fp = Instruction::i_8xy1;
-	  break;
-	case 0x2:fp = Instruction::i_8xy2;
-	  break;
-	case 0x3:fp = Instruction::i_8xy3;
-	  break;
-	case 0x4:fp = Instruction::i_8xy4;
-	  break;
-	case 0x5:fp = Instruction::i_8xy5;
-	  break;
-	case 0x6:fp = Instruction::i_8xy6;
-	  break;
-	case 0x7:fp = Instruction::i_8xy7;
-	  break;
-	case 0xE:fp = Instruction::i_8xyE;
-	  break;
-	default:break;
-	}
-	break;
-  }
-  case 0x9:fp = Instruction::i_9xy0;
-	break;
-  case 0xA:fp = Instruction::i_Annn;
-	break;
-  case 0xB:fp = Instruction::i_Bnnn;
-	break;
-  case 0xC:fp = Instruction::i_Cxkk;
-	break;
-  case 0xD:fp = Instruction::i_Dxyn;
-	break;
-  case 0xE: {
-	switch (opcode & 0x00FFu) {
-	case 0x9E:fp = Instruction::i_Ex9E;
-	  break;
-	case 0xA1:fp = Instruction::i_ExA1;
-	  break;
-	default:break;
-	}
-	break;
-  }
-  case 0xF: {
-	switch (opcode & 0x00FFu) {
-	case 0x07:fp = Instruction::i_Fx07;
-	  break;
-	case 0x0A:fp = Instruction::i_Fx0A;
-	  break;
-	case 0x15:fp = Instruction::i_Fx15;
-	  break;
-	case 0x18:fp = Instruction::i_Fx18;
-	  break;
-	case 0x1E:fp = Instruction::i_Fx1E;
-	  break;
-	case 0x29:fp = Instruction::i_Fx29;
-	  break;
-	case 0x33:fp = Instruction::i_Fx33;
-	  break;
-	case 0x55:fp = Instruction::i_Fx55;
-	  break;
-	case 0x65:fp = Instruction::i_Fx65;
-	  break;
-	default:break;
-	}
-	break;
-  }
-  default:break;
-  }
+  Handler handler = Instruction::HANDLERS[Instruction::decode(opcode, mode())];
 
-  if (fp)
-	fp(*this, opcode);
+  if (handler)
+	handler(*this, opcode);
   else
-	throw std::runtime_error(&"unknown opcode "[opcode]);
+	throw std::runtime_error("unknown opcode " + opcode_string(opcode));
+}
+
+std::string Chip8::opcode_string(unsigned short opcode) {
+  const char *digits = "0123456789ABCDEF";
+  std::string result = "0000";
+  for (unsigned int i = 0; i < 4; i++)
+	result[3 - i] = digits[(opcode >> (4 * i)) & 0xFu];
+  return result;
 }
 
 void Chip8::CPU::load_rom(const std::vector<unsigned char> &rom) {
-  if (rom.size() >= MEMORY_SIZE - 0x200) {
+  load_rom(rom.data(), rom.size());
+}
+
+void Chip8::CPU::load_rom(const unsigned char *rom, std::size_t size) {
+  if (size >= memory_size() - 0x200) {
 	throw std::runtime_error("rom size is too large");
   } else {
-	std::copy(rom.begin(), rom.end(), mem.begin() + 0x200);
+	std::size_t low = std::min<std::size_t>(size, MEMORY_SIZE - 0x200);
+	for (unsigned int page = 0x200 / PAGE_SIZE; page * PAGE_SIZE < 0x200 + low; page++) {
+	  if ((hot.shared_pages >> page) & 1u)
+		unshare_page(page);
+	}
+	std::copy(rom, rom + low, mem.begin() + 0x200);
+	std::copy(rom + low, rom + size, extended.begin()); // rest of XO-CHIP rom
+	hot.written_pages = ALL_PAGES;
+  }
+}
+
+void Chip8::CPU::reset() {
+  hot.reg.fill(0);
+  stack.fill(0);
+  for (auto &plane : planes)
+	plane.fill({});
+  hot.plane_mask = 1;
+  hot.high_resolution = false;
+  halted = false;
+  hot.PC = PC_INIT;
+  hot.I = 0;
+  hot.DT = 0;
+  hot.ST = 0;
+  hot.SP = 0;
+  hot.keyboard = 0;
+  hot.waiting = false;
+  hot.rng = initial_rng;
+  pattern.fill(0);
+  has_pattern = false;
+  pitch = DEFAULT_PITCH;
+  std::fill(extended.begin(), extended.end(), 0);
+  hot.written_pages = ALL_PAGES;
+
+  if (image) {
+	hot.shared_pages = ALL_PAGES;
+	hot.slow_pages = ALL_PAGES;
+  } else {
+	std::copy(Chip8::FONTS.cbegin(), Chip8::FONTS.cend(), mem.begin());
+	std::fill(mem.begin() + Chip8::FONTS.size(), mem.end(), 0);
   }
 }
 
+void Chip8::CPU::unshare_page(unsigned int page) {
+  auto offset = page * PAGE_SIZE;
+  std::copy(image->bytes.cbegin() + offset, image->bytes.cbegin() + offset + PAGE_SIZE, mem.begin() + offset);
+  hot.shared_pages &= static_cast<std::uint16_t>(~(1u << page));
+  hot.slow_pages = hot.shared_pages | watched_pages;
+}
+
+void Chip8::CPU::prepare_write(unsigned int address, unsigned char value) {
+  if ((hot.shared_pages >> (address / PAGE_SIZE)) & 1u)
+	unshare_page(address / PAGE_SIZE);
+  if ((watched_pages >> (address / PAGE_SIZE)) & 1u)
+	watcher->written(address, value);
+}
+
+void Chip8::CPU::watch_writes(std::uint16_t watched, WriteWatcher *write_watcher) {
+  watcher = write_watcher;
+  watched_pages = watcher ? watched : 0;
+  hot.slow_pages = hot.shared_pages | watched_pages;
+}
+
+void Chip8::CPU::copy_memory(const CPU &other) {
+  image = other.image;
+  hot.image = image ? image->bytes.data() : nullptr;
+  hot.shared_pages = other.hot.shared_pages;
+  hot.slow_pages = hot.shared_pages | watched_pages;
+
+  for (unsigned int page = 0; page < N_PAGES; page++) {
+	auto offset = page * PAGE_SIZE;
+	if (!((hot.shared_pages >> page) & 1u))
+	  std::copy(other.mem.cbegin() + offset, other.mem.cbegin() + offset + PAGE_SIZE, mem.begin() + offset);
+  }
+}
+
+unsigned int Chip8::CPU::shared_page_count() const {
+  unsigned int count = 0;
+  for (unsigned int page = 0; page < N_PAGES; page++)
+	count += (hot.shared_pages >> page) & 1u;
+  return count;
+}
+
+std::uint32_t Chip8::CPU::random() {
+  hot.rng ^= hot.rng << 13u;
+  hot.rng ^= hot.rng >> 17u;
+  hot.rng ^= hot.rng << 5u;
+  return hot.rng;
+}
+
+void Chip8::CPU::seed_random(std::uint32_t seed) {
+  hot.rng = seed ? seed : 1; // xorshift would only ever return 0 for 0 state
+  initial_rng = hot.rng;
+}
+
 void Chip8::CPU::update_timers() {
-  if (DT > 0)
-	DT -= 1;
-  if (ST > 0)
-	ST -= 1;
+  if (hot.DT > 0)
+	hot.DT -= 1;
+  if (hot.ST > 0)
+	hot.ST -= 1;
 }
 
-bool &Chip8::CPU::key(unsigned int id) {
-  if (id >= 16)
+void Chip8::CPU::set_key(unsigned int id, bool value) {
+  if (id >= KEYBOARD_SIZE)
 	throw std::runtime_error("no such key");
 
-  return keyboard[id];
+  auto mask = static_cast<std::uint16_t>(1u << id);
+  if (value) {
+	hot.keyboard |= mask;
+	hot.waiting = false;
+  } else {
+	hot.keyboard &= static_cast<std::uint16_t>(~mask);
+  }
 }
 
-const std::array<bool, Chip8::SCREEN_WIDTH * Chip8::SCREEN_HEIGHT> &Chip8::CPU::get_display() {
-  return display;
+void Chip8::CPU::pack_display(unsigned char *out) const {
+  for (unsigned int y = 0; y < SCREEN_HEIGHT; y++) {
+	std::uint64_t row = planes[0][y].left | planes[1][y].left;
+	if (hot.high_resolution) {
+	  // halve the resolution, each pixel covers two rows and two columns
+	  std::uint64_t left = 0, right = 0;
+	  for (const auto &plane : planes) {
+		left |= plane[2 * y].left | plane[2 * y + 1].left;
+		right |= plane[2 * y].right | plane[2 * y + 1].right;
+	  }
+	  row = 0;
+	  for (unsigned int x = 0; x < 32; x++) {
+		row |= static_cast<std::uint64_t>(((left >> (62u - 2 * x)) & 3u) != 0) << (63u - x);
+		row |= static_cast<std::uint64_t>(((right >> (62u - 2 * x)) & 3u) != 0) << (31u - x);
+	  }
+	}
+	for (unsigned int byte = 0; byte < 8; byte++)
+	  out[y * 8 + byte] = static_cast<unsigned char>(row >> (56u - 8 * byte));
+  }
 }
 
-Chip8::CPU::CPU(bool load_store_quirk, bool shift_quirk, bool wrapping) :
-	load_store_quirk(load_store_quirk), shift_quirk(shift_quirk), wrapping(wrapping) {
+bool Chip8::CPU::draw_row(unsigned int plane, unsigned int y, unsigned int x, std::uint32_t bits, unsigned int width) {
+  unsigned int screen_width = display_width();
+  std::uint32_t wrapped = 0;
+  unsigned int wrapped_width = 0;
+
+  if (x + width > screen_width) {
+	wrapped_width = x + width - screen_width;
+	if (hot.wrapping)
+	  wrapped = bits & ((1u << wrapped_width) - 1u);
+	bits >>= wrapped_width;
+	width -= wrapped_width;
+  }
+
+  // place sprite into 128-bit row, left word holds the more significant half
+  auto place = [](std::uint32_t sprite, unsigned int sprite_width, unsigned int column) {
+	unsigned int shift = 128 - sprite_width - column;
+	DisplayRow mask;
+	if (shift >= 64) {
+	  mask.left = static_cast<std::uint64_t>(sprite) << (shift - 64);
+	} else {
+	  mask.right = static_cast<std::uint64_t>(sprite) << shift;
+	  if (shift > 0)
+		mask.left = static_cast<std::uint64_t>(sprite) >> (64 - shift);
+	}
+	return mask;
+  };
+
+  DisplayRow mask = place(bits, width, x);
+  if (wrapped) {
+	DisplayRow wrapped_mask = place(wrapped, wrapped_width, 0);
+	mask.left |= wrapped_mask.left;
+	mask.right |= wrapped_mask.right;
+  }
+
+  DisplayRow &row = planes[plane][y];
+  bool collision = (row.left & mask.left) || (row.right & mask.right);
+  row.left ^= mask.left;
+  row.right ^= mask.right;
+  return collision;
+}
+
+void Chip8::CPU::set_high_resolution(bool enabled) {
+  hot.high_resolution = enabled;
+  for (auto &plane : planes)
+	plane.fill({});
+}
+
+void Chip8::CPU::set_xo_chip(bool enabled) {
+  hot.xo_chip = enabled;
+  extended.assign(enabled ? XO_MEMORY_SIZE - MEMORY_SIZE : 0, 0);
+  hot.written_pages = ALL_PAGES; // instructions decode differently
+}
+
+void Chip8::CPU::set_schip(bool enabled) {
+  hot.schip = enabled;
+  hot.written_pages = ALL_PAGES; // instructions decode differently
+}
+
+Chip8::CPU::CPU(bool load_store_quirk, bool shift_quirk, bool wrapping) {
+  // checked here, where private members are accessible
+  static_assert(std::is_standard_layout_v<CPU>, "cpu layout must be checkable with offsetof");
+  static_assert(offsetof(CPU, hot) == 0, "hot state must start the cpu");
+  static_assert(offsetof(CPU, mem) % CACHE_LINE_SIZE == 0 && offsetof(CPU, planes) % CACHE_LINE_SIZE == 0,
+				"memory and display must start on their own cache lines");
+  static_assert(offsetof(CPU, mem) >= offsetof(CPU, stack) + sizeof(stack), "memory must follow hot state");
+
+  set_quirks(load_store_quirk, shift_quirk, wrapping);
+  mem.fill(0);
   std::copy(Chip8::FONTS.cbegin(), Chip8::FONTS.cend(), mem.begin());
 }
+
+Chip8::CPU::CPU(std::shared_ptr<const MemoryImage> image, bool load_store_quirk, bool shift_quirk, bool wrapping) :
+	image(std::move(image)) {
+  if (!this->image)
+	throw std::runtime_error("no memory image");
+
+  set_quirks(load_store_quirk, shift_quirk, wrapping);
+
+  // private memory is left uninitialized, pages are copied into it on first write
+  hot.shared_pages = ALL_PAGES;
+  hot.slow_pages = ALL_PAGES;
+  hot.image = this->image->bytes.data();
+}
+
+Chip8::CPU::CPU(const CPU &other) {
+  *this = other;
+}
+
+Chip8::CPU &Chip8::CPU::operator=(const CPU &other) {
+  if (this == &other)
+	return *this;
+
+  hot.reg = other.hot.reg;
+  stack = other.stack;
+  planes = other.planes;
+  hot.plane_mask = other.hot.plane_mask;
+  hot.high_resolution = other.hot.high_resolution;
+  halted = other.halted;
+  hot.PC = other.hot.PC;
+  hot.I = other.hot.I;
+  hot.DT = other.hot.DT;
+  hot.ST = other.hot.ST;
+  hot.SP = other.hot.SP;
+  hot.keyboard = other.hot.keyboard;
+  hot.waiting = other.hot.waiting;
+  hot.rng = other.hot.rng;
+  initial_rng = other.initial_rng;
+  hot.xo_chip = other.hot.xo_chip;
+  hot.schip = other.hot.schip;
+  extended = other.extended;
+  pattern = other.pattern;
+  has_pattern = other.has_pattern;
+  pitch = other.pitch;
+  hot.written_pages = ALL_PAGES; // memory changed completely
+  hot.load_store_quirk = other.hot.load_store_quirk;
+  hot.shift_quirk = other.hot.shift_quirk;
+  hot.wrapping = other.hot.wrapping;
+
+  copy_memory(other);
+  return *this;
+}
+
+Chip8::CPUState Chip8::CPU::state() const {
+  CPUState state;
+  state.memory.resize(memory_size());
+  for (unsigned int page = 0; page < N_PAGES; page++)
+	std::copy(page_data(page), page_data(page) + PAGE_SIZE, state.memory.begin() + page * PAGE_SIZE);
+  std::copy(extended.cbegin(), extended.cend(), state.memory.begin() + MEMORY_SIZE);
+
+  state.registers = hot.reg;
+  state.stack = stack;
+  state.planes = planes;
+  state.plane_mask = hot.plane_mask;
+  state.high_resolution = hot.high_resolution;
+  state.halted = halted;
+  state.pc = hot.PC;
+  state.index = hot.I;
+  state.delay_timer = hot.DT;
+  state.sound_timer = hot.ST;
+  state.sp = hot.SP;
+  state.keyboard = hot.keyboard;
+  state.rng = hot.rng;
+  state.pattern = pattern;
+  state.has_pattern = has_pattern;
+  state.pitch = pitch;
+  return state;
+}
+
+void Chip8::CPU::restore(const CPUState &state) {
+  if (state.memory.size() != memory_size())
+	throw std::runtime_error("state memory size doesn't match cpu");
+
+  for (unsigned int page = 0; page < N_PAGES; page++) {
+	const unsigned char *source = state.memory.data() + page * PAGE_SIZE;
+	if (std::equal(source, source + PAGE_SIZE, page_data(page)))
+	  continue;
+	if ((hot.shared_pages >> page) & 1u)
+	  unshare_page(page);
+	std::copy(source, source + PAGE_SIZE, mem.begin() + page * PAGE_SIZE);
+  }
+  std::copy(state.memory.cbegin() + MEMORY_SIZE, state.memory.cend(), extended.begin());
+  hot.written_pages = ALL_PAGES;
+
+  hot.reg = state.registers;
+  stack = state.stack;
+  planes = state.planes;
+  hot.plane_mask = state.plane_mask;
+  hot.high_resolution = state.high_resolution;
+  halted = state.halted;
+  hot.PC = state.pc;
+  hot.I = state.index;
+  hot.DT = state.delay_timer;
+  hot.ST = state.sound_timer;
+  hot.SP = state.sp;
+  hot.keyboard = state.keyboard;
+  hot.waiting = false; // Fx0A is executed again and waits if still no key is pressed
+  hot.rng = state.rng;
+  pattern = state.pattern;
+  has_pattern = state.has_pattern;
+  pitch = state.pitch;
+}
+
+std::shared_ptr<const Chip8::MemoryImage> Chip8::MemoryImage::create(const unsigned char *rom, std::size_t size) {
+  if (size >= MEMORY_SIZE - 0x200)
+	throw std::runtime_error("rom size is too large");
+
+  auto image = std::make_shared<MemoryImage>();
+  std::copy(Chip8::FONTS.cbegin(), Chip8::FONTS.cend(), image->bytes.begin());
+  std::copy(rom, rom + size, image->bytes.begin() + 0x200);
+  return image;
+}
@@ -2,11 +2,20 @@
 #define CHIP8_EMU_CPP_CPU_HPP
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 #include <stdexcept>
+#include "trace.hpp"
 
 namespace Chip8 {
-const unsigned int MEMORY_SIZE = 4096;
+const unsigned int MEMORY_SIZE = 4096; // memory code runs from, XO-CHIP adds data memory above it
+const unsigned int XO_MEMORY_SIZE = 0x10000; // XO-CHIP address space
+const unsigned int PAGE_SIZE = 256; // granularity of copy on write
+const unsigned int N_PAGES = MEMORY_SIZE / PAGE_SIZE;
+const std::uint16_t ALL_PAGES = static_cast<std::uint16_t>((1u << N_PAGES) - 1u); // mask with bit of every page
 const unsigned int N_REGISTERS = 16;
 const unsigned int STACK_SIZE = 16;
 const unsigned int KEYBOARD_SIZE = 16;
@@ -14,6 +23,11 @@ const unsigned int FONT_WIDTH = 5;
 const unsigned int FONT_CHARACTERS = 16;
 const unsigned int SCREEN_WIDTH = 64;
 const unsigned int SCREEN_HEIGHT = 32;
+const unsigned int HIRES_WIDTH = 128; // SCHIP high resolution mode
+const unsigned int HIRES_HEIGHT = 64;
+const unsigned int N_PLANES = 2; // XO-CHIP bitplanes
+const unsigned int AUDIO_PATTERN_SIZE = 16; // XO-CHIP audio pattern in bytes
+const unsigned char DEFAULT_PITCH = 64; // plays audio pattern at 4000 bits per second
 const unsigned int PC_INIT = 0x200;
 const double TIMER_PERIOD = 1.0 / 60.0; // 1 / Hz
 
@@ -25,6 +39,157 @@ const std::array<unsigned char, FONT_WIDTH * FONT_CHARACTERS> FONTS = {
 	0xF0, 0xE0, 0x90, 0x90, 0x90, 0xE0, 0xF0, 0x80, 0xF0, 0x80, 0xF0, 0xF0, 0x80, 0xF0, 0x80, 0x80,
 };
 
+/**
+ * \brief Formats opcode as four hexadecimal digits.
+ *
+ * @param opcode 16-bit opcode
+ * @return e.g. "00E0"
+ */
+std::string opcode_string(unsigned short opcode);
+
+/**
+ * \brief Instruction set a rom is written for, each one extends the previous.
+ */
+enum class Mode : unsigned char {
+  CHIP8, //!< Original CHIP-8, Dxy0 draws nothing.
+  SCHIP, //!< SUPER-CHIP high resolution, scrolling, exit and 16x16 sprites drawn by Dxy0.
+  XO_CHIP, //!< SUPER-CHIP with XO-CHIP memory, bitplanes, register ranges and audio patterns.
+};
+
+/**
+ * \brief Gets mode of a rom from its configuration flags.
+ *
+ * @param schip is SUPER-CHIP mode on
+ * @param xo_chip is XO-CHIP mode on, implies SUPER-CHIP
+ * @return the widest of enabled instruction sets
+ */
+constexpr Mode mode_of(bool schip, bool xo_chip) {
+  return xo_chip ? Mode::XO_CHIP : schip ? Mode::SCHIP : Mode::CHIP8;
+}
+
+/**
+ * \brief Read-only memory contents shared by many cpus.
+ *
+ * Contains fonts and rom, i.e. memory as it is right after loading the rom.
+ */
+struct MemoryImage {
+  std::array<unsigned char, MEMORY_SIZE> bytes = {0}; //!< Whole memory.
+
+  /**
+   * \brief Creates image with fonts and given rom.
+   *
+   * Throws runtime error if rom won't fit into memory.
+   *
+   * @param rom pointer to the first byte of the rom
+   * @param size size of the rom in bytes
+   * @return image ready to be shared between cpus
+   */
+  static std::shared_ptr<const MemoryImage> create(const unsigned char *rom, std::size_t size);
+};
+
+static_assert(MEMORY_SIZE % PAGE_SIZE == 0 && N_PAGES <= 16, "shared pages must fit into 16-bit mask");
+
+/**
+ * \brief One row of the display packed into 128 bits.
+ *
+ * Most significant bit of left is the leftmost pixel, least significant bit of right is the rightmost one. In low
+ * resolution mode only left is used.
+ */
+struct alignas(16) DisplayRow {
+  std::uint64_t left = 0; //!< Pixels 0-63.
+  std::uint64_t right = 0; //!< Pixels 64-127.
+
+  bool operator==(const DisplayRow &other) const { return left == other.left && right == other.right; }
+  bool operator!=(const DisplayRow &other) const { return !(*this == other); }
+};
+
+/** \brief Whole display, in low resolution mode only first SCREEN_HEIGHT rows are used. */
+using Display = std::array<DisplayRow, HIRES_HEIGHT>;
+
+/**
+ * \brief Receives writes to watched memory pages, see CPU::watch_writes.
+ */
+class WriteWatcher {
+public:
+  virtual ~WriteWatcher() = default;
+
+  /**
+   * \brief Called right before the byte is written.
+   *
+   * @param address written address
+   * @param value byte being written, memory still holds the old one
+   */
+  virtual void written(unsigned int address, unsigned char value) = 0;
+};
+
+/**
+ * \brief Whole architectural state of a cpu, enough to continue emulation elsewhere.
+ *
+ * Quirk flags and XO-CHIP mode belong to rom configuration and aren't part of the state.
+ */
+struct CPUState {
+  std::vector<unsigned char> memory; //!< Whole address space, memory_size() bytes.
+  std::array<unsigned char, N_REGISTERS> registers{}; //!< V0-VF.
+  std::array<unsigned short, STACK_SIZE> stack{}; //!< Return addresses.
+  std::array<Display, N_PLANES> planes{}; //!< Display planes, only plane 0 is used outside of XO-CHIP.
+  unsigned char plane_mask = 1; //!< Planes selected by Fn01.
+  bool high_resolution = false; //!< SCHIP 128x64 mode.
+  bool halted = false; //!< Exited by 00FD.
+  unsigned short pc = PC_INIT; //!< Program counter.
+  unsigned short index = 0; //!< Index register I.
+  unsigned char delay_timer = 0; //!< DT.
+  unsigned char sound_timer = 0; //!< ST.
+  unsigned char sp = 0; //!< Stack pointer.
+  std::uint16_t keyboard = 0; //!< Bit n is set when key n is pressed.
+  std::uint32_t rng = 1; //!< State of the random number generator.
+  std::array<unsigned char, AUDIO_PATTERN_SIZE> pattern{}; //!< XO-CHIP audio pattern.
+  bool has_pattern = false; //!< Was audio pattern loaded by F002.
+  unsigned char pitch = DEFAULT_PITCH; //!< XO-CHIP audio pitch.
+};
+
+/** \brief Size of cache line the hot cpu state is laid out for. */
+const std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * \brief Part of cpu state read or written by almost every instruction.
+ *
+ * Kept in a single cache line at the start of the cpu, so that the interpreter loop touches one line for registers
+ * and flags no matter how many cpus are interleaved. The line also holds everything a fetch needs to find the
+ * opcode, so a fetch costs this line plus the memory line of the opcode. Memory and display live in their own cache
+ * lines after it. Fields are ordered by size, offsets are pinned by static asserts below.
+ */
+struct alignas(CACHE_LINE_SIZE) HotState {
+  std::array<unsigned char, N_REGISTERS> reg{}; //!< V0-VF.
+  unsigned short PC = PC_INIT; //!< Program counter.
+  unsigned short I = 0; //!< Index pointer.
+  std::uint16_t keyboard = 0; //!< Bit n is set when key n is pressed.
+  std::uint16_t written_pages = 0; //!< Bit n is set when page n was written since last take_written_pages.
+  std::uint16_t slow_pages = 0; //!< Shared or watched pages, writes to them take the slow path.
+  std::uint16_t shared_pages = 0; //!< Bit n is set while page n is read from shared image, 0 without an image.
+  unsigned char SP = 0; //!< Stack pointer.
+  unsigned char DT = 0; //!< Delay timer.
+  unsigned char ST = 0; //!< Sound timer.
+  unsigned char plane_mask = 1; //!< Bit n is set when plane n is drawn to, selected by Fn01.
+  bool load_store_quirk = false; //!< Fx55 and Fx65 leave I unchanged.
+  bool shift_quirk = false; //!< 8xy6 and 8xyE shift Vx instead of Vy.
+  bool wrapping = true; //!< Sprites wrap around the edges of the screen.
+  bool high_resolution = false; //!< SCHIP 128x64 mode, switched by 00FF and 00FE.
+  bool xo_chip = false; //!< Extended memory and XO-CHIP skips.
+  bool schip = false; //!< SUPER-CHIP instructions, implied by xo_chip.
+  bool waiting = false; //!< Blocked in Fx0A until a key is pressed.
+  std::uint32_t rng = 1; //!< State of the random number generator, never 0.
+  TraceBuffer *trace = nullptr; //!< Records executed instructions when set, not copied with the cpu.
+  const unsigned char *image = nullptr; //!< Bytes of the shared image, read for shared pages, null without one.
+};
+
+static_assert(sizeof(HotState) == CACHE_LINE_SIZE && alignof(HotState) == CACHE_LINE_SIZE,
+			  "hot cpu state must fill exactly one cache line");
+static_assert(offsetof(HotState, reg) == 0 && offsetof(HotState, PC) == 16 && offsetof(HotState, I) == 18 &&
+				  offsetof(HotState, keyboard) == 20 && offsetof(HotState, SP) == 28 &&
+				  offsetof(HotState, load_store_quirk) == 32 && offsetof(HotState, rng) == 40 &&
+				  offsetof(HotState, image) == 56,
+			  "unexpected hot cpu state layout");
+
 /**
  * \brief Represents Chip8's "CPU"
  */
@@ -32,28 +197,123 @@ class CPU {
   /** \brief Friend class containing all instructions for Chip8. */
   friend class Instruction;
 
-  std::array<unsigned char, MEMORY_SIZE> mem = {0};
-  std::array<unsigned char, N_REGISTERS> reg = {0};
+  HotState hot; // registers touched by every instruction, first cache line
   std::array<unsigned short, STACK_SIZE> stack = {0};
-  std::array<bool, KEYBOARD_SIZE> keyboard = {false};
-  std::array<bool, SCREEN_WIDTH * SCREEN_HEIGHT> display = {false};
 
-  unsigned short PC = PC_INIT; // program counter
-  unsigned short I = 0; // index pointer
+  alignas(CACHE_LINE_SIZE) std::array<unsigned char, MEMORY_SIZE> mem; // private memory, with shared image only copied pages are used
+  alignas(CACHE_LINE_SIZE) std::array<Display, N_PLANES> planes{}; // plane 0 is the only one used by CHIP-8 and SCHIP
 
-  unsigned char DT = 0; // delay timer
-  unsigned char ST = 0; // sound timer
-  unsigned char SP = 0; // stack pointer
+  // cold state, touched by setup, copies and rare instructions only
+  std::vector<unsigned char> extended; // XO-CHIP memory from MEMORY_SIZE up, empty otherwise
+  std::shared_ptr<const MemoryImage> image; // shared read-only image, null when whole memory is private
+  WriteWatcher *watcher = nullptr; // not copied with the cpu
+  std::uint16_t watched_pages = 0; // bit n is set when writes to page n are reported to watcher
+  bool halted = false; // set by 00FD, program stays at the exit instruction
+  bool has_pattern = false; // set once F002 loads a pattern, until then buzzer plays the default tone
+  unsigned char pitch = DEFAULT_PITCH; // XO-CHIP audio pitch set by Fx3A
+  std::uint32_t initial_rng = 1; // state given by seed_random, restored by reset
+  std::array<unsigned char, AUDIO_PATTERN_SIZE> pattern{}; // XO-CHIP audio pattern loaded by F002
 
   /**
-   * \brief Gets opcode for current cycle.
+   * \brief Gets next random number.
    *
-   * Merges two 8-bit numbers to create 16-bit opcode. More significant part is at the PC address and less significant
-   * is at PC + 1 address. If PC or PC+1 point outside of memory runtime error is thrown.
+   * Advances xorshift32 generator, so that sequence of random numbers depends only on the seed.
    *
-   * @return 16-bit opcode
+   * @return 32-bit pseudo random number
+   */
+  std::uint32_t random();
+
+  /**
+   * \brief Writes byte to memory.
+   *
+   * If the page is still shared, it is copied into private memory first. If the page is watched, watcher is told
+   * about the write. Both cases share a single check, so that ordinary writes stay cheap.
+   *
+   * @param address address in range 0x000-0xFFF inclusive
+   * @param value byte to write
+   */
+  void write(unsigned int address, unsigned char value) {
+	if ((hot.slow_pages >> (address / PAGE_SIZE)) & 1u)
+	  prepare_write(address, value);
+	hot.written_pages |= static_cast<std::uint16_t>(1u << (address / PAGE_SIZE));
+	mem[address] = value;
+  }
+
+  /**
+   * \brief Writes byte pointed to by I or derived from it.
+   *
+   * Unlike write, reaches XO-CHIP memory above MEMORY_SIZE. Code can't run from there, so only writes below
+   * MEMORY_SIZE are tracked.
+   *
+   * @param address address less than memory_size()
+   * @param value byte to write
+   */
+  void write_data(unsigned int address, unsigned char value) {
+	if (address < MEMORY_SIZE)
+	  write(address, value);
+	else
+	  extended[address - MEMORY_SIZE] = value;
+  }
+
+  /**
+   * \brief Skips next instruction.
+   *
+   * In XO-CHIP mode F000 nnnn is skipped as a whole, so both of its words are skipped.
+   */
+  void skip() {
+	hot.PC += 4;
+	if (hot.xo_chip && hot.PC <= MEMORY_SIZE && read(hot.PC - 2u) == 0xF0 && read(hot.PC - 1u) == 0x00)
+	  hot.PC += 2;
+  }
+
+  /**
+   * \brief Slow path of write, unshares the page and notifies watcher.
+   */
+  void prepare_write(unsigned int address, unsigned char value);
+
+  /**
+   * \brief Copies shared page into private memory and starts reading it from there.
+   *
+   * @param page page number
+   */
+  void unshare_page(unsigned int page);
+
+  /**
+   * \brief Gets where page is currently read from.
+   *
+   * @param page page number
+   * @return first byte of the page in shared image or private memory
+   */
+  [[nodiscard]] const unsigned char *page_data(unsigned int page) const {
+	return ((hot.shared_pages >> page) & 1u ? hot.image : mem.data()) + page * PAGE_SIZE;
+  }
+
+  /**
+   * \brief Points every page at private memory or shared image and copies private pages from other cpu.
+   *
+   * @param other cpu which memory is copied
    */
-  unsigned short get_opcode();
+  void copy_memory(const CPU &other);
+
+  /**
+   * \brief Draws one row of a sprite.
+   *
+   * Whole row is xored in at once. Sprite columns past the right edge are wrapped or clipped according to wrapping
+   * flag.
+   *
+   * @param plane plane drawn to
+   * @param y display row, must be visible
+   * @param x column of the leftmost sprite pixel, must be visible
+   * @param bits sprite row, most significant of width bits is the leftmost pixel
+   * @param width 8 or 16
+   * @return true when any pixel was turned off
+   */
+  bool draw_row(unsigned int plane, unsigned int y, unsigned int x, std::uint32_t bits, unsigned int width);
+
+  /**
+   * \brief Switches resolution and clears the display.
+   */
+  void set_high_resolution(bool enabled);
 
   /**
    * \brief Execute given opcode.
@@ -67,13 +327,6 @@ class CPU {
   void execute(unsigned short opcode);
 
 public:
-  /** \brief Load store quirk flag. When set uses quirked behavior of instructions Fx55 and Fx65. */
-  bool load_store_quirk;
-  /** \brief Shift quirk flag. When set uses quirked behavior of instructions 8xy6 and 8xyE. */
-  bool shift_quirk;
-  /** \brief Wrapping flag. When set pixels outside of the screen are wrapped around to show on the screen.*/
-  bool wrapping;
-
   /**
    * \brief Initializes CPU.
    *
@@ -85,16 +338,110 @@ public:
    */
   explicit CPU(bool load_store_quirk = false, bool shift_quirk = false, bool wrapping = true);
 
+  /**
+   * \brief Initializes CPU with memory shared with other cpus.
+   *
+   * Memory is read from the image until a page is written to, then only this page is copied into cpu's private
+   * memory. Cpus running the same rom can share one image, so they touch only the pages they actually modified.
+   *
+   * @param image fonts and rom shared between cpus
+   * @param load_store_quirk initial load store quirk flag
+   * @param shift_quirk initial shift quirk flag
+   * @param wrapping initial wrapping flag
+   */
+  explicit CPU(std::shared_ptr<const MemoryImage> image, bool load_store_quirk = false, bool shift_quirk = false,
+			   bool wrapping = true);
+
+  /**
+   * \brief Copies CPU.
+   *
+   * Shared pages stay shared, only private pages are copied. Copying is cheap for cpus with shared image which
+   * modified few pages, so it can be used for forking and snapshots.
+   *
+   * @param other cpu to copy
+   */
+  CPU(const CPU &other);
+  CPU &operator=(const CPU &other);
+
+  /**
+   * \brief Sets quirk flags.
+   *
+   * @param load_store_quirk when set uses quirked behavior of instructions Fx55 and Fx65
+   * @param shift_quirk when set uses quirked behavior of instructions 8xy6 and 8xyE
+   * @param wrapping when set pixels outside of the screen are wrapped around to show on the screen
+   */
+  void set_quirks(bool load_store_quirk, bool shift_quirk, bool wrapping) {
+	hot.load_store_quirk = load_store_quirk;
+	hot.shift_quirk = shift_quirk;
+	hot.wrapping = wrapping;
+  }
+
+  /** \brief Load store quirk flag. When set uses quirked behavior of instructions Fx55 and Fx65. */
+  [[nodiscard]] bool load_store_quirk() const { return hot.load_store_quirk; }
+
+  /** \brief Shift quirk flag. When set uses quirked behavior of instructions 8xy6 and 8xyE. */
+  [[nodiscard]] bool shift_quirk() const { return hot.shift_quirk; }
+
+  /** \brief Wrapping flag. When set pixels outside of the screen are wrapped around to show on the screen.*/
+  [[nodiscard]] bool wrapping() const { return hot.wrapping; }
+
+  /**
+   * \brief Resets CPU to the state right after construction.
+   *
+   * Registers, stack, timers, keyboard and display are cleared and memory is restored to fonts only, or to the
+   * shared image. Random number generator starts again from the last seed, quirk flags are kept. Doesn't allocate, so
+   * it's cheaper than constructing a new cpu.
+   */
+  void reset();
+
+  /**
+   * \brief Captures whole state of the cpu.
+   *
+   * @return copy of memory, registers, display and timers
+   */
+  [[nodiscard]] CPUState state() const;
+
+  /**
+   * \brief Continues from captured state.
+   *
+   * Only pages which differ from the current memory stop being shared. Writes aren't reported to the watcher, but
+   * every page is marked as written, so cached code is dropped. Throws runtime error when state was captured in
+   * different memory size i.e. with different XO-CHIP mode.
+   *
+   * @param state state captured by state()
+   */
+  void restore(const CPUState &state);
+
   /**
    * \brief Load rom into the memory.
    *
    * Copies rom into memory starting at address 0x200. Addresses in range 0x000 to 0x1FF are reserved. Throws
-   * runtime error if rom won't fit into memory.
+   * runtime error if rom won't fit into memory. In XO-CHIP mode rom can fill the whole 64 KB address space.
    *
    * @param rom array of 8-bit numbers representing a rom
    */
   void load_rom(const std::vector<unsigned char> &rom);
 
+  /**
+   * \brief Load rom into the memory.
+   *
+   * Same as load_rom taking vector, but copies straight from any buffer, e.g. memory mapped file.
+   *
+   * @param rom pointer to the first byte of the rom
+   * @param size size of the rom in bytes
+   */
+  void load_rom(const unsigned char *rom, std::size_t size);
+
+  /**
+   * \brief Gets opcode for current cycle.
+   *
+   * Merges two 8-bit numbers to create 16-bit opcode. More significant part is at the PC address and less significant
+   * is at PC + 1 address. If PC or PC+1 point outside of memory runtime error is thrown.
+   *
+   * @return 16-bit opcode
+   */
+  [[nodiscard]] unsigned short get_opcode() const;
+
   /**
    * \brief Executes one cpu cycle.
    *
@@ -118,32 +465,286 @@ public:
   void update_timers();
 
   /**
-   * \brief Get/Set key.
+   * \brief Set key.
    *
-   * Returns a reference to bool telling if key is pressed or not. Id parameter represents key number. Chip8 has
-   * 16-key keyboard that means id must be in range 0-15 inclusive.
+   * Marks key as pressed or released. Id parameter represents key number. Chip8 has 16-key keyboard that means id
+   * must be in range 0-15 inclusive, otherwise runtime error is thrown. Pressing a key ends waiting in Fx0A.
    *
    * @param id value in range 0-15 inclusive
-   * @return is key pressed
+   * @param value is key pressed
    */
-  bool &key(unsigned int id);
+  void set_key(unsigned int id, bool value);
+
+  /**
+   * \brief Set state of the whole keyboard.
+   *
+   * Any pressed key ends waiting in Fx0A.
+   *
+   * @param mask 16-bit mask where bit n is set when key n is pressed
+   */
+  void set_keys(std::uint16_t mask) {
+	hot.keyboard = mask;
+	if (mask)
+	  hot.waiting = false;
+  }
+
+  /**
+   * \brief Get key.
+   *
+   * @param id value in range 0-15 inclusive
+   * @return is key pressed, false for ids outside of the keyboard
+   */
+  [[nodiscard]] bool key(unsigned int id) const { return id < KEYBOARD_SIZE && (hot.keyboard >> id) & 1u; }
+
+  /**
+   * \brief Get state of the whole keyboard.
+   *
+   * @return 16-bit mask where bit n is set when key n is pressed
+   */
+  [[nodiscard]] std::uint16_t keys() const { return hot.keyboard; }
 
   /**
    * \brief Get reference to display.
    *
-   * Returns const reference to a array representing Chip8's display. Each value in the array represents a pixel
-   * starting from top-left corner. If value of a pixel is true it means it is on, otherwise it's off.
+   * Each row is packed into DisplayRow, starting from the top. Rows and pixels outside of the current resolution are
+   * always off, so displays can be compared directly.
    *
    * @return Reference to array representing the display.
    */
-  const std::array<bool, SCREEN_WIDTH * SCREEN_HEIGHT> &get_display();
+  [[nodiscard]] const Display &get_display() const { return planes[0]; }
+
+  /**
+   * \brief Get all XO-CHIP planes, the first one is the display of CHIP-8 and SCHIP.
+   */
+  [[nodiscard]] const std::array<Display, N_PLANES> &get_planes() const { return planes; }
+
+  /**
+   * \brief Get pixel of the display.
+   *
+   * @param x column, less than display_width()
+   * @param y row, less than display_height()
+   * @return is the pixel on
+   */
+  [[nodiscard]] bool pixel(unsigned int x, unsigned int y) const { return pixel(0, x, y); }
+
+  /**
+   * \brief Get pixel of given plane.
+   *
+   * @param plane plane less than N_PLANES
+   * @param x column, less than display_width()
+   * @param y row, less than display_height()
+   * @return is the pixel on
+   */
+  [[nodiscard]] bool pixel(unsigned int plane, unsigned int x, unsigned int y) const {
+	const DisplayRow &row = planes[plane][y];
+	return x < 64 ? (row.left >> (63u - x)) & 1u : (row.right >> (127u - x)) & 1u;
+  }
+
+  /**
+   * \brief Get color of the pixel combined from all planes.
+   *
+   * @return bit n is set when the pixel is on in plane n, so 0 or 1 outside of XO-CHIP
+   */
+  [[nodiscard]] unsigned int color(unsigned int x, unsigned int y) const {
+	return static_cast<unsigned int>(pixel(0, x, y)) | static_cast<unsigned int>(pixel(1, x, y)) << 1u;
+  }
+
+  /**
+   * \brief Is the program blocked in Fx0A waiting for a key.
+   *
+   * Executing the cpu while it waits changes nothing but the cycle count, so callers may only update timers until a
+   * key is pressed with set_key or set_keys. Waiting starts when Fx0A is executed without any pressed key.
+   */
+  [[nodiscard]] bool waiting_for_key() const { return hot.waiting; }
+
+  /** \brief Is SCHIP high resolution mode on. */
+  [[nodiscard]] bool hires() const { return hot.high_resolution; }
+
+  /** \brief Width of the display in the current resolution. */
+  [[nodiscard]] unsigned int display_width() const { return hot.high_resolution ? HIRES_WIDTH : SCREEN_WIDTH; }
+
+  /** \brief Height of the display in the current resolution. */
+  [[nodiscard]] unsigned int display_height() const { return hot.high_resolution ? HIRES_HEIGHT : SCREEN_HEIGHT; }
+
+  /**
+   * \brief Switches XO-CHIP mode.
+   *
+   * Turning it on adds 60 KB of cleared memory reachable through I, enables XO-CHIP instructions and makes skips step
+   * over F000 nnnn as a whole. Should be set before loading the rom. Kept by reset.
+   *
+   * @param enabled is XO-CHIP mode on
+   */
+  void set_xo_chip(bool enabled);
+
+  /** \brief Is XO-CHIP mode on. */
+  [[nodiscard]] bool xo() const { return hot.xo_chip; }
+
+  /**
+   * \brief Switches SUPER-CHIP mode.
+   *
+   * Turning it on enables 00Cn, 00FB, 00FC, 00FD, 00FE and 00FF and makes Dxy0 draw 16x16 sprite. Off, they're unknown
+   * opcodes and Dxy0 draws nothing like on the original CHIP-8. XO-CHIP mode enables them as well. Kept by reset.
+   *
+   * @param enabled is SUPER-CHIP mode on
+   */
+  void set_schip(bool enabled);
+
+  /** \brief Is SUPER-CHIP mode on, on its own or as part of XO-CHIP. */
+  [[nodiscard]] bool schip() const { return hot.schip || hot.xo_chip; }
+
+  /** \brief Instruction set the cpu decodes. */
+  [[nodiscard]] Mode mode() const { return mode_of(hot.schip, hot.xo_chip); }
+
+  /** \brief Size of memory reachable through I, MEMORY_SIZE or XO_MEMORY_SIZE in XO-CHIP mode. */
+  [[nodiscard]] unsigned int memory_size() const {
+	return MEMORY_SIZE + static_cast<unsigned int>(extended.size());
+  }
+
+  /** \brief Planes drawn to, bit n is set when plane n is selected. */
+  [[nodiscard]] unsigned char selected_planes() const { return hot.plane_mask; }
+
+  /** \brief Has XO-CHIP program loaded audio pattern with F002. */
+  [[nodiscard]] bool audio_pattern_loaded() const { return has_pattern; }
+
+  /** \brief XO-CHIP audio pattern, played from the most significant bit of the first byte. */
+  [[nodiscard]] const std::array<unsigned char, AUDIO_PATTERN_SIZE> &audio_pattern() const { return pattern; }
+
+  /** \brief XO-CHIP pitch, pattern is played at 4000 * 2 ^ ((pitch - 64) / 48) bits per second. */
+  [[nodiscard]] unsigned char audio_pitch() const { return pitch; }
+
+  /**
+   * \brief Has the program exited with 00FD.
+   *
+   * Exited program keeps executing the exit instruction without any effect.
+   */
+  [[nodiscard]] bool exited() const { return halted; }
+
+  /**
+   * \brief Seeds random number generator used by Cxkk instruction.
+   *
+   * Two cpus with the same seed, rom and input produce exactly the same results. Seed is kept by reset, which
+   * restarts the sequence.
+   *
+   * @param seed any 32-bit number
+   */
+  void seed_random(std::uint32_t seed);
+
+  /**
+   * \brief Gets number of pages still read from shared image.
+   *
+   * @return 0 for cpus without shared image
+   */
+  [[nodiscard]] unsigned int shared_page_count() const;
+
+  /**
+   * \brief Packs display into bits.
+   *
+   * Each row of the display is written as 8 bytes, most significant bit of the first byte is the leftmost pixel.
+   * Always packs 64x32 pixels, in high resolution mode a pixel is on when any of the 2x2 pixels it covers is on.
+   * XO-CHIP planes are merged, pixel is on when it's on in any plane.
+   *
+   * @param out buffer of at least SCREEN_WIDTH * SCREEN_HEIGHT / 8 bytes
+   */
+  void pack_display(unsigned char *out) const;
 
   /**
    * Get sound timer value.
    *
    * @return Value stored in ST register.
    */
-  [[nodiscard]] unsigned char sound_timer() const { return ST; }
+  [[nodiscard]] unsigned char sound_timer() const { return hot.ST; }
+
+  /**
+   * \brief Reads byte from memory.
+   *
+   * Private pages are read straight from memory, shared ones from the image. A cpu without a shared image has no
+   * shared pages and always reads memory.
+   *
+   * @param address address in range 0x000-0xFFF inclusive
+   * @return byte at given address
+   */
+  [[nodiscard]] unsigned char read(unsigned int address) const {
+	if ((hot.shared_pages >> (address / PAGE_SIZE)) & 1u)
+	  return hot.image[address];
+	return mem[address];
+  }
+
+  /**
+   * \brief Reads byte pointed to by I or derived from it.
+   *
+   * Unlike read, reaches XO-CHIP memory above MEMORY_SIZE.
+   *
+   * @param address address less than memory_size()
+   * @return byte at given address
+   */
+  [[nodiscard]] unsigned char read_data(unsigned int address) const {
+	return address < MEMORY_SIZE ? read(address) : extended[address - MEMORY_SIZE];
+  }
+
+  /**
+   * \brief Reports writes to given pages to watcher.
+   *
+   * Writes to other pages don't pay for watching at all.
+   *
+   * @param watched mask where bit n is set when page n is watched, 0 stops watching
+   * @param write_watcher watcher which must outlive the cpu or stop watching first
+   */
+  void watch_writes(std::uint16_t watched, WriteWatcher *write_watcher);
+
+  /**
+   * \brief Records every executed instruction into trace buffer.
+   *
+   * @param buffer buffer which must outlive the cpu, nullptr stops tracing
+   */
+  void attach_trace(TraceBuffer *buffer) { hot.trace = buffer; }
+
+  /**
+   * \brief Gets attached trace buffer, nullptr when tracing is off.
+   */
+  [[nodiscard]] TraceBuffer *trace_buffer() const { return hot.trace; }
+
+  /**
+   * \brief Records instruction at PC into attached trace buffer, if any.
+   *
+   * Called by engines executing the cpu right before the instruction.
+   *
+   * @param opcode instruction about to be executed
+   */
+  void record_trace(unsigned short opcode) {
+	if (hot.trace)
+	  hot.trace->record(hot.PC, opcode, hot.I, hot.reg[0xF], hot.SP);
+  }
+
+  /**
+   * \brief Gets pages written since the last call and forgets them.
+   *
+   * Lets code caching decoded instructions notice modified memory.
+   *
+   * @return mask where bit n is set when page n was written
+   */
+  std::uint16_t take_written_pages() {
+	std::uint16_t result = hot.written_pages;
+	hot.written_pages = 0;
+	return result;
+  }
+
+  /** \brief Get program counter value. */
+  [[nodiscard]] unsigned short pc() const { return hot.PC; }
+
+  /** \brief Get index register value. */
+  [[nodiscard]] unsigned short index() const { return hot.I; }
+
+  /** \brief Get stack pointer value. */
+  [[nodiscard]] unsigned char sp() const { return hot.SP; }
+
+  /** \brief Get delay timer value. */
+  [[nodiscard]] unsigned char delay_timer() const { return hot.DT; }
+
+  /** \brief Get values of registers V0 through VF. */
+  [[nodiscard]] const std::array<unsigned char, N_REGISTERS> &registers() const { return hot.reg; }
+
+  /** \brief Get return addresses on the stack, only first sp() are in use. */
+  [[nodiscard]] const std::array<unsigned short, STACK_SIZE> &call_stack() const { return stack; }
 };
 }
 
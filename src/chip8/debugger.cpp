@@ -0,0 +1,133 @@
+#include <algorithm>
+#include "debugger.hpp"
+
+Chip8::Debugger::Debugger(CPU &cpu) : cpu(cpu), engine(cpu) {}
+
+Chip8::Debugger::~Debugger() {
+  cpu.watch_writes(0, nullptr);
+}
+
+void Chip8::Debugger::add_breakpoint(unsigned int address) {
+  engine.set_trap(address, true);
+  if (std::find(breakpoints.cbegin(), breakpoints.cend(), address) == breakpoints.cend())
+	breakpoints.push_back(address);
+}
+
+void Chip8::Debugger::remove_breakpoint(unsigned int address) {
+  auto breakpoint = std::find(breakpoints.begin(), breakpoints.end(), address);
+  if (breakpoint == breakpoints.end())
+	return;
+
+  breakpoints.erase(breakpoint);
+  engine.set_trap(address, false);
+}
+
+void Chip8::Debugger::add_watchpoint(unsigned int first, unsigned int last) {
+  if (first > last || last >= MEMORY_SIZE)
+	throw std::runtime_error("invalid watchpoint range");
+
+  watchpoints.push_back(Watchpoint{first, last});
+  update_watched_pages();
+}
+
+void Chip8::Debugger::remove_watchpoint(unsigned int first, unsigned int last) {
+  auto watchpoint = std::find_if(watchpoints.begin(), watchpoints.end(), [&](const Watchpoint &w) {
+	return w.first == first && w.last == last;
+  });
+  if (watchpoint == watchpoints.end())
+	return;
+
+  watchpoints.erase(watchpoint);
+  update_watched_pages();
+}
+
+void Chip8::Debugger::update_watched_pages() {
+  std::uint16_t watched = 0;
+  for (const auto &watchpoint : watchpoints) {
+	for (unsigned int page = watchpoint.first / PAGE_SIZE; page <= watchpoint.last / PAGE_SIZE; page++)
+	  watched = static_cast<std::uint16_t>(watched | (1u << page));
+  }
+  cpu.watch_writes(watched, watched ? this : nullptr);
+}
+
+void Chip8::Debugger::add_condition(Condition condition) {
+  conditions.push_back(std::move(condition));
+}
+
+void Chip8::Debugger::clear_conditions() {
+  conditions.clear();
+}
+
+void Chip8::Debugger::written(unsigned int address, unsigned char) {
+  // pages are watched as a whole, only the exact ranges count
+  for (const auto &watchpoint : watchpoints) {
+	if (address >= watchpoint.first && address <= watchpoint.last) {
+	  // instruction can write several bytes, report the first one
+	  if (!watch_hit)
+		hit_address = address;
+	  watch_hit = true;
+	  return;
+	}
+  }
+}
+
+bool Chip8::Debugger::check_conditions() const {
+  return std::any_of(conditions.cbegin(), conditions.cend(), [&](const Condition &c) { return c(cpu); });
+}
+
+Chip8::StopReason Chip8::Debugger::step() {
+  watch_hit = false;
+  engine.step();
+  executed++;
+
+  if (watch_hit)
+	return StopReason::WATCHPOINT;
+  if (check_conditions())
+	return StopReason::CONDITION;
+  return StopReason::FINISHED;
+}
+
+Chip8::StopReason Chip8::Debugger::run(std::uint64_t cycles) {
+  if (cycles == 0)
+	return StopReason::FINISHED;
+
+  StopReason reason = step();
+  if (reason != StopReason::FINISHED)
+	return reason;
+
+  // pick a loop which checks only what is set
+  bool watch = !watchpoints.empty();
+  bool check = !conditions.empty();
+  if (watch && check)
+	return run_loop<true, true>(cycles - 1);
+  if (watch)
+	return run_loop<true, false>(cycles - 1);
+  if (check)
+	return run_loop<false, true>(cycles - 1);
+  return run_loop<false, false>(cycles - 1);
+}
+
+template<bool Watch, bool Check>
+Chip8::StopReason Chip8::Debugger::run_loop(std::uint64_t cycles) {
+  for (std::uint64_t i = 0; i < cycles; i++) {
+	if (!engine.cycle())
+	  return StopReason::BREAKPOINT;
+	executed++;
+
+	if (Watch && watch_hit)
+	  return StopReason::WATCHPOINT;
+	if (Check && check_conditions())
+	  return StopReason::CONDITION;
+  }
+  return StopReason::FINISHED;
+}
+
+Chip8::Debugger::Condition Chip8::register_equals(unsigned int x, unsigned char value) {
+  if (x >= N_REGISTERS)
+	throw std::runtime_error("no such register");
+  return [x, value](const CPU &cpu) { return cpu.registers()[x] == value; };
+}
+
+Chip8::Debugger::Condition Chip8::index_in_range(unsigned int first, unsigned int last) {
+  return [first, last](const CPU &cpu) { return cpu.index() >= first && cpu.index() <= last; };
+}
@@ -0,0 +1,146 @@
+#ifndef CHIP8_EMU_CPP_DEBUGGER_HPP
+#define CHIP8_EMU_CPP_DEBUGGER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "cpu.hpp"
+#include "predecoded.hpp"
+
+namespace Chip8 {
+/**
+ * \brief Why Debugger stopped running the cpu.
+ */
+enum class StopReason {
+  FINISHED, //!< Requested number of cycles was executed.
+  BREAKPOINT, //!< PC reached a breakpoint, instruction at the breakpoint wasn't executed yet.
+  WATCHPOINT, //!< Last instruction wrote into watched memory.
+  CONDITION //!< Condition became true after last instruction.
+};
+
+/**
+ * \brief Runs cpu with breakpoints, memory watchpoints and conditions.
+ *
+ * Breakpoints are trapped addresses of PredecodedEngine, memory watchpoints are pages watched by the cpu, so neither
+ * costs anything per instruction until it's hit. Conditions have to be evaluated after every instruction, so the cpu
+ * runs slower only while there are any.
+ *
+ * Debugger runs only instructions, timers are left to the caller.
+ */
+class Debugger : public WriteWatcher {
+public:
+  /**
+   * \brief Condition checked after every instruction.
+   */
+  using Condition = std::function<bool(const CPU &)>;
+
+private:
+  struct Watchpoint {
+	unsigned int first;
+	unsigned int last;
+  };
+
+  CPU &cpu;
+  PredecodedEngine engine;
+  std::vector<unsigned int> breakpoints;
+  std::vector<Watchpoint> watchpoints;
+  std::vector<Condition> conditions;
+  bool watch_hit = false;
+  unsigned int hit_address = 0;
+  std::uint64_t executed = 0;
+
+  void update_watched_pages();
+  bool check_conditions() const;
+
+  template<bool Watch, bool Check>
+  StopReason run_loop(std::uint64_t cycles);
+
+public:
+  /**
+   * \brief Attaches to cpu.
+   *
+   * @param cpu cpu to debug, must outlive the debugger
+   */
+  explicit Debugger(CPU &cpu);
+  Debugger(const Debugger &) = delete;
+  Debugger &operator=(const Debugger &) = delete;
+  ~Debugger() override;
+
+  /**
+   * \brief Stops before executing instruction at given address.
+   */
+  void add_breakpoint(unsigned int address);
+
+  /**
+   * \brief Removes breakpoint, does nothing if there isn't one.
+   */
+  void remove_breakpoint(unsigned int address);
+
+  /**
+   * \brief Stops after an instruction writes into given memory range.
+   *
+   * @param first first watched address
+   * @param last last watched address, inclusive
+   */
+  void add_watchpoint(unsigned int first, unsigned int last);
+
+  /**
+   * \brief Removes watchpoint with exactly the same range, does nothing if there isn't one.
+   */
+  void remove_watchpoint(unsigned int first, unsigned int last);
+
+  /**
+   * \brief Stops after an instruction makes condition true.
+   */
+  void add_condition(Condition condition);
+
+  /**
+   * \brief Removes all conditions.
+   */
+  void clear_conditions();
+
+  /**
+   * \brief Executes single instruction, even if there's breakpoint at PC.
+   *
+   * @return WATCHPOINT or CONDITION if the instruction hit one, FINISHED otherwise
+   */
+  StopReason step();
+
+  /**
+   * \brief Runs cpu until something stops it.
+   *
+   * Instruction at PC is executed even if there's breakpoint at it, so that run can continue from a breakpoint.
+   *
+   * @param cycles maximum number of instructions to execute
+   * @return why the cpu stopped
+   */
+  StopReason run(std::uint64_t cycles);
+
+  /**
+   * \brief First watched address written by the instruction which caused the last WATCHPOINT stop.
+   */
+  [[nodiscard]] unsigned int watch_address() const { return hit_address; }
+
+  /**
+   * \brief Number of instructions executed by the debugger.
+   */
+  [[nodiscard]] std::uint64_t cycle_count() const { return executed; }
+
+  void written(unsigned int address, unsigned char value) override;
+};
+
+/**
+ * \brief Condition true when register VX holds value.
+ */
+Debugger::Condition register_equals(unsigned int x, unsigned char value);
+
+/**
+ * \brief Condition true when I register points into range, i.e. I watchpoint.
+ *
+ * @param first first address
+ * @param last last address, inclusive
+ */
+Debugger::Condition index_in_range(unsigned int first, unsigned int last);
+}
+
+#endif //CHIP8_EMU_CPP_DEBUGGER_HPP
@@ -0,0 +1,95 @@
+#include "disassembler.hpp"
+#include "instructions.hpp"
+
+namespace {
+std::string hex(unsigned int value, unsigned int digits) {
+  const char *chars = "0123456789ABCDEF";
+  std::string result = "0x" + std::string(digits, '0');
+  for (unsigned int i = 0; i < digits; i++)
+	result[result.size() - 1 - i] = chars[(value >> (4 * i)) & 0xFu];
+  return result;
+}
+
+std::string v(unsigned int id) {
+  const char *chars = "0123456789ABCDEF";
+  return std::string("V") + chars[id & 0xFu];
+}
+}
+
+std::string Chip8::disassemble(unsigned short opcode, Mode mode) {
+  unsigned int x = (opcode & 0x0F00u) >> 8u;
+  unsigned int y = (opcode & 0x00F0u) >> 4u;
+  unsigned int n = opcode & 0x000Fu;
+  unsigned int kk = opcode & 0x00FFu;
+  unsigned int nnn = opcode & 0x0FFFu;
+
+  switch (Instruction::decode(opcode, mode)) {
+  case ID_0000:return "NOP";
+  case ID_00E0:return "CLS";
+  case ID_00EE:return "RET";
+  case ID_00Cn:return "SCD " + std::to_string(n);
+  case ID_00FB:return "SCR";
+  case ID_00FC:return "SCL";
+  case ID_00FD:return "EXIT";
+  case ID_00FE:return "LOW";
+  case ID_00FF:return "HIGH";
+  case ID_1nnn:return "JP " + hex(nnn, 3);
+  case ID_2nnn:return "CALL " + hex(nnn, 3);
+  case ID_3xkk:return "SE " + v(x) + ", " + hex(kk, 2);
+  case ID_4xkk:return "SNE " + v(x) + ", " + hex(kk, 2);
+  case ID_5xy0:return "SE " + v(x) + ", " + v(y);
+  case ID_5xy2:return "SAVE " + v(x) + " - " + v(y);
+  case ID_5xy3:return "LOAD " + v(x) + " - " + v(y);
+  case ID_6xkk:return "LD " + v(x) + ", " + hex(kk, 2);
+  case ID_7xkk:return "ADD " + v(x) + ", " + hex(kk, 2);
+  case ID_8xy0:return "LD " + v(x) + ", " + v(y);
+  case ID_8xy1:return "OR " + v(x) + ", " + v(y);
+  case ID_8xy2:return "AND " + v(x) + ", " + v(y);
+  case ID_8xy3:return "XOR " + v(x) + ", " + v(y);
+  case ID_8xy4:return "ADD " + v(x) + ", " + v(y);
+  case ID_8xy5:return "SUB " + v(x) + ", " + v(y);
+  case ID_8xy6:return "SHR " + v(x) + ", " + v(y);
+  case ID_8xy7:return "SUBN " + v(x) + ", " + v(y);
+  case ID_8xyE:return "SHL " + v(x) + ", " + v(y);
+  case ID_9xy0:return "SNE " + v(x) + ", " + v(y);
+  case ID_Annn:return "LD I, " + hex(nnn, 3);
+  case ID_Bnnn:return "JP V0, " + hex(nnn, 3);
+  case ID_Cxkk:return "RND " + v(x) + ", " + hex(kk, 2);
+  case ID_Dxyn:return "DRW " + v(x) + ", " + v(y) + ", " + std::to_string(n);
+  case ID_Ex9E:return "SKP " + v(x);
+  case ID_ExA1:return "SKNP " + v(x);
+  case ID_F000:return "LD I, LONG";
+  case ID_Fn01:return "PLANE " + std::to_string(x);
+  case ID_F002:return "AUDIO";
+  case ID_Fx07:return "LD " + v(x) + ", DT";
+  case ID_Fx0A:return "LD " + v(x) + ", K";
+  case ID_Fx15:return "LD DT, " + v(x);
+  case ID_Fx18:return "LD ST, " + v(x);
+  case ID_Fx1E:return "ADD I, " + v(x);
+  case ID_Fx29:return "LD F, " + v(x);
+  case ID_Fx33:return "LD B, " + v(x);
+  case ID_Fx3A:return "PITCH " + v(x);
+  case ID_Fx55:return "LD [I], " + v(x);
+  case ID_Fx65:return "LD " + v(x) + ", [I]";
+  default:return "DW " + hex(opcode, 4);
+  }
+}
+
+std::vector<std::string> Chip8::disassemble_window(const CPU &cpu, unsigned int address, unsigned int before,
+												   unsigned int after) {
+  std::vector<std::string> lines;
+
+  for (unsigned int i = 0; i <= before + after; i++) {
+	if (address + 2 * i < 2 * before)
+	  continue;
+	unsigned int line_address = address + 2 * i - 2 * before;
+	if (line_address + 1 >= MEMORY_SIZE)
+	  break;
+
+	auto opcode = static_cast<unsigned short>((cpu.read(line_address) << 8u) | cpu.read(line_address + 1));
+	lines.push_back((line_address == address ? "-> " : "   ") + hex(line_address, 3) + "  " + opcode_string(opcode)
+						+ "  " + disassemble(opcode, cpu.mode()));
+  }
+
+  return lines;
+}
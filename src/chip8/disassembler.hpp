@@ -0,0 +1,37 @@
+#ifndef CHIP8_EMU_CPP_DISASSEMBLER_HPP
+#define CHIP8_EMU_CPP_DISASSEMBLER_HPP
+
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+
+namespace Chip8 {
+/**
+ * \brief Disassembles single opcode.
+ *
+ * Uses mnemonics from Cowgod's Chip-8 technical reference, e.g. "LD V1, 0x2A" for 0x612A. Opcodes without
+ * instruction are shown as data, e.g. "DW 0xFFFF", as are instructions of extensions the mode lacks.
+ *
+ * @param opcode 16-bit opcode
+ * @param mode instruction set of the cpu
+ * @return human readable instruction
+ */
+std::string disassemble(unsigned short opcode, Mode mode);
+
+/**
+ * \brief Disassembles instructions around given address.
+ *
+ * Each line contains address, opcode and instruction, line at the given address is marked with an arrow. Addresses
+ * outside of memory are skipped.
+ *
+ * @param cpu cpu which memory is disassembled
+ * @param address address to disassemble around
+ * @param before number of instructions before the address
+ * @param after number of instructions after the address
+ * @return one line per instruction
+ */
+std::vector<std::string> disassemble_window(const CPU &cpu, unsigned int address, unsigned int before = 4,
+											unsigned int after = 4);
+}
+
+#endif //CHIP8_EMU_CPP_DISASSEMBLER_HPP
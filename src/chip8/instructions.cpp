@@ -1,203 +1,420 @@
-#include <cstdlib>
+#include <algorithm>
+#include <limits>
 #include "instructions.hpp"
 
+namespace {
+/**
+ * Returns number of the lowest pressed key in non-zero keyboard mask.
+ */
+unsigned lowest_key(std::uint16_t keys) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_ctz(keys));
+#else
+  unsigned id = 0;
+  while (!((keys >> id) & 1u))
+	id++;
+  return id;
+#endif
+}
+}
+
+const std::array<Chip8::Handler, Chip8::N_INSTRUCTIONS> Chip8::Instruction::HANDLERS = {
+	nullptr,
+	i_0000, i_00E0, i_00EE, i_00Cn, i_00FB,
+	i_00FC, i_00FD, i_00FE, i_00FF, i_1nnn,
+	i_2nnn, i_3xkk, i_4xkk, i_5xy0, i_5xy2,
+	i_5xy3, i_6xkk, i_7xkk, i_8xy0, i_8xy1,
+	i_8xy2, i_8xy3, i_8xy4, i_8xy5, i_8xy6,
+	i_8xy7, i_8xyE, i_9xy0, i_Annn, i_Bnnn,
+	i_Cxkk, i_Dxyn, i_Ex9E, i_ExA1, i_F000,
+	i_Fn01, i_F002, i_Fx07, i_Fx0A, i_Fx15,
+	i_Fx18, i_Fx1E, i_Fx29, i_Fx33, i_Fx3A,
+	i_Fx55, i_Fx65,
+};
+
+const std::array<const char *, Chip8::N_INSTRUCTIONS> Chip8::Instruction::NAMES = {
+	"????",
+	"0000", "00E0", "00EE", "00Cn", "00FB", "00FC", "00FD",
+	"00FE", "00FF", "1nnn", "2nnn", "3xkk", "4xkk", "5xy0",
+	"5xy2", "5xy3", "6xkk", "7xkk", "8xy0", "8xy1", "8xy2",
+	"8xy3", "8xy4", "8xy5", "8xy6", "8xy7", "8xyE", "9xy0",
+	"Annn", "Bnnn", "Cxkk", "Dxyn", "Ex9E", "ExA1", "F000",
+	"Fn01", "F002", "Fx07", "Fx0A", "Fx15", "Fx18", "Fx1E",
+	"Fx29", "Fx33", "Fx3A", "Fx55", "Fx65",
+};
+
+Chip8::InstructionId Chip8::Instruction::decode(unsigned short opcode, Mode mode) {
+  bool schip = mode != Mode::CHIP8;
+  bool xo_chip = mode == Mode::XO_CHIP;
+
+  switch ((opcode & 0xF000u) >> 12u) {
+  case 0x0: {
+	switch (opcode) {
+	case 0x0000:return ID_0000;
+	case 0x00E0:return ID_00E0;
+	case 0x00EE:return ID_00EE;
+	case 0x00FB:return schip ? ID_00FB : UNKNOWN;
+	case 0x00FC:return schip ? ID_00FC : UNKNOWN;
+	case 0x00FD:return schip ? ID_00FD : UNKNOWN;
+	case 0x00FE:return schip ? ID_00FE : UNKNOWN;
+	case 0x00FF:return schip ? ID_00FF : UNKNOWN;
+	default:break;
+	}
+	if (schip && (opcode & 0xFFF0u) == 0x00C0)
+	  return ID_00Cn;
+	break;
+  }
+  case 0x1:return ID_1nnn;
+  case 0x2:return ID_2nnn;
+  case 0x3:return ID_3xkk;
+  case 0x4:return ID_4xkk;
+  case 0x5: {
+	switch (opcode & 0x000Fu) {
+	case 0x0:return ID_5xy0;
+	case 0x2:return xo_chip ? ID_5xy2 : UNKNOWN;
+	case 0x3:return xo_chip ? ID_5xy3 : UNKNOWN;
+	default:break;
+	}
+	break;
+  }
+  case 0x6:return ID_6xkk;
+  case 0x7:return ID_7xkk;
+  case 0x8: {
+	switch (opcode & 0x000Fu) {
+	case 0x0:return ID_8xy0;
+	case 0x1:return ID_8xy1;
+	case 0x2:return ID_8xy2;
+	case 0x3:return ID_8xy3;
+	case 0x4:return ID_8xy4;
+	case 0x5:return ID_8xy5;
+	case 0x6:return ID_8xy6;
+	case 0x7:return ID_8xy7;
+	case 0xE:return ID_8xyE;
+	default:break;
+	}
+	break;
+  }
+  case 0x9:return ID_9xy0;
+  case 0xA:return ID_Annn;
+  case 0xB:return ID_Bnnn;
+  case 0xC:return ID_Cxkk;
+  case 0xD:return ID_Dxyn;
+  case 0xE: {
+	switch (opcode & 0x00FFu) {
+	case 0x9E:return ID_Ex9E;
+	case 0xA1:return ID_ExA1;
+	default:break;
+	}
+	break;
+  }
+  case 0xF: {
+	switch (opcode) {
+	case 0xF000:return xo_chip ? ID_F000 : UNKNOWN;
+	case 0xF002:return xo_chip ? ID_F002 : UNKNOWN;
+	default:break;
+	}
+	switch (opcode & 0x00FFu) {
+	case 0x01:return xo_chip ? ID_Fn01 : UNKNOWN;
+	case 0x07:return ID_Fx07;
+	case 0x0A:return ID_Fx0A;
+	case 0x15:return ID_Fx15;
+	case 0x18:return ID_Fx18;
+	case 0x1E:return ID_Fx1E;
+	case 0x29:return ID_Fx29;
+	case 0x33:return ID_Fx33;
+	case 0x3A:return xo_chip ? ID_Fx3A : UNKNOWN;
+	case 0x55:return ID_Fx55;
+	case 0x65:return ID_Fx65;
+	default:break;
+	}
+	break;
+  }
+  default:break;
+  }
+
+  return UNKNOWN;
+}
+
 void Chip8::Instruction::i_00E0(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
-  cpu.display = {false};
-  cpu.PC += 2;
+  for (unsigned int plane = 0; plane < Chip8::N_PLANES; plane++) {
+	if ((cpu.hot.plane_mask >> plane) & 1u)
+	  cpu.planes[plane].fill({});
+  }
+  cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_00Cn(Chip8::CPU &cpu, unsigned short opcode) {
+  auto n = static_cast<unsigned int>(opcode & 0x000Fu);
+
+  for (unsigned int plane = 0; plane < Chip8::N_PLANES; plane++) {
+	if (!((cpu.hot.plane_mask >> plane) & 1u))
+	  continue;
+	Chip8::Display &display = cpu.planes[plane];
+	auto rows = display.begin() + cpu.display_height();
+	std::copy_backward(display.begin(), rows - n, rows);
+	std::fill(display.begin(), display.begin() + n, Chip8::DisplayRow{});
+  }
+  cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_00FB(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
+  for (unsigned int plane = 0; plane < Chip8::N_PLANES; plane++) {
+	if (!((cpu.hot.plane_mask >> plane) & 1u))
+	  continue;
+	for (unsigned int y = 0; y < cpu.display_height(); y++) {
+	  Chip8::DisplayRow &row = cpu.planes[plane][y];
+	  if (cpu.hot.high_resolution)
+		row.right = (row.right >> 4u) | (row.left << 60u);
+	  row.left >>= 4u;
+	}
+  }
+  cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_00FC(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
+  for (unsigned int plane = 0; plane < Chip8::N_PLANES; plane++) {
+	if (!((cpu.hot.plane_mask >> plane) & 1u))
+	  continue;
+	for (unsigned int y = 0; y < cpu.display_height(); y++) {
+	  Chip8::DisplayRow &row = cpu.planes[plane][y];
+	  row.left = (row.left << 4u) | (row.right >> 60u);
+	  row.right <<= 4u;
+	}
+  }
+  cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_00FD(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
+  cpu.halted = true;
+}
+
+void Chip8::Instruction::i_00FE(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
+  cpu.set_high_resolution(false);
+  cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_00FF(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
+  cpu.set_high_resolution(true);
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_00EE(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
-  if (cpu.SP == 0)
+  if (cpu.hot.SP == 0)
 	throw std::runtime_error("stack underflow");
 
-  cpu.SP -= 1;
-  cpu.PC = static_cast<unsigned short>(cpu.stack[cpu.SP] + 2);
+  cpu.hot.SP -= 1;
+  cpu.hot.PC = static_cast<unsigned short>(cpu.stack[cpu.hot.SP] + 2);
 }
 
 void Chip8::Instruction::i_1nnn(Chip8::CPU &cpu, unsigned short opcode) {
-  cpu.PC = static_cast<unsigned short>(opcode & 0x0FFFu);
+  cpu.hot.PC = static_cast<unsigned short>(opcode & 0x0FFFu);
 }
 
 void Chip8::Instruction::i_2nnn(Chip8::CPU &cpu, unsigned short opcode) {
-  if (cpu.SP > 0xF)
+  if (cpu.hot.SP > 0xF)
 	throw std::runtime_error("stack overflow");
 
-  cpu.stack[cpu.SP] = cpu.PC;
-  cpu.SP += 1;
-  cpu.PC = static_cast<unsigned short>(opcode & 0x0FFFu);
+  cpu.stack[cpu.hot.SP] = cpu.hot.PC;
+  cpu.hot.SP += 1;
+  cpu.hot.PC = static_cast<unsigned short>(opcode & 0x0FFFu);
 }
 
 void Chip8::Instruction::i_3xkk(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto k = static_cast<unsigned char>(opcode & 0x00FFu);
-  if (cpu.reg[x] == k)
-	cpu.PC += 4;
+  if (cpu.hot.reg[x] == k)
+	cpu.skip();
   else
-	cpu.PC += 2;
+	cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_4xkk(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto k = static_cast<unsigned char>(opcode & 0x00FFu);
-  if (cpu.reg[x] != k)
-	cpu.PC += 4;
+  if (cpu.hot.reg[x] != k)
+	cpu.skip();
   else
-	cpu.PC += 2;
+	cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_5xy0(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
-  if (cpu.reg[x] == cpu.reg[y])
-	cpu.PC += 4;
+  if (cpu.hot.reg[x] == cpu.hot.reg[y])
+	cpu.skip();
   else
-	cpu.PC += 2;
+	cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_5xy2(Chip8::CPU &cpu, unsigned short opcode) {
+  auto x = static_cast<unsigned int>((opcode & 0x0F00u) >> 8u);
+  auto y = static_cast<unsigned int>((opcode & 0x00F0u) >> 4u);
+  unsigned int count = (x < y ? y - x : x - y) + 1;
+
+  if (cpu.hot.I + count > cpu.memory_size())
+	throw std::runtime_error("tried to store registers out of memory");
+
+  for (unsigned int i = 0; i < count; i++)
+	cpu.write_data(cpu.hot.I + i, cpu.hot.reg[x < y ? x + i : x - i]);
+  cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_5xy3(Chip8::CPU &cpu, unsigned short opcode) {
+  auto x = static_cast<unsigned int>((opcode & 0x0F00u) >> 8u);
+  auto y = static_cast<unsigned int>((opcode & 0x00F0u) >> 4u);
+  unsigned int count = (x < y ? y - x : x - y) + 1;
+
+  if (cpu.hot.I + count > cpu.memory_size())
+	throw std::runtime_error("tried to load registers out of memory");
+
+  for (unsigned int i = 0; i < count; i++)
+	cpu.hot.reg[x < y ? x + i : x - i] = cpu.read_data(cpu.hot.I + i);
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_6xkk(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto k = static_cast<unsigned char>(opcode & 0x00FFu);
-  cpu.reg[x] = k;
-  cpu.PC += 2;
+  cpu.hot.reg[x] = k;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_7xkk(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto k = static_cast<unsigned char>(opcode & 0x00FFu);
-  cpu.reg[x] += k;
-  cpu.PC += 2;
+  cpu.hot.reg[x] += k;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xy0(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
 
-  cpu.reg[x] = cpu.reg[y];
-  cpu.PC += 2;
+  cpu.hot.reg[x] = cpu.hot.reg[y];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xy1(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
 
-  cpu.reg[x] |= cpu.reg[y];
-  cpu.PC += 2;
+  cpu.hot.reg[x] |= cpu.hot.reg[y];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xy2(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
 
-  cpu.reg[x] &= cpu.reg[y];
-  cpu.PC += 2;
+  cpu.hot.reg[x] &= cpu.hot.reg[y];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xy3(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
 
-  cpu.reg[x] ^= cpu.reg[y];
-  cpu.PC += 2;
+  cpu.hot.reg[x] ^= cpu.hot.reg[y];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xy4(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
 
-  if (cpu.reg[x] > std::numeric_limits<unsigned char>::max() - cpu.reg[y])
-	cpu.reg[0xF] = 1;
+  if (cpu.hot.reg[x] > std::numeric_limits<unsigned char>::max() - cpu.hot.reg[y])
+	cpu.hot.reg[0xF] = 1;
   else
-	cpu.reg[0xF] = 0;
+	cpu.hot.reg[0xF] = 0;
 
-  cpu.reg[x] += cpu.reg[y];
-  cpu.PC += 2;
+  cpu.hot.reg[x] += cpu.hot.reg[y];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xy5(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
 
-  if (cpu.reg[x] >= cpu.reg[y])
-	cpu.reg[0xF] = 1;
+  if (cpu.hot.reg[x] >= cpu.hot.reg[y])
+	cpu.hot.reg[0xF] = 1;
   else
-	cpu.reg[0xF] = 0;
+	cpu.hot.reg[0xF] = 0;
 
-  cpu.reg[x] -= cpu.reg[y];
-  cpu.PC += 2;
+  cpu.hot.reg[x] -= cpu.hot.reg[y];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xy6(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   unsigned short y;
 
-  if (!cpu.shift_quirk)
+  if (!cpu.hot.shift_quirk)
 	y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
   else
 	y = x;
 
-  cpu.reg[0xF] = static_cast<unsigned char>(cpu.reg[y] & 1u);
-  cpu.reg[x] = cpu.reg[y] >> 1u;
+  cpu.hot.reg[0xF] = static_cast<unsigned char>(cpu.hot.reg[y] & 1u);
+  cpu.hot.reg[x] = cpu.hot.reg[y] >> 1u;
 
-  cpu.PC += 2;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xy7(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
 
-  if (cpu.reg[y] >= cpu.reg[x])
-	cpu.reg[0xF] = 1;
+  if (cpu.hot.reg[y] >= cpu.hot.reg[x])
+	cpu.hot.reg[0xF] = 1;
   else
-	cpu.reg[0xF] = 0;
+	cpu.hot.reg[0xF] = 0;
 
-  cpu.reg[x] = cpu.reg[y] - cpu.reg[x];
-  cpu.PC += 2;
+  cpu.hot.reg[x] = cpu.hot.reg[y] - cpu.hot.reg[x];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_8xyE(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   unsigned short y;
 
-  if (!cpu.shift_quirk)
+  if (!cpu.hot.shift_quirk)
 	y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
   else
 	y = x;
 
-  cpu.reg[0xF] = static_cast<unsigned char>((cpu.reg[y] & 0x80u) >> 7u);
-  cpu.reg[x] = cpu.reg[y] << 1u;
+  cpu.hot.reg[0xF] = static_cast<unsigned char>((cpu.hot.reg[y] & 0x80u) >> 7u);
+  cpu.hot.reg[x] = cpu.hot.reg[y] << 1u;
 
-  cpu.PC += 2;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_9xy0(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto y = static_cast<unsigned short>((opcode & 0x00F0u) >> 4u);
 
-  if (cpu.reg[x] != cpu.reg[y])
-	cpu.PC += 4;
+  if (cpu.hot.reg[x] != cpu.hot.reg[y])
+	cpu.skip();
   else
-	cpu.PC += 2;
+	cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Annn(Chip8::CPU &cpu, unsigned short opcode) {
-  cpu.I = static_cast<unsigned short>(opcode & 0x0FFFu);
-  cpu.PC += 2;
+  cpu.hot.I = static_cast<unsigned short>(opcode & 0x0FFFu);
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Bnnn(Chip8::CPU &cpu, unsigned short opcode) {
-  auto dest = static_cast<unsigned short>((opcode & 0x0FFFu) + (unsigned short)cpu.reg[0]);
+  auto dest = static_cast<unsigned short>((opcode & 0x0FFFu) + (unsigned short)cpu.hot.reg[0]);
   if (dest >= 4096)
 	throw std::runtime_error("tried to access out of memory");
 
-  cpu.PC = dest;
+  cpu.hot.PC = dest;
 }
 
 void Chip8::Instruction::i_Cxkk(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned short>((opcode & 0x0F00u) >> 8u);
   auto k = static_cast<unsigned char>(opcode & 0x00FFu);
-  cpu.reg[x] = static_cast<unsigned char>((static_cast<unsigned int>(std::rand()) % 255u)
-	  & k); // NOLINT (in this case using std::rand is fine)
-  cpu.PC += 2;
+  cpu.hot.reg[x] = static_cast<unsigned char>((cpu.random() % 255u) & k);
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Dxyn(Chip8::CPU &cpu, unsigned short opcode) {
@@ -205,162 +422,193 @@ void Chip8::Instruction::i_Dxyn(Chip8::CPU &cpu, unsigned short opcode) {
   auto y = static_cast<unsigned char>((opcode & 0x00F0u) >> 4u);
   auto n = static_cast<unsigned char>(opcode & 0x000Fu);
 
-  if (cpu.I + n > Chip8::MEMORY_SIZE)
+  // Dxy0 draws 16x16 sprite, each row is two bytes, and nothing on the original CHIP-8
+  unsigned int height = n ? n : cpu.schip() ? 16 : 0;
+  unsigned int width = n ? 8 : 16;
+  unsigned int sprite_size = height * width / 8;
+  unsigned int plane_count = (cpu.hot.plane_mask & 1u) + (cpu.hot.plane_mask >> 1u); // each plane has its own sprite
+
+  if (cpu.hot.I + sprite_size * plane_count > cpu.memory_size())
 	throw std::runtime_error("tried to access sprite out of memory");
 
+  unsigned int screen_width = cpu.display_width();
+  unsigned int screen_height = cpu.display_height();
+  unsigned int nx = cpu.hot.reg[x];
   unsigned char vf_flag = 0;
 
-  for (unsigned row = 0; row < n; row++) {
-	unsigned char sprite_row = cpu.mem[cpu.I + row];
-	unsigned ny = cpu.reg[y] + row;
+  if (cpu.hot.wrapping)
+	nx %= screen_width;
 
-	if (cpu.wrapping)
-	  ny %= Chip8::SCREEN_HEIGHT;
-	else if (ny >= Chip8::SCREEN_HEIGHT)
+  unsigned int sprite = cpu.hot.I;
+  for (unsigned int plane = 0; plane < Chip8::N_PLANES && nx < screen_width; plane++) {
+	if (!((cpu.hot.plane_mask >> plane) & 1u))
 	  continue;
 
-	for (unsigned col = 0; col < 8; col++) {
-	  unsigned nx = cpu.reg[x] + col;
+	for (unsigned row = 0; row < height; row++) {
+	  unsigned ny = cpu.hot.reg[y] + row;
 
-	  if (cpu.wrapping)
-		nx %= Chip8::SCREEN_WIDTH;
-	  else if (nx >= Chip8::SCREEN_WIDTH)
+	  if (cpu.hot.wrapping)
+		ny %= screen_height;
+	  else if (ny >= screen_height)
 		continue;
 
-	  bool pixel = static_cast<bool>((unsigned)(sprite_row >> (7 - col)) & 1u);
-	  unsigned pixel_pos = nx + ny * SCREEN_WIDTH;
-
-	  bool prev_pixel = cpu.display[pixel_pos];
-	  bool next_pixel = prev_pixel ^pixel;
-
-	  if (prev_pixel && !next_pixel) {
+	  std::uint32_t sprite_row = cpu.read_data(sprite + row * width / 8);
+	  if (width == 16)
+		sprite_row = (sprite_row << 8u) | cpu.read_data(sprite + 2 * row + 1);
+	  if (cpu.draw_row(plane, ny, nx, sprite_row, width))
 		vf_flag = 1;
-	  }
-
-	  cpu.display[pixel_pos] = next_pixel;
 	}
+	sprite += sprite_size;
   }
 
-  cpu.reg[0xF] = vf_flag;
-  cpu.PC += 2;
+  cpu.hot.reg[0xF] = vf_flag;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Ex9E(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
-  if (cpu.keyboard[cpu.reg[x]])
-	cpu.PC += 4;
+  if ((cpu.hot.keyboard >> (cpu.hot.reg[x] & 0xFu)) & 1u)
+	cpu.skip();
   else
-	cpu.PC += 2;
+	cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_ExA1(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
-  if (!cpu.keyboard[cpu.reg[x]])
-	cpu.PC += 4;
+  if (!((cpu.hot.keyboard >> (cpu.hot.reg[x] & 0xFu)) & 1u))
+	cpu.skip();
   else
-	cpu.PC += 2;
+	cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_F000(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
+  if (cpu.hot.PC + 3u >= Chip8::MEMORY_SIZE)
+	throw std::runtime_error("tried to access out of memory");
+
+  cpu.hot.I = static_cast<unsigned short>((cpu.read(cpu.hot.PC + 2u) << 8u) | cpu.read(cpu.hot.PC + 3u));
+  cpu.hot.PC += 4;
+}
+
+void Chip8::Instruction::i_Fn01(Chip8::CPU &cpu, unsigned short opcode) {
+  auto n = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
+
+  if (n >= 1u << Chip8::N_PLANES)
+	throw std::runtime_error("unknown plane");
+
+  cpu.hot.plane_mask = n;
+  cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_F002(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
+  if (cpu.hot.I + Chip8::AUDIO_PATTERN_SIZE > cpu.memory_size())
+	throw std::runtime_error("tried to load audio pattern out of memory");
+
+  for (unsigned int i = 0; i < Chip8::AUDIO_PATTERN_SIZE; i++)
+	cpu.pattern[i] = cpu.read_data(cpu.hot.I + i);
+  cpu.has_pattern = true;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx07(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
-  cpu.reg[x] = cpu.DT;
-  cpu.PC += 2;
+  cpu.hot.reg[x] = cpu.hot.DT;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx0A(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
 
-  bool key_pressed = false;
-
-  for (auto it = cpu.keyboard.cbegin(); it < cpu.keyboard.cend(); it++) {
-	if (*it) {
-	  key_pressed = true;
-	  cpu.reg[x] = static_cast<unsigned char>(it - cpu.keyboard.cbegin());
-	  break;
-	}
+  if (cpu.hot.keyboard) {
+	cpu.hot.reg[x] = static_cast<unsigned char>(lowest_key(cpu.hot.keyboard));
+	cpu.hot.PC += 2;
+  } else {
+	cpu.hot.waiting = true;
   }
-
-  if (key_pressed)
-	cpu.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx15(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
-  cpu.DT = cpu.reg[x];
-  cpu.PC += 2;
+  cpu.hot.DT = cpu.hot.reg[x];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx18(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
-  cpu.ST = cpu.reg[x];
-  cpu.PC += 2;
+  cpu.hot.ST = cpu.hot.reg[x];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx1E(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
-  cpu.I += (unsigned short)cpu.reg[x];
-  cpu.PC += 2;
+  cpu.hot.I += (unsigned short)cpu.hot.reg[x];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx29(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
 
-  if (cpu.reg[x] > 0xF)
+  if (cpu.hot.reg[x] > 0xF)
 	throw std::runtime_error("unknown digit");
 
-  cpu.I = static_cast<unsigned short>((unsigned short)cpu.reg[x] * 5);
-  cpu.PC += 2;
+  cpu.hot.I = static_cast<unsigned short>((unsigned short)cpu.hot.reg[x] * 5);
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx33(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
 
-  if (cpu.I + 2 >= 4096)
+  if (cpu.hot.I + 2u >= cpu.memory_size())
 	throw std::runtime_error("tried to save bcd number out of memory");
 
-  cpu.mem[cpu.I] = static_cast<unsigned char>(cpu.reg[x] / 100);
-  cpu.mem[cpu.I + 1u] = static_cast<unsigned char>((cpu.reg[x] / 10) % 10);
-  cpu.mem[cpu.I + 2u] = static_cast<unsigned char>(cpu.reg[x] % 10);
-  cpu.PC += 2;
+  cpu.write_data(cpu.hot.I, static_cast<unsigned char>(cpu.hot.reg[x] / 100));
+  cpu.write_data(cpu.hot.I + 1u, static_cast<unsigned char>((cpu.hot.reg[x] / 10) % 10));
+  cpu.write_data(cpu.hot.I + 2u, static_cast<unsigned char>(cpu.hot.reg[x] % 10));
+  cpu.hot.PC += 2;
+}
+
+void Chip8::Instruction::i_Fx3A(Chip8::CPU &cpu, unsigned short opcode) {
+  auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
+  cpu.pitch = cpu.hot.reg[x];
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx55(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
 
-  if (cpu.I + x >= 4096)
+  if (cpu.hot.I + x >= cpu.memory_size())
 	throw std::runtime_error("tried to store registers out of memory");
 
   for (unsigned int i = 0; i <= x; i++) {
-	cpu.mem[cpu.I + i] = cpu.reg[i];
+	cpu.write_data(cpu.hot.I + i, cpu.hot.reg[i]);
   }
 
-  if (!cpu.load_store_quirk) {
-	cpu.I += x + 1;
+  if (!cpu.hot.load_store_quirk) {
+	cpu.hot.I += x + 1;
   } else {
 	// when quirk is enabled don't change I register
   }
-  cpu.PC += 2;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_Fx65(Chip8::CPU &cpu, unsigned short opcode) {
   auto x = static_cast<unsigned char>((opcode & 0x0F00u) >> 8u);
 
-  if (cpu.I + x >= 4096)
+  if (cpu.hot.I + x >= cpu.memory_size())
 	throw std::runtime_error("tried to store registers out of memory");
 
   for (unsigned int i = 0; i <= x; i++) {
-	cpu.reg[i] = cpu.mem[cpu.I + i];
+	cpu.hot.reg[i] = cpu.read_data(cpu.hot.I + i);
   }
 
-  if (!cpu.load_store_quirk) {
-	cpu.I += x + 1;
+  if (!cpu.hot.load_store_quirk) {
+	cpu.hot.I += x + 1;
   } else {
 	// when quirk is enabled don't change I register
   }
 
-  cpu.PC += 2;
+  cpu.hot.PC += 2;
 }
 
 void Chip8::Instruction::i_0000(Chip8::CPU &cpu, [[maybe_unused]] unsigned short opcode) {
-  cpu.PC += 2;
+  cpu.hot.PC += 2;
 }
@@ -1,9 +1,28 @@
 #ifndef CHIP8_EMU_CPP_INSTRUCTIONS_HPP
 #define CHIP8_EMU_CPP_INSTRUCTIONS_HPP
 
+#include <array>
 #include "cpu.hpp"
 
 namespace Chip8 {
+/**
+ * \brief Identifies instruction matched to an opcode.
+ *
+ * Values index Instruction::HANDLERS and Instruction::NAMES. UNKNOWN is matched to opcodes without instruction.
+ */
+enum InstructionId : unsigned char {
+  UNKNOWN,
+  ID_0000, ID_00E0, ID_00EE, ID_00Cn, ID_00FB, ID_00FC, ID_00FD, ID_00FE, ID_00FF, ID_1nnn,
+  ID_2nnn, ID_3xkk, ID_4xkk, ID_5xy0, ID_5xy2, ID_5xy3, ID_6xkk, ID_7xkk, ID_8xy0, ID_8xy1,
+  ID_8xy2, ID_8xy3, ID_8xy4, ID_8xy5, ID_8xy6, ID_8xy7, ID_8xyE, ID_9xy0, ID_Annn, ID_Bnnn,
+  ID_Cxkk, ID_Dxyn, ID_Ex9E, ID_ExA1, ID_F000, ID_Fn01, ID_F002, ID_Fx07, ID_Fx0A, ID_Fx15,
+  ID_Fx18, ID_Fx1E, ID_Fx29, ID_Fx33, ID_Fx3A, ID_Fx55, ID_Fx65,
+  N_INSTRUCTIONS
+};
+
+/** \brief Function executing an instruction. */
+using Handler = void (*)(Chip8::CPU &cpu, unsigned short opcode);
+
 /**
  * \brief Class representing available instructions in Chip8's "CPU".
  *
@@ -12,6 +31,24 @@ namespace Chip8 {
  */
 class Instruction {
 public:
+  /** \brief Handler of each instruction, nullptr for UNKNOWN. */
+  static const std::array<Handler, N_INSTRUCTIONS> HANDLERS;
+
+  /** \brief Name of each instruction in the same form as in handler's name, e.g. "8xy4". */
+  static const std::array<const char *, N_INSTRUCTIONS> NAMES;
+
+  /**
+   * \brief Matches instruction to an opcode.
+   *
+   * SUPER-CHIP instructions (00Cn, 00FB, 00FC, 00FD, 00FE, 00FF) are matched only in SUPER-CHIP and XO-CHIP modes,
+   * XO-CHIP instructions (5xy2, 5xy3, F000, Fn01, F002, Fx3A) only in XO-CHIP mode.
+   *
+   * @param opcode 16-bit number representing instruction code
+   * @param mode instruction set of the cpu
+   * @return id of matched instruction or UNKNOWN
+   */
+  static InstructionId decode(unsigned short opcode, Mode mode);
+
   /**
    * \brief No operation.
    *
@@ -43,6 +80,67 @@ public:
    */
   static void i_00EE(Chip8::CPU &cpu, unsigned short opcode);
 
+  /**
+   * \brief Scroll display down n rows (SCHIP).
+   *
+   * Rows scrolled in at the top are cleared. Scrolls by pixels of the current resolution. Program counter is
+   * incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_00Cn(Chip8::CPU &cpu, unsigned short opcode);
+
+  /**
+   * \brief Scroll display right 4 pixels (SCHIP).
+   *
+   * Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_00FB(Chip8::CPU &cpu, unsigned short opcode);
+
+  /**
+   * \brief Scroll display left 4 pixels (SCHIP).
+   *
+   * Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_00FC(Chip8::CPU &cpu, unsigned short opcode);
+
+  /**
+   * \brief Exit interpreter (SCHIP).
+   *
+   * Marks cpu as exited and leaves program counter at this instruction, so the program stops.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_00FD(Chip8::CPU &cpu, unsigned short opcode);
+
+  /**
+   * \brief Switch to 64x32 low resolution (SCHIP).
+   *
+   * Display is cleared. Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_00FE(Chip8::CPU &cpu, unsigned short opcode);
+
+  /**
+   * \brief Switch to 128x64 high resolution (SCHIP).
+   *
+   * Display is cleared. Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_00FF(Chip8::CPU &cpu, unsigned short opcode);
+
   /**
    * \brief Jump to address nnn.
    *
@@ -95,6 +193,28 @@ public:
    */
   static void i_5xy0(Chip8::CPU &cpu, unsigned short opcode);
 
+  /**
+   * \brief Save registers Vx through Vy at I (XO-CHIP).
+   *
+   * Registers are stored in order from x to y, which may be descending. I is left unchanged. Throws runtime error
+   * when the range doesn't fit into memory. Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_5xy2(Chip8::CPU &cpu, unsigned short opcode);
+
+  /**
+   * \brief Load registers Vx through Vy from I (XO-CHIP).
+   *
+   * Registers are loaded in order from x to y, which may be descending. I is left unchanged. Throws runtime error
+   * when the range doesn't fit into memory. Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_5xy3(Chip8::CPU &cpu, unsigned short opcode);
+
   /**
    * \brief Set Vx to kk.
    *
@@ -267,8 +387,8 @@ public:
   /**
    * \brief Setx Vx to RND AND kk
    *
-   * Random number in range 0-255 inclusive is generated, which is bitwise AND'ed with value kk. Result is stored
-   * in register x. Program counter is incremented 2 times.
+   * Random number in range 0-254 inclusive is taken from cpu's seeded generator, which is bitwise AND'ed with value
+   * kk. Result is stored in register x. Program counter is incremented 2 times.
    *
    * @param cpu instance on which the instruction will be executed
    * @param opcode 16-bit number representing instruction code
@@ -283,7 +403,7 @@ public:
    * screen at the same location. After the draw operation, if any of the previous pixels was on and current pixel
    * is off the flag in the 0xF register is set to 1. Otherwise it is set to 0. If wrapping flag is set, then pixels
    * which are supposed to be drawn outside of the display are wrapped around. Otherwise they aren't drawn at all.
-   * Program counter is incremented 2 times.
+   * Dxy0 draws 16x16 sprite made of 32 bytes, two per row (SCHIP). Program counter is incremented 2 times.
    *
    * \note Behavior of this function depends on cpu's wrapping flag.
    *
@@ -295,8 +415,8 @@ public:
   /**
    * \brief Skip next instruction if key Vx is pressed.
    *
-   * Status of a key, which number is stored in x register, is read. If key is pressed then program counter is
-   * incremented 4 times, otherwise 2 times.
+   * Status of a key, which number is stored in lower nibble of x register, is read. If key is pressed then program
+   * counter is incremented 4 times, otherwise 2 times.
    *
    * @param cpu instance on which the instruction will be executed
    * @param opcode 16-bit number representing instruction code
@@ -306,14 +426,47 @@ public:
   /**
   * \brief Skip next instruction if key Vx is not pressed.
   *
-  * Status of a key, which number is stored in x register, is read. If key is not pressed then program counter is
-  * incremented 4 times, otherwise 2 times.
+  * Status of a key, which number is stored in lower nibble of x register, is read. If key is not pressed then program
+  * counter is incremented 4 times, otherwise 2 times.
   *
   * @param cpu instance on which the instruction will be executed
   * @param opcode 16-bit number representing instruction code
   */
   static void i_ExA1(Chip8::CPU &cpu, unsigned short opcode);
 
+  /**
+   * \brief Set I to 16-bit address nnnn (XO-CHIP).
+   *
+   * Address is the word following the instruction, which makes this the only 4-byte instruction. Program counter is
+   * incremented 4 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_F000(Chip8::CPU &cpu, unsigned short opcode);
+
+  /**
+   * \brief Select planes n (XO-CHIP).
+   *
+   * Following draws, clears and scrolls affect only planes which bits are set in n. Throws runtime error for n larger
+   * than 3. Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_Fn01(Chip8::CPU &cpu, unsigned short opcode);
+
+  /**
+   * \brief Load audio pattern from I (XO-CHIP).
+   *
+   * Copies 16 bytes starting at I into the audio pattern buffer. Throws runtime error when pattern doesn't fit into
+   * memory. Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_F002(Chip8::CPU &cpu, unsigned short opcode);
+
   /**
   * \brief Set Vx to DT.
   *
@@ -327,9 +480,9 @@ public:
   /**
   * \brief Wait for keypress and store pressed key in Vx.
   *
-  * Polls each key and checks if any of them is pressed. If so, pressed key number is stored in x register and
+  * Checks keyboard mask for any pressed key. If so, number of the lowest pressed key is stored in x register and
   * program counter is incremented 2 times. Otherwise program counter is not incremented, which means that this
-  * instruction will block until any key is pressed.
+  * instruction will block until any key is pressed, and cpu enters waiting state (see CPU::waiting_for_key).
   *
   * @param cpu instance on which the instruction will be executed
   * @param opcode 16-bit number representing instruction code
@@ -389,6 +542,16 @@ public:
   */
   static void i_Fx33(Chip8::CPU &cpu, unsigned short opcode);
 
+  /**
+   * \brief Set audio pitch to Vx (XO-CHIP).
+   *
+   * Pattern is played at 4000 * 2 ^ ((Vx - 64) / 48) bits per second. Program counter is incremented 2 times.
+   *
+   * @param cpu instance on which the instruction will be executed
+   * @param opcode 16-bit number representing instruction code
+   */
+  static void i_Fx3A(Chip8::CPU &cpu, unsigned short opcode);
+
   /**
   * \brief Store registers V0 through VF starting at address I.
   *
@@ -0,0 +1,35 @@
+#include <algorithm>
+#include "predecoded.hpp"
+
+Chip8::PredecodedEngine::PredecodedEngine(CPU &cpu) : cpu(cpu) {
+  ids.fill(NOT_DECODED);
+  opcodes.fill(0);
+  cpu.take_written_pages();
+}
+
+void Chip8::PredecodedEngine::invalidate(std::uint16_t written) {
+  for (unsigned int page = 0; page < N_PAGES; page++) {
+	if (!((written >> page) & 1u))
+	  continue;
+
+	// instruction starting at the last byte of the previous page overlaps this page too
+	unsigned int first = page == 0 ? 0 : page * PAGE_SIZE - 1;
+	if (trap_count) {
+	  for (unsigned int address = first; address < (page + 1) * PAGE_SIZE; address++)
+		ids[address] = traps[address] ? TRAPPED : NOT_DECODED;
+	} else {
+	  std::fill(ids.begin() + first, ids.begin() + (page + 1) * PAGE_SIZE, NOT_DECODED);
+	}
+  }
+}
+
+void Chip8::PredecodedEngine::set_trap(unsigned int address, bool trapped) {
+  if (address >= MEMORY_SIZE)
+	throw std::runtime_error("tried to access out of memory");
+  if (traps[address] == trapped)
+	return;
+
+  traps[address] = trapped;
+  trap_count = trapped ? trap_count + 1 : trap_count - 1;
+  ids[address] = trapped ? TRAPPED : NOT_DECODED;
+}
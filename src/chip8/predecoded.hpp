@@ -0,0 +1,105 @@
+#ifndef CHIP8_EMU_CPP_PREDECODED_HPP
+#define CHIP8_EMU_CPP_PREDECODED_HPP
+
+#include <array>
+#include <cstdint>
+#include "cpu.hpp"
+#include "instructions.hpp"
+
+namespace Chip8 {
+/**
+ * \brief Executes cpu's cycles from a table of decoded instructions.
+ *
+ * Each address is decoded only once, when it's executed for the first time. Later cycles skip reading memory and
+ * matching the opcode and call the handler straight from the table. Decoded instructions on pages written by the cpu
+ * are dropped, so self-modifying roms behave the same as with CPU::cycle.
+ *
+ * Addresses can be trapped, e.g. for breakpoints. Trapped address is marked in the table like an address which isn't
+ * decoded yet, so traps cost nothing until they are hit.
+ */
+class PredecodedEngine {
+  static const unsigned char NOT_DECODED = 0xFF;
+  static const unsigned char TRAPPED = 0xFE;
+
+  CPU &cpu;
+  std::array<unsigned char, MEMORY_SIZE> ids; // InstructionId at each address, NOT_DECODED or TRAPPED
+  std::array<unsigned short, MEMORY_SIZE> opcodes; // opcode at each decoded address
+  std::array<bool, MEMORY_SIZE> traps{}; // trapped addresses
+  unsigned int trap_count = 0;
+
+  /**
+   * \brief Drops decoded instructions overlapping written pages.
+   *
+   * @param written mask where bit n is set when page n was written
+   */
+  void invalidate(std::uint16_t written);
+
+public:
+  /**
+   * \brief Creates engine running given cpu.
+   *
+   * @param cpu cpu to run, must outlive the engine
+   */
+  explicit PredecodedEngine(CPU &cpu);
+
+  /**
+   * \brief Executes one cpu cycle.
+   *
+   * Has the same effect as CPU::cycle, including errors thrown.
+   *
+   * @return false if PC is trapped, instruction isn't executed then
+   */
+  bool cycle() {
+	return execute<false>();
+  }
+
+  /**
+   * \brief Executes one cpu cycle even if PC is trapped.
+   */
+  void step() {
+	execute<true>();
+  }
+
+  /**
+   * \brief Traps or releases address.
+   *
+   * @param address address in range 0x000-0xFFF inclusive
+   * @param trapped whether cycle should stop at the address
+   */
+  void set_trap(unsigned int address, bool trapped);
+
+private:
+  template<bool IgnoreTraps>
+  bool execute() {
+	if (std::uint16_t written = cpu.take_written_pages())
+	  invalidate(written);
+
+	unsigned short address = cpu.pc();
+	if (address + 1u >= MEMORY_SIZE)
+	  throw std::runtime_error("tried to access out of memory");
+
+	unsigned char id = ids[address];
+	if (id >= N_INSTRUCTIONS) {
+	  if (traps[address]) {
+		if (!IgnoreTraps)
+		  return false;
+		// trapped address keeps its mark, so the instruction is decoded each time it's stepped over
+		opcodes[address] = cpu.get_opcode();
+		id = Instruction::decode(opcodes[address], cpu.mode());
+	  } else {
+		opcodes[address] = cpu.get_opcode();
+		id = ids[address] = Instruction::decode(opcodes[address], cpu.mode());
+	  }
+	}
+
+	cpu.record_trace(opcodes[address]);
+	Handler handler = Instruction::HANDLERS[id];
+	if (!handler)
+	  throw std::runtime_error("unknown opcode " + opcode_string(opcodes[address]));
+	handler(cpu, opcodes[address]);
+	return true;
+  }
+};
+}
+
+#endif //CHIP8_EMU_CPP_PREDECODED_HPP
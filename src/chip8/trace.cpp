@@ -0,0 +1,39 @@
+#include "trace.hpp"
+
+#include <iomanip>
+#include "cpu.hpp"
+#include "disassembler.hpp"
+
+Chip8::TraceBuffer::TraceBuffer(std::size_t capacity) {
+  std::size_t size = 1;
+  while (size < capacity)
+	size <<= 1u;
+
+  records.resize(size);
+  mask = size - 1;
+}
+
+std::size_t Chip8::TraceBuffer::size() const {
+  return count < records.size() ? static_cast<std::size_t>(count) : records.size();
+}
+
+const Chip8::TraceRecord &Chip8::TraceBuffer::operator[](std::size_t i) const {
+  return records[(count - size() + i) & mask];
+}
+
+void Chip8::TraceBuffer::dump(std::ostream &out, Mode mode) const {
+  std::uint64_t first = count - size();
+
+  for (std::size_t i = 0; i < size(); i++) {
+	const TraceRecord &record = (*this)[i];
+	std::string address = opcode_string(record.pc);
+	std::string index = opcode_string(record.index); // XO-CHIP index has 16 bits, shown in full
+	if (mode != Mode::XO_CHIP)
+	  index = index.substr(1);
+	std::string vf = opcode_string(record.vf).substr(2);
+
+	out << std::setw(10) << first + i << "  " << address.substr(1) << "  " << opcode_string(record.opcode) << "  "
+		<< std::left << std::setw(16) << disassemble(record.opcode, mode) << std::right
+		<< "I=" << index << " VF=" << vf << " SP=" << static_cast<unsigned int>(record.sp) << '\n';
+  }
+}
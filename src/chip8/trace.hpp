@@ -0,0 +1,84 @@
+#ifndef CHIP8_EMU_CPP_TRACE_HPP
+#define CHIP8_EMU_CPP_TRACE_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Chip8 {
+enum class Mode : unsigned char; // defined with the cpu
+
+/**
+ * \brief State of the cpu before one executed instruction.
+ */
+struct TraceRecord {
+  std::uint16_t pc; //!< Address of the instruction.
+  std::uint16_t opcode; //!< Executed opcode.
+  std::uint16_t index; //!< Value of I register.
+  std::uint8_t vf; //!< Value of VF register.
+  std::uint8_t sp; //!< Stack pointer.
+};
+
+static_assert(sizeof(TraceRecord) == 8, "trace records are meant to be written as single 64-bit stores");
+
+/**
+ * \brief Ring buffer of last executed instructions.
+ *
+ * Recording only stores fixed size binary record, records are decoded when the buffer is dumped, e.g. after cpu
+ * has thrown an error. Attach to a cpu with CPU::attach_trace.
+ */
+class TraceBuffer {
+  std::vector<TraceRecord> records;
+  std::size_t mask;
+  std::uint64_t count = 0; // number of recorded instructions
+
+public:
+  /**
+   * \brief Creates empty buffer.
+   *
+   * @param capacity number of remembered instructions, rounded up to a power of two
+   */
+  explicit TraceBuffer(std::size_t capacity);
+
+  /**
+   * \brief Records instruction, overwriting the oldest one when the buffer is full.
+   */
+  void record(std::uint16_t pc, std::uint16_t opcode, std::uint16_t index, std::uint8_t vf, std::uint8_t sp) {
+	records[count++ & mask] = TraceRecord{pc, opcode, index, vf, sp};
+  }
+
+  /**
+   * \brief Number of remembered instructions.
+   */
+  [[nodiscard]] std::size_t size() const;
+
+  /**
+   * \brief Number of instructions recorded since creation or last clear.
+   */
+  [[nodiscard]] std::uint64_t total() const { return count; }
+
+  /**
+   * \brief Gets remembered instruction.
+   *
+   * @param i index in range 0 to size() - 1, 0 is the oldest instruction
+   */
+  [[nodiscard]] const TraceRecord &operator[](std::size_t i) const;
+
+  /**
+   * \brief Forgets all instructions.
+   */
+  void clear() { count = 0; }
+
+  /**
+   * \brief Writes remembered instructions in human readable form, the oldest first.
+   *
+   * I is written with 4 hex digits in XO-CHIP mode, where it may point past 0xFFF, and with 3 digits otherwise.
+   *
+   * @param out stream receiving one line per instruction
+   * @param mode instruction set of the cpu
+   */
+  void dump(std::ostream &out, Mode mode) const;
+};
+}
+
+#endif //CHIP8_EMU_CPP_TRACE_HPP
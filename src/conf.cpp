@@ -25,6 +25,23 @@ RomConf::RomConf(json rom_data, std::filesystem::path resources_path) {
   } catch (json::out_of_range &) {
 	// dont do anything
   }
+  try {
+	schip = rom_data.at("schip");
+  } catch (json::out_of_range &) {
+	// dont do anything
+  }
+  try {
+	xo_chip = rom_data.at("xo_chip");
+  } catch (json::out_of_range &) {
+	// dont do anything
+  }
+
+  try {
+	std::string relative_snapshot_location = rom_data.at("snapshot");
+	snapshot_location = (resources_path / relative_snapshot_location).string();
+  } catch (json::out_of_range &) {
+	// dont do anything
+  }
 
   try {
 	std::string relative_rom_location = rom_data.at("location");
@@ -64,6 +81,36 @@ AppConf::AppConf(nlohmann::json app_data) {
 	std::cerr << e.what() << std::endl;
 	std::cerr << "Using default screen refresh rate." << std::endl;
   }
+  try {
+	upscale_filter = parse_upscale_filter(app_data.at("upscale"));
+  } catch (json::out_of_range &) {
+	// dont do anything
+  } catch (std::exception &e) {
+	std::cerr << "Error during upscale filter parsing:" << std::endl;
+	std::cerr << e.what() << std::endl;
+	std::cerr << "Using nearest upscaling." << std::endl;
+  }
+  try {
+	turbo_key = app_data.at("turbo_key");
+  } catch (json::out_of_range &) {
+	// dont do anything
+  } catch (json::type_error &e) {
+	std::cerr << "Error during turbo key parsing:" << std::endl;
+	std::cerr << e.what() << std::endl;
+	std::cerr << "Using default turbo key." << std::endl;
+  }
+  try {
+	turbo_speed = app_data.at("turbo_speed");
+	if (turbo_speed < 0)
+	  throw std::runtime_error("turbo speed can't be smaller than 0");
+  } catch (json::out_of_range &) {
+	// dont do anything
+  } catch (std::exception &e) {
+	turbo_speed = DEFAULT_TURBO_SPEED;
+	std::cerr << "Error during turbo speed parsing:" << std::endl;
+	std::cerr << e.what() << std::endl;
+	std::cerr << "Using default turbo speed." << std::endl;
+  }
 
   try {
 	auto user_keymap = app_data.at("keymap");
@@ -4,18 +4,23 @@
 #include <filesystem>
 #include <json.hpp>
 #include <map>
-#include <SDL2/SDL_keycode.h>
 #include <array>
 #include <string>
+#include "upscaler.hpp"
 
 const double DEFAULT_EMULATION_PERIOD = 1.0 / 500.0; // 1 / Hz
 const bool DEFAULT_LOAD_STORE_QUIRK = false;
 const bool DEFAULT_SHIFT_QUIRK = false;
 const bool DEFAULT_WRAPPING = true;
+const bool DEFAULT_SCHIP = false;
+const bool DEFAULT_XO_CHIP = false;
 
 const int DEFAULT_SCREEN_WIDTH = 1280;
 const int DEFAULT_SCREEN_HEIGHT = 640; // half the width
 const double DEFAULT_REFRESH_RATE = 60; // Hz
+const UpscaleFilter DEFAULT_UPSCALE_FILTER = UpscaleFilter::NEAREST;
+const std::string DEFAULT_TURBO_KEY = "Tab";
+const double DEFAULT_TURBO_SPEED = 8; // multiple of real time, 0 is uncapped
 
 static const std::array<std::string, 16>
 	DEFAULT_KEYS{"0", "1", "2", "3", "4", "5", "6", "7", "8", "9", "A", "B", "C", "D", "E", "F"}; // default key mapping
@@ -28,13 +33,23 @@ struct RomConf {
   bool load_store_quirk = DEFAULT_LOAD_STORE_QUIRK; //!< Load store quirk flag.
   bool shift_quirk = DEFAULT_SHIFT_QUIRK; //!< Shift quirk flag.
   bool wrapping = DEFAULT_WRAPPING; //!< Wrapping flag.
+  bool schip = DEFAULT_SCHIP; //!< SUPER-CHIP mode flag, see Chip8::CPU::set_schip.
+  bool xo_chip = DEFAULT_XO_CHIP; //!< XO-CHIP mode flag, see Chip8::CPU::set_xo_chip.
   std::string rom_location; //!< Rom location relative to root directory.
+  const unsigned char *rom_data = nullptr; //!< Rom already in memory e.g. mapped rom pack, used instead of rom_location.
+  std::size_t rom_size = 0; //!< Size of rom_data in bytes.
+  std::string snapshot_location; //!< Warm start snapshot relative to root directory, empty when rom boots normally.
+
+  /**
+   * \brief Creates emulation configuration with default settings and no rom location.
+   */
+  RomConf() = default;
 
   /**
    * \brief Creates emulation configuration from json data.
    *
    * If any of the members, except rom_location, are missing, they're replaced with defaults. If rom_location
-   * is missing throws runtime error.
+   * is missing throws runtime error. Optional "snapshot" is located in resources directory like the rom.
    *
    * @param rom_data json object containing configuration
    * @param resources_path path to resources directory
@@ -49,6 +64,9 @@ struct AppConf {
   int screen_width = DEFAULT_SCREEN_WIDTH; //!< Screen width in pixels.
   int screen_height = DEFAULT_SCREEN_HEIGHT; //!< Screen height in pixels.
   double refresh_rate = DEFAULT_REFRESH_RATE; //!< Screen refresh rate in Hz.
+  UpscaleFilter upscale_filter = DEFAULT_UPSCALE_FILTER; //!< Filter used when scaling display to the window.
+  std::string turbo_key = DEFAULT_TURBO_KEY; //!< SDL2 name of the key toggling turbo mode.
+  double turbo_speed = DEFAULT_TURBO_SPEED; //!< Turbo mode speed as multiple of real time, 0 is uncapped.
   std::map<std::string, std::string> keymap; //!< Keymap from Chip8 default key to user chosen key
 
   /**
@@ -1,41 +1,153 @@
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <iostream>
+#include <random>
 #include "emulator.hpp"
 
-void Emulator::run(std::chrono::duration<double> delta) {
+void Emulator::run(std::chrono::duration<double> delta, Clock::time_point now) {
   cycle_counter += delta.count() / emulation_period;
-  timer_counter += delta.count() / Chip8::TIMER_PERIOD;
 
-  while ((unsigned int)cycle_counter > 0) {
-	cpu.cycle();
-	cycle_counter--;
+  auto batch = static_cast<std::uint64_t>(cycle_counter);
+  cycle_counter -= static_cast<double>(batch);
+  std::uint64_t batch_first = cycles;
+
+  auto batch_start = now - std::chrono::duration_cast<Clock::duration>(delta);
+  for (const auto &event : pending_keys) {
+	double offset = 0.0;
+	if (delta.count() > 0) {
+	  std::chrono::duration<double> since_start = event.timestamp - batch_start;
+	  offset = std::clamp(since_start.count() / delta.count(), 0.0, 1.0) * static_cast<double>(batch);
+	}
+
+	run_until(batch_first + static_cast<std::uint64_t>(offset));
+	set_key(event.key, event.value);
+  }
+  pending_keys.clear();
+
+  run_until(batch_first + batch);
+}
+
+void Emulator::run_until(std::uint64_t end) {
+  try {
+	while (cycles < end) {
+	  if (cpu.waiting_for_key()) {
+		skip_until(end); // only set_key can wake the cpu, which never happens in between
+		break;
+	  }
+	  cpu.cycle();
+	  cycles++;
+	  tick_timers();
+	}
+  } catch (const std::runtime_error &e) {
+	if (trace) {
+	  std::cerr << "cpu error after " << cycles << " cycles: " << e.what() << ", last instructions:" << std::endl;
+	  trace->dump(std::cerr, cpu.mode());
+	}
+	throw;
   }
+}
+
+void Emulator::idle(std::chrono::duration<double> delta) {
+  cycle_counter += delta.count() / emulation_period;
 
-  while ((unsigned int)timer_counter > 0) {
-	cpu.update_timers();
-	timer_counter--;
+  auto batch = static_cast<std::uint64_t>(cycle_counter);
+  cycle_counter -= static_cast<double>(batch);
+  skip_until(cycles + batch);
+}
+
+void Emulator::skip_until(std::uint64_t end) {
+  while (cycles < end) {
+	// subtracting whole cycles is exact while the counter stays at or above 1, so they are skipped at once
+	double whole = std::floor(timer_counter) - 1.0;
+	if (whole >= 1.0) {
+	  auto skip = std::min(end - cycles, static_cast<std::uint64_t>(whole));
+	  timer_counter -= static_cast<double>(skip);
+	  cycles += skip;
+	} else {
+	  cycles++;
+	  tick_timers();
+	}
   }
 }
 
+void Emulator::enable_trace(std::size_t capacity) {
+  trace = capacity ? std::make_unique<Chip8::TraceBuffer>(capacity) : nullptr;
+  cpu.attach_trace(trace.get());
+}
+
 void Emulator::load_config(const RomConf &config) {
-  std::ifstream rom(config.rom_location, std::ifstream::binary);
-  if (!rom.is_open())
-	throw std::runtime_error("unable to open rom file at: " + config.rom_location);
-  std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(rom), {});
-  rom.close();
+  load_config(config, std::random_device{}());
+}
+
+void Emulator::load_config(const RomConf &config, std::uint32_t random_seed) {
+  cpu.set_schip(config.schip);
+  cpu.set_xo_chip(config.xo_chip); // before loading, XO-CHIP roms may not fit into CHIP-8 memory
+  if (config.rom_data) {
+	cpu.load_rom(config.rom_data, config.rom_size);
+	rom_id = rom_hash(config.rom_data, config.rom_size);
+  } else {
+	std::ifstream rom(config.rom_location, std::ifstream::binary);
+	if (!rom.is_open())
+	  throw std::runtime_error("unable to open rom file at: " + config.rom_location);
+	std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(rom), {});
+	rom.close();
+
+	cpu.load_rom(buffer);
+	rom_id = rom_hash(buffer.data(), buffer.size());
+  }
 
   emulation_period = config.emulation_period;
+  timer_period = Chip8::TIMER_PERIOD / emulation_period;
+  timer_counter = timer_period;
 
-  cpu.load_store_quirk = config.load_store_quirk;
-  cpu.shift_quirk = config.shift_quirk;
-  cpu.wrapping = config.wrapping;
+  cpu.set_quirks(config.load_store_quirk, config.shift_quirk, config.wrapping);
 
-  cpu.load_rom(buffer);
+  seed = random_seed;
+  cpu.seed_random(seed);
 }
 
-void Emulator::set_key(const std::string &key, const bool value) {
-  try {
-	cpu.key(keymap.at(key)) = value;
-  } catch (std::out_of_range &) {
-	throw std::runtime_error("unknown key");
-  }
+Snapshot Emulator::snapshot() const {
+  Snapshot snapshot;
+  snapshot.cpu = cpu.state();
+  snapshot.cycles = cycles;
+  snapshot.cycle_counter = cycle_counter;
+  snapshot.timer_counter = timer_counter;
+  snapshot.seed = seed;
+  snapshot.rom = rom_id;
+  snapshot.emulation_period = emulation_period;
+  snapshot.load_store_quirk = cpu.load_store_quirk();
+  snapshot.shift_quirk = cpu.shift_quirk();
+  snapshot.wrapping = cpu.wrapping();
+  snapshot.schip = cpu.schip();
+  snapshot.xo_chip = cpu.xo();
+  return snapshot;
+}
+
+void Emulator::restore(const Snapshot &snapshot) {
+  if (snapshot.rom != rom_id)
+	throw std::runtime_error("snapshot was taken from a different rom");
+  if (snapshot.emulation_period != emulation_period || snapshot.load_store_quirk != cpu.load_store_quirk()
+	  || snapshot.shift_quirk != cpu.shift_quirk() || snapshot.wrapping != cpu.wrapping()
+	  || snapshot.schip != cpu.schip() || snapshot.xo_chip != cpu.xo())
+	throw std::runtime_error("snapshot was taken with different rom settings");
+  cpu.restore(snapshot.cpu);
+  cycles = snapshot.cycles;
+  cycle_counter = snapshot.cycle_counter;
+  timer_counter = snapshot.timer_counter;
+  seed = snapshot.seed;
+  key_log.clear();
+  pending_keys.clear();
+}
+
+void Emulator::set_key(unsigned int key, bool value) {
+  cpu.set_key(key, value);
+  key_log.push_back(KeyEvent{cycles, static_cast<unsigned char>(key), value});
+}
+
+void Emulator::push_key(unsigned int key, bool value, Clock::time_point timestamp) {
+  if (key >= Chip8::KEYBOARD_SIZE)
+	throw std::runtime_error("no such key");
+
+  pending_keys.push_back(PendingKey{timestamp, static_cast<unsigned char>(key), value});
 }
@@ -2,36 +2,70 @@
 #define CHIP8_EMU_CPP_EMULATOR_HPP
 
 #include <chrono>
-#include <string>
-#include <map>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include "chip8/cpu.hpp"
 #include "conf.hpp"
+#include "frame_recorder.hpp"
+#include "snapshot.hpp"
+
+/**
+ * \brief Key transition applied at given cpu cycle.
+ */
+struct KeyEvent {
+  std::uint64_t cycle; //!< Number of cpu cycles executed before the transition.
+  unsigned char key; //!< Key number in range 0-15 inclusive.
+  bool value; //!< Is key pressed.
+};
 
 /**
  * \brief Handles emulation of the Chip8 CPU.
  */
 class Emulator {
+public:
+  /** \brief Clock used to timestamp input events. */
+  using Clock = std::chrono::steady_clock;
+
+private:
+  /**
+   * \brief Key transition waiting to be scheduled at a cycle.
+   */
+  struct PendingKey {
+	Clock::time_point timestamp;
+	unsigned char key;
+	bool value;
+  };
+
   double cycle_counter = 0; // number of cycles to execute
-  double timer_counter = 0; // number of times timers need to be updated
+  double timer_counter = 0; // number of cycles until next timers update
   double emulation_period = 0.0; // time between next cycle in seconds
-  std::map<std::string, unsigned int> keymap = { // maps from key name to key id
-	  {"0", 0},
-	  {"1", 1},
-	  {"2", 2},
-	  {"3", 3},
-	  {"4", 4},
-	  {"5", 5},
-	  {"6", 6},
-	  {"7", 7},
-	  {"8", 8},
-	  {"9", 9},
-	  {"A", 10},
-	  {"B", 11},
-	  {"C", 12},
-	  {"D", 13},
-	  {"E", 14},
-	  {"F", 15}
-  };
+  double timer_period = 0.0; // number of cycles between timers updates
+  std::uint64_t cycles = 0; // number of executed cycles
+  std::vector<PendingKey> pending_keys; // input events queued since last run, ordered by timestamp
+  std::vector<KeyEvent> key_log; // every key transition applied to the cpu
+  std::uint32_t seed = 0; // seed of cpu's random number generator
+  std::uint64_t rom_id = 0; // hash of the loaded rom, checked when restoring snapshots
+  FrameRecorder *frame_recorder = nullptr; // receives display on every timers update when set
+  std::unique_ptr<Chip8::TraceBuffer> trace; // last executed instructions, dumped when cpu throws
+
+  /**
+   * \brief Counts cycles up to end without executing them, updating only timers.
+   */
+  void skip_until(std::uint64_t end);
+
+  /**
+   * \brief Counts one executed cycle towards the next timers update, updates timers when it's due.
+   */
+  void tick_timers() {
+	timer_counter -= 1.0;
+	while (timer_counter <= 0.0) {
+	  cpu.update_timers();
+	  timer_counter += timer_period;
+	  if (frame_recorder)
+		frame_recorder->capture(cpu);
+	}
+  }
 
 public:
   /** \brief CPU to emulate */
@@ -40,26 +74,135 @@ public:
   /**
    * \brief Loads emulation configuration.
    *
+   * Cpu's random number generator is seeded with a random seed.
+   *
    * @param config configuration struct containing settings i.e. quirk flags, emulation period etc.
    */
   void load_config(const RomConf &config);
 
+  /**
+   * \brief Loads emulation configuration with given random seed.
+   *
+   * @param config configuration struct containing settings i.e. quirk flags, emulation period etc.
+   * @param random_seed seed for cpu's random number generator
+   */
+  void load_config(const RomConf &config, std::uint32_t random_seed);
+
+  /**
+   * \brief Captures cpu state together with cycle and timer counters.
+   *
+   * @return snapshot from which emulation continues exactly as it would from this point
+   */
+  [[nodiscard]] Snapshot snapshot() const;
+
+  /**
+   * \brief Continues emulation from a snapshot instead of booting the rom.
+   *
+   * Configuration with the same rom, speed, quirks and XO-CHIP mode must be loaded first, otherwise runtime error is
+   * thrown and the emulator is left unchanged. Key log and queued key transitions are cleared, cycle count continues
+   * from the snapshot.
+   *
+   * @param snapshot snapshot taken by snapshot()
+   */
+  void restore(const Snapshot &snapshot);
+
   /**
    * \brief Sets given key to value.
    *
-   * @param key string representing a key
+   * Key transition is applied immediately and recorded in key log with current cycle number.
+   *
+   * @param key key number in range 0-15 inclusive
    * @param value is key set
    */
-  void set_key(const std::string &key, bool value);
+  void set_key(unsigned int key, bool value);
+
+  /**
+   * \brief Queues key transition which happened at given host time.
+   *
+   * Queued transitions are applied by the next call to run at the cycle corresponding to their timestamp. Events
+   * must be queued in timestamp order. Throws runtime error when key is out of range.
+   *
+   * @param key key number in range 0-15 inclusive
+   * @param value is key set
+   * @param timestamp host time at which the key changed
+   */
+  void push_key(unsigned int key, bool value, Clock::time_point timestamp);
 
   /**
    * \brief Runs emulation cycle.
    *
-   * Executes cpu's cycles and updates it's timers as many times as they should in time delta.
+   * Executes cpu's cycles and updates it's timers as many times as they should in time delta. Host time interval
+   * from now - delta to now is mapped onto executed cycles and every queued key transition is applied at the cycle
+   * corresponding to its timestamp.
    *
    * @param delta time between calls of this function
+   * @param now host time at the end of time delta
+   */
+  void run(std::chrono::duration<double> delta, Clock::time_point now = Clock::now());
+
+  /**
+   * \brief Executes cpu's cycles until given number of cycles is reached.
+   *
+   * Timers are updated every timer period worth of cycles, so emulation depends only on the number of executed
+   * cycles and not on the host timing. While cpu waits for a key in Fx0A, cycles are only counted and timers updated,
+   * set_key with a pressed key wakes it up.
+   *
+   * @param end number of cycles to reach
+   */
+  void run_until(std::uint64_t end);
+
+  /**
+   * \brief Advances time like run, but without executing any instruction.
+   *
+   * Cycles are counted and timers updated exactly as if the current instruction was executed over and over, which is
+   * what happens while the cpu sits on an instruction leaving its state unchanged, e.g. Fx0A without pressed key or
+   * jump to itself. Queued key transitions stay queued.
+   *
+   * @param delta time to skip
+   */
+  void idle(std::chrono::duration<double> delta);
+
+  /**
+   * \brief Captures display into recorder on every timers update i.e. every emulated frame.
+   *
+   * @param recorder recorder receiving frames, nullptr stops capturing
+   */
+  void capture_frames(FrameRecorder *recorder) { frame_recorder = recorder; }
+
+  /**
+   * \brief Remembers last executed instructions and dumps them to standard error when cpu throws.
+   *
+   * @param capacity number of remembered instructions, 0 turns tracing off
+   */
+  void enable_trace(std::size_t capacity);
+
+  /**
+   * \brief Gets trace of last executed instructions, nullptr when tracing is off.
+   */
+  [[nodiscard]] const Chip8::TraceBuffer *trace_buffer() const { return trace.get(); }
+
+  /**
+   * \brief Gets seed of cpu's random number generator.
+   *
+   * @return seed used when configuration was loaded
+   */
+  [[nodiscard]] std::uint32_t random_seed() const { return seed; }
+
+  /**
+   * \brief Gets number of executed cycles.
+   *
+   * @return number of cpu cycles executed since configuration was loaded
+   */
+  [[nodiscard]] std::uint64_t cycle_count() const { return cycles; }
+
+  /**
+   * \brief Gets every key transition applied so far.
+   *
+   * Together with configuration the log is enough to replay emulation exactly.
+   *
+   * @return key transitions in order of application
    */
-  void run(std::chrono::duration<double> delta);
+  [[nodiscard]] const std::vector<KeyEvent> &key_events() const { return key_log; }
 
   /**
    * \brief Gets if sound should be playing.
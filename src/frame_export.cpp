@@ -0,0 +1,111 @@
+#include "frame_export.hpp"
+
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+FrameExporter::FrameExporter(std::string name) : name(std::move(name)) {
+  int fd = shm_open(this->name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+	throw std::runtime_error("unable to create shared memory segment " + this->name);
+
+  if (ftruncate(fd, sizeof(SharedFrame)) != 0) {
+	close(fd);
+	shm_unlink(this->name.c_str());
+	throw std::runtime_error("unable to resize shared memory segment " + this->name);
+  }
+
+  void *address = mmap(nullptr, sizeof(SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED) {
+	shm_unlink(this->name.c_str());
+	throw std::runtime_error("unable to map shared memory segment " + this->name);
+  }
+
+  // truncated segment is zeroed, which is a valid state of every field
+  shared = static_cast<SharedFrame *>(address);
+  shared->version = SHARED_FRAME_VERSION;
+  shared->magic.store(SHARED_FRAME_MAGIC, std::memory_order_release);
+}
+
+FrameExporter::~FrameExporter() {
+  munmap(shared, sizeof(SharedFrame));
+  shm_unlink(name.c_str());
+}
+
+void FrameExporter::publish(const Chip8::CPU &cpu, bool sound) {
+  const auto &planes = cpu.get_planes();
+
+  auto sequence = shared->sequence.load(std::memory_order_relaxed);
+  shared->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::size_t i = 0;
+  for (const auto &plane : planes) {
+	for (const auto &row : plane) {
+	  shared->pixels[i++].store(row.left, std::memory_order_relaxed);
+	  shared->pixels[i++].store(row.right, std::memory_order_relaxed);
+	}
+  }
+  shared->hires.store(cpu.hires(), std::memory_order_relaxed);
+  shared->sound.store(sound, std::memory_order_relaxed);
+  shared->frame.store(++frames, std::memory_order_relaxed);
+
+  shared->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+FrameReader::FrameReader(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+	throw std::runtime_error("unable to open shared memory segment " + name);
+
+  void *address = mmap(nullptr, sizeof(SharedFrame), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED)
+	throw std::runtime_error("unable to map shared memory segment " + name);
+
+  shared = static_cast<const SharedFrame *>(address);
+  if (shared->magic.load(std::memory_order_acquire) != SHARED_FRAME_MAGIC || shared->version != SHARED_FRAME_VERSION) {
+	munmap(const_cast<SharedFrame *>(shared), sizeof(SharedFrame));
+	throw std::runtime_error("not a chip8 frame segment " + name);
+  }
+}
+
+FrameReader::~FrameReader() {
+  munmap(const_cast<SharedFrame *>(shared), sizeof(SharedFrame));
+}
+
+bool FrameReader::read(FrameSnapshot &snapshot) const {
+  FrameSnapshot copy;
+
+  for (unsigned int attempt = 0; attempt < MAX_FRAME_READ_ATTEMPTS; attempt++) {
+	auto before = shared->sequence.load(std::memory_order_acquire);
+	if (before & 1u) {
+	  std::this_thread::yield(); // let the writer finish
+	  continue;
+	}
+
+	std::size_t i = 0;
+	for (auto &plane : copy.planes) {
+	  for (auto &row : plane) {
+		row.left = shared->pixels[i++].load(std::memory_order_relaxed);
+		row.right = shared->pixels[i++].load(std::memory_order_relaxed);
+	  }
+	}
+	copy.hires = shared->hires.load(std::memory_order_relaxed) != 0;
+	copy.sound = shared->sound.load(std::memory_order_relaxed) != 0;
+	copy.frame = shared->frame.load(std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (shared->sequence.load(std::memory_order_relaxed) == before) {
+	  if (copy.frame == 0)
+		return false;
+	  snapshot = copy;
+	  return true;
+	}
+  }
+  return false;
+}
@@ -0,0 +1,128 @@
+#ifndef CHIP8_EMU_CPP_FRAME_EXPORT_HPP
+#define CHIP8_EMU_CPP_FRAME_EXPORT_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "cpu.hpp"
+
+const std::uint32_t SHARED_FRAME_MAGIC = 0x42463843; // "C8FB" in little endian
+const std::uint32_t SHARED_FRAME_VERSION = 2; // 2 exports all planes in full resolution
+const std::size_t SHARED_FRAME_ROWS = Chip8::N_PLANES * Chip8::HIRES_HEIGHT; // rows of all planes
+const unsigned int MAX_FRAME_READ_ATTEMPTS = 1000; // reads racing with the writer before FrameReader gives up
+
+/**
+ * \brief Layout of shared memory segment with exported frame.
+ *
+ * Segment is guarded by a sequence lock: writer makes sequence odd, updates the frame and makes it even again. Reader
+ * copies the frame and retries if sequence was odd or changed meanwhile, so writer never waits on readers. All fields
+ * are atomics, which keeps concurrent access well defined without making writes any slower.
+ */
+struct SharedFrame {
+  std::atomic<std::uint32_t> magic; //!< SHARED_FRAME_MAGIC, written last when segment is initialized.
+  std::uint32_t version; //!< SHARED_FRAME_VERSION.
+  std::atomic<std::uint32_t> sequence; //!< Odd while frame is being written.
+  std::atomic<std::uint32_t> sound; //!< 1 when sound is on.
+  std::atomic<std::uint64_t> frame; //!< Number of frames published so far.
+  std::atomic<std::uint32_t> hires; //!< 1 in SCHIP high resolution mode.
+  std::array<std::atomic<std::uint64_t>, 2 * SHARED_FRAME_ROWS> pixels; //!< Left and right half of each plane's rows.
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared frame requires lock free 64-bit atomics");
+
+/**
+ * \brief Consistent copy of shared frame.
+ */
+struct FrameSnapshot {
+  std::uint64_t frame = 0; //!< Number of frames published before this one was read.
+  bool sound = false; //!< Sound state.
+  bool hires = false; //!< Is SCHIP high resolution mode on.
+  std::array<Chip8::Display, Chip8::N_PLANES> planes{}; //!< Every plane, see Chip8::CPU::get_planes.
+
+  /** \brief Width of the display in the current resolution. */
+  [[nodiscard]] unsigned int width() const { return hires ? Chip8::HIRES_WIDTH : Chip8::SCREEN_WIDTH; }
+
+  /** \brief Height of the display in the current resolution. */
+  [[nodiscard]] unsigned int height() const { return hires ? Chip8::HIRES_HEIGHT : Chip8::SCREEN_HEIGHT; }
+
+  /**
+   * \brief Gets color of the pixel, like Chip8::CPU::color.
+   *
+   * @return bit n is set when the pixel is on in plane n
+   */
+  [[nodiscard]] unsigned int color(unsigned int x, unsigned int y) const {
+	unsigned int color = 0;
+	for (unsigned int plane = 0; plane < Chip8::N_PLANES; plane++) {
+	  const Chip8::DisplayRow &row = planes[plane][y];
+	  std::uint64_t bit = x < 64 ? (row.left >> (63u - x)) & 1u : (row.right >> (127u - x)) & 1u;
+	  color |= static_cast<unsigned int>(bit) << plane;
+	}
+	return color;
+  }
+};
+
+/**
+ * \brief Publishes frames into POSIX shared memory segment, so that other processes can read them.
+ *
+ * Segment is removed when exporter is destroyed.
+ */
+class FrameExporter {
+  std::string name;
+  SharedFrame *shared = nullptr;
+  std::uint64_t frames = 0;
+
+public:
+  /**
+   * \brief Creates shared memory segment.
+   *
+   * Throws runtime error if segment can't be created.
+   *
+   * @param name name of the segment e.g. "/chip8", see shm_open
+   */
+  explicit FrameExporter(std::string name);
+  FrameExporter(const FrameExporter &) = delete;
+  FrameExporter &operator=(const FrameExporter &) = delete;
+  ~FrameExporter();
+
+  /**
+   * \brief Publishes current display of cpu as the next frame.
+   *
+   * @param cpu cpu which display is exported
+   * @param sound whether sound is on
+   */
+  void publish(const Chip8::CPU &cpu, bool sound);
+};
+
+/**
+ * \brief Reads frames published by FrameExporter in another process.
+ */
+class FrameReader {
+  const SharedFrame *shared = nullptr;
+
+public:
+  /**
+   * \brief Opens shared memory segment.
+   *
+   * Throws runtime error if segment doesn't exist or isn't a frame segment.
+   *
+   * @param name name of the segment given to FrameExporter
+   */
+  explicit FrameReader(const std::string &name);
+  FrameReader(const FrameReader &) = delete;
+  FrameReader &operator=(const FrameReader &) = delete;
+  ~FrameReader();
+
+  /**
+   * \brief Copies latest frame.
+   *
+   * Gives up after MAX_FRAME_READ_ATTEMPTS reads overlapping with the writer, so a writer which died while
+   * publishing doesn't block the reader.
+   *
+   * @param snapshot receives the frame, unchanged when false is returned
+   * @return false if nothing has been published yet or no consistent frame could be read
+   */
+  bool read(FrameSnapshot &snapshot) const;
+};
+
+#endif //CHIP8_EMU_CPP_FRAME_EXPORT_HPP
@@ -0,0 +1,180 @@
+#include "frame_recorder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+const char RECORDING_MAGIC[4] = {'C', '8', 'R', 'C'};
+const std::uint32_t RECORDING_VERSION = 2; // 2 stores all planes in full resolution
+const unsigned int RECORDING_RATE = 60; // frames are captured on every timers update
+const std::size_t MAX_RUN = 0x80;
+
+void write_u16(std::ostream &out, unsigned int value) {
+  out.put(static_cast<char>(value & 0xFFu));
+  out.put(static_cast<char>((value >> 8u) & 0xFFu));
+}
+
+unsigned int read_u16(std::istream &in) {
+  unsigned int low = static_cast<unsigned char>(in.get());
+  unsigned int high = static_cast<unsigned char>(in.get());
+  return low | (high << 8u);
+}
+
+/**
+ * Encodes XOR delta of two frames, returns number of bytes written into out.
+ */
+std::size_t encode_delta(const RecordedFrame &previous, const RecordedFrame &frame, unsigned char *out) {
+  std::size_t size = 0;
+  std::size_t i = 0;
+
+  while (i < RECORDING_FRAME_SIZE) {
+	std::size_t run = 0;
+	while (i + run < RECORDING_FRAME_SIZE && run < MAX_RUN && previous[i + run] == frame[i + run])
+	  run++;
+
+	if (run > 0) {
+	  out[size++] = static_cast<unsigned char>(run - 1);
+	} else {
+	  while (i + run < RECORDING_FRAME_SIZE && run < MAX_RUN && previous[i + run] != frame[i + run])
+		run++;
+	  out[size++] = static_cast<unsigned char>(0x80u | (run - 1));
+	  for (std::size_t j = i; j < i + run; j++)
+		out[size++] = previous[j] ^ frame[j];
+	}
+	i += run;
+  }
+  return size;
+}
+}
+
+void record_frame(const Chip8::CPU &cpu, RecordedFrame &frame) {
+  frame[0] = cpu.hires() ? RECORDING_HIRES : 0;
+  unsigned char *out = frame.data() + 1;
+  for (const auto &plane : cpu.get_planes()) {
+	for (const auto &row : plane) {
+	  for (unsigned int byte = 0; byte < 8; byte++)
+		*out++ = static_cast<unsigned char>(row.left >> (56u - 8 * byte));
+	  for (unsigned int byte = 0; byte < 8; byte++)
+		*out++ = static_cast<unsigned char>(row.right >> (56u - 8 * byte));
+	}
+  }
+}
+
+FrameRecorder::FrameRecorder(const std::string &path, std::size_t queue_size) :
+	file(path, std::ofstream::binary), queue(std::max<std::size_t>(1, queue_size)) {
+  if (!file.is_open())
+	throw std::runtime_error("unable to create recording file at: " + path);
+
+  file.write(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+  for (unsigned int shift = 0; shift < 32; shift += 8)
+	file.put(static_cast<char>((RECORDING_VERSION >> shift) & 0xFFu));
+  write_u16(file, Chip8::HIRES_WIDTH);
+  write_u16(file, Chip8::HIRES_HEIGHT);
+  write_u16(file, RECORDING_RATE);
+
+  writer = std::thread(&FrameRecorder::write_frames, this);
+}
+
+FrameRecorder::~FrameRecorder() {
+  finish();
+}
+
+void FrameRecorder::capture(const Chip8::CPU &cpu) {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (finished)
+	return;
+
+  if (queued == queue.size()) {
+	stalls++;
+	not_full.wait(lock, [&] { return queued < queue.size(); });
+  }
+
+  record_frame(cpu, queue[(head + queued) % queue.size()]);
+  queued++;
+  frames++;
+  lock.unlock();
+  not_empty.notify_one();
+}
+
+void FrameRecorder::finish() {
+  {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (finished)
+	  return;
+	finished = true;
+  }
+  not_empty.notify_one();
+  writer.join();
+  file.close();
+}
+
+void FrameRecorder::write_frames() {
+  RecordedFrame previous{};
+  RecordedFrame frame{};
+  // worst case is a literal header every MAX_RUN bytes
+  std::array<unsigned char, RECORDING_FRAME_SIZE + RECORDING_FRAME_SIZE / MAX_RUN + 1> encoded{};
+
+  while (true) {
+	{
+	  std::unique_lock<std::mutex> lock(mutex);
+	  not_empty.wait(lock, [&] { return queued > 0 || finished; });
+	  if (queued == 0)
+		return;
+
+	  frame = queue[head];
+	  head = (head + 1) % queue.size();
+	  queued--;
+	}
+	not_full.notify_one();
+
+	std::size_t size = encode_delta(previous, frame, encoded.data());
+	file.write(reinterpret_cast<const char *>(encoded.data()), static_cast<std::streamsize>(size));
+	previous = frame;
+  }
+}
+
+RecordingReader::RecordingReader(const std::string &path) : file(path, std::ifstream::binary) {
+  if (!file.is_open())
+	throw std::runtime_error("unable to open recording file at: " + path);
+
+  char magic[sizeof(RECORDING_MAGIC)];
+  file.read(magic, sizeof(magic));
+  std::uint32_t version = 0;
+  for (unsigned int shift = 0; shift < 32; shift += 8)
+	version |= static_cast<std::uint32_t>(static_cast<unsigned char>(file.get())) << shift;
+  unsigned int width = read_u16(file);
+  unsigned int height = read_u16(file);
+  frame_rate = read_u16(file);
+
+  if (!file || !std::equal(magic, magic + sizeof(magic), RECORDING_MAGIC))
+	throw std::runtime_error("not a recording file: " + path);
+  if (version != RECORDING_VERSION || width != Chip8::HIRES_WIDTH || height != Chip8::HIRES_HEIGHT)
+	throw std::runtime_error("unsupported recording file: " + path);
+}
+
+bool RecordingReader::next() {
+  if (file.peek() == std::ifstream::traits_type::eof())
+	return false;
+
+  std::size_t i = 0;
+  while (i < RECORDING_FRAME_SIZE) {
+	int token = file.get();
+	if (token == std::ifstream::traits_type::eof())
+	  throw std::runtime_error("truncated recording");
+
+	std::size_t run = (static_cast<unsigned int>(token) & 0x7Fu) + 1;
+	if (i + run > RECORDING_FRAME_SIZE)
+	  throw std::runtime_error("malformed recording");
+
+	if (token & 0x80) {
+	  for (std::size_t j = i; j < i + run; j++) {
+		int delta = file.get();
+		if (delta == std::ifstream::traits_type::eof())
+		  throw std::runtime_error("truncated recording");
+		current[j] ^= static_cast<unsigned char>(delta);
+	  }
+	}
+	i += run;
+  }
+  return true;
+}
@@ -0,0 +1,164 @@
+#ifndef CHIP8_EMU_CPP_FRAME_RECORDER_HPP
+#define CHIP8_EMU_CPP_FRAME_RECORDER_HPP
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cpu.hpp"
+
+const std::size_t RECORDING_PLANE_SIZE = Chip8::HIRES_WIDTH * Chip8::HIRES_HEIGHT / 8; // one packed plane
+const std::size_t RECORDING_FRAME_SIZE = 1 + Chip8::N_PLANES * RECORDING_PLANE_SIZE; // flags and all planes
+const unsigned char RECORDING_HIRES = 0x1; // frame flag set in SCHIP high resolution mode
+const std::size_t DEFAULT_RECORDING_QUEUE = 256; // frames
+
+/**
+ * \brief Single recorded frame.
+ *
+ * First byte holds flags (RECORDING_HIRES), followed by every plane with 128x64 pixels, 8 pixels per byte with the
+ * most significant bit leftmost. In low resolution mode only the top left 64x32 pixels of each plane are used.
+ */
+using RecordedFrame = std::array<unsigned char, RECORDING_FRAME_SIZE>;
+
+/**
+ * \brief Stores cpu's display with all planes and resolution into a frame.
+ *
+ * @param cpu cpu whose display is stored
+ * @param frame destination frame
+ */
+void record_frame(const Chip8::CPU &cpu, RecordedFrame &frame);
+
+/** \brief Was the frame recorded in SCHIP high resolution mode. */
+inline bool recorded_hires(const RecordedFrame &frame) {
+  return frame[0] & RECORDING_HIRES;
+}
+
+/**
+ * \brief Gets color of the recorded pixel, like Chip8::CPU::color.
+ *
+ * @param frame recorded frame
+ * @param x column, less than 128 in high resolution and 64 in low resolution
+ * @param y row, less than 64 in high resolution and 32 in low resolution
+ * @return bit n is set when the pixel is on in plane n
+ */
+inline unsigned int recorded_color(const RecordedFrame &frame, unsigned int x, unsigned int y) {
+  unsigned int bit = y * Chip8::HIRES_WIDTH + x;
+  unsigned int color = 0;
+  for (unsigned int plane = 0; plane < Chip8::N_PLANES; plane++) {
+	unsigned char byte = frame[1 + plane * RECORDING_PLANE_SIZE + bit / 8];
+	color |= ((byte >> (7u - bit % 8)) & 1u) << plane;
+  }
+  return color;
+}
+
+/**
+ * \brief Records every emulated frame into a file.
+ *
+ * File starts with magic "C8RC", version (u32), maximal display width and height and frame rate (u16 each), all
+ * little endian. Each frame (see RecordedFrame) is stored as XOR delta against the previous one (first frame against
+ * blank display) encoded with run length encoding: byte n < 0x80 stands for n + 1 unchanged bytes, byte n >= 0x80 is
+ * followed by (n & 0x7F) + 1 literal delta bytes. Frames are encoded until they cover all RECORDING_FRAME_SIZE bytes.
+ *
+ * Capturing only copies the display into a bounded queue, encoding and writing happens on a background thread.
+ * Recording is lossless, including SCHIP high resolution and XO-CHIP planes, so when the queue is full capturing
+ * waits for the writer.
+ */
+class FrameRecorder {
+  std::ofstream file;
+  std::vector<RecordedFrame> queue; // ring buffer
+  std::size_t head = 0; // index of the oldest queued frame
+  std::size_t queued = 0;
+  bool finished = false;
+  std::uint64_t frames = 0;
+  std::uint64_t stalls = 0; // number of captures which waited for free slot
+  std::mutex mutex;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::thread writer;
+
+  void write_frames();
+
+public:
+  /**
+   * \brief Creates recording file and starts writer thread.
+   *
+   * Throws runtime error if file can't be created.
+   *
+   * @param path recording file
+   * @param queue_size maximum number of frames waiting to be written
+   */
+  explicit FrameRecorder(const std::string &path, std::size_t queue_size = DEFAULT_RECORDING_QUEUE);
+  FrameRecorder(const FrameRecorder &) = delete;
+  FrameRecorder &operator=(const FrameRecorder &) = delete;
+
+  /**
+   * \brief Writes remaining frames and closes the file.
+   */
+  ~FrameRecorder();
+
+  /**
+   * \brief Queues current display of cpu as the next frame.
+   *
+   * @param cpu recorded cpu
+   */
+  void capture(const Chip8::CPU &cpu);
+
+  /**
+   * \brief Writes remaining frames and closes the file, further captures are ignored.
+   */
+  void finish();
+
+  /**
+   * \brief Number of captured frames.
+   */
+  [[nodiscard]] std::uint64_t frame_count() const { return frames; }
+
+  /**
+   * \brief Number of captures which had to wait for the writer.
+   */
+  [[nodiscard]] std::uint64_t stall_count() const { return stalls; }
+};
+
+/**
+ * \brief Decodes recording written by FrameRecorder frame by frame.
+ */
+class RecordingReader {
+  std::ifstream file;
+  RecordedFrame current{};
+  unsigned int frame_rate = 0;
+
+public:
+  /**
+   * \brief Opens recording and reads its header.
+   *
+   * Throws runtime error if file can't be opened or isn't a recording.
+   *
+   * @param path recording file
+   */
+  explicit RecordingReader(const std::string &path);
+
+  /**
+   * \brief Frame rate of the recording in Hz.
+   */
+  [[nodiscard]] unsigned int rate() const { return frame_rate; }
+
+  /**
+   * \brief Decodes next frame.
+   *
+   * Throws runtime error if frame is truncated or malformed.
+   *
+   * @return false at the end of recording
+   */
+  bool next();
+
+  /**
+   * \brief Last decoded frame.
+   */
+  [[nodiscard]] const RecordedFrame &frame() const { return current; }
+};
+
+#endif //CHIP8_EMU_CPP_FRAME_RECORDER_HPP
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "frame_recorder.hpp"
+#include "movie.hpp"
+
+const std::string RESOURCE_DIR = "resources";
+
+int replay_movie(const std::string &path, const std::filesystem::path &resources_path,
+				 const std::string &capture_path);
+
+int main(int argc, char *argv[]) {
+  if (argc < 3 || std::string(argv[1]) != "--replay") {
+	std::cout << "usage: " << argv[0] << " --replay <MOVIE> [--capture <RECORDING>] [--resources <DIR>]" << std::endl;
+	std::cout << "rom of the movie is looked up in DIR, by default " << RESOURCE_DIR
+			  << " in the current directory" << std::endl;
+	return 0;
+  }
+
+  std::string capture_path;
+  std::filesystem::path resources_path = std::filesystem::current_path() / RESOURCE_DIR;
+  for (int i = 3; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--capture" && i + 1 < argc)
+	  capture_path = argv[++i];
+	else if (option == "--resources" && i + 1 < argc)
+	  resources_path = argv[++i];
+  }
+
+  try {
+	return replay_movie(argv[2], resources_path, capture_path);
+  } catch (const std::runtime_error &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
+
+int replay_movie(const std::string &path, const std::filesystem::path &resources_path,
+				 const std::string &capture_path) {
+  Movie movie = Movie::load(path, resources_path);
+  std::unique_ptr<FrameRecorder> frames;
+  if (!capture_path.empty())
+	frames = std::make_unique<FrameRecorder>(capture_path);
+
+  auto start = std::chrono::steady_clock::now();
+  ReplayResult result = replay(movie, frames.get());
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  if (frames) {
+	frames->finish();
+	std::cout << "captured " << frames->frame_count() << " frames, " << frames->stall_count()
+			  << " waited for the writer" << std::endl;
+  }
+
+  double emulated = static_cast<double>(result.cycles) * movie.config.emulation_period;
+  std::cout << "replayed " << result.cycles << " cycles (" << emulated << " s) in " << elapsed.count() << " s, "
+			<< emulated / elapsed.count() << "x real time" << std::endl;
+
+  if (!result.matched) {
+	std::cout << "framebuffer mismatch at cycle " << result.mismatch_cycle << " after " << result.verified
+			  << " matched checkpoints" << std::endl;
+	return 1;
+  }
+
+  std::cout << "all " << result.verified << " checkpoints matched" << std::endl;
+  return 0;
+}
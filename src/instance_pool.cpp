@@ -0,0 +1,125 @@
+#include "instance_pool.hpp"
+
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+const int MPOL_BIND_POLICY = 2; // MPOL_BIND from linux/mempolicy.h, used without linking libnuma
+}
+
+InstancePool::InstancePool(std::size_t capacity, std::shared_ptr<const Chip8::MemoryImage> image, const RomConf &rom,
+						   const InstancePoolConf &conf) : count(capacity), used(capacity, false) {
+  if (capacity == 0)
+	throw std::runtime_error("instance pool needs at least one cpu");
+  if (capacity > UINT32_MAX)
+	throw std::runtime_error("too many cpus for instance pool");
+
+  map_arena(conf);
+
+  // cpus are constructed here, so that pages are first touched after binding the arena to its node
+  std::size_t constructed = 0;
+  try {
+	for (; constructed < count; constructed++) {
+	  Chip8::CPU *cpu;
+	  if (image)
+		cpu = new(cpus + constructed) Chip8::CPU(image, rom.load_store_quirk, rom.shift_quirk, rom.wrapping);
+	  else
+		cpu = new(cpus + constructed) Chip8::CPU(rom.load_store_quirk, rom.shift_quirk, rom.wrapping);
+	  if (rom.schip)
+		cpu->set_schip(true);
+	  if (rom.xo_chip)
+		cpu->set_xo_chip(true);
+	}
+  } catch (...) {
+	for (std::size_t i = 0; i < constructed; i++)
+	  cpus[i].~CPU();
+	munmap(cpus, arena_size);
+	throw;
+  }
+
+  // lowest addresses are handed out first
+  free_slots.reserve(count);
+  for (std::size_t i = count; i > 0; i--)
+	free_slots.push_back(static_cast<std::uint32_t>(i - 1));
+}
+
+InstancePool::~InstancePool() {
+  for (std::size_t i = 0; i < count; i++)
+	cpus[i].~CPU();
+  munmap(cpus, arena_size);
+}
+
+void InstancePool::map_arena(const InstancePoolConf &conf) {
+  arena_size = (count * sizeof(Chip8::CPU) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+  void *arena = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (conf.huge_pages) {
+	arena = mmap(nullptr, arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (arena != MAP_FAILED)
+	  backing = "explicit huge pages";
+  }
+#endif
+  if (arena == MAP_FAILED) {
+	// no huge pages reserved, ask for transparent ones instead
+	arena = mmap(nullptr, arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (arena == MAP_FAILED)
+	  throw std::runtime_error("unable to map instance pool of " + std::to_string(arena_size) + " bytes");
+#ifdef MADV_HUGEPAGE
+	if (conf.huge_pages && madvise(arena, arena_size, MADV_HUGEPAGE) == 0)
+	  backing = "transparent huge pages";
+#endif
+  }
+
+  if (conf.numa_node >= 0) {
+	bool bound = false;
+#ifdef SYS_mbind
+	if (conf.numa_node < 64) {
+	  unsigned long nodes = 1ul << static_cast<unsigned int>(conf.numa_node);
+	  bound = syscall(SYS_mbind, arena, arena_size, MPOL_BIND_POLICY, &nodes, sizeof(nodes) * 8 + 1, 0) == 0;
+	}
+#endif
+	if (!bound) {
+	  munmap(arena, arena_size);
+	  throw std::runtime_error("unable to bind instance pool to numa node " + std::to_string(conf.numa_node));
+	}
+  }
+
+  cpus = static_cast<Chip8::CPU *>(arena);
+}
+
+Chip8::CPU &InstancePool::acquire() {
+  if (free_slots.empty())
+	throw std::runtime_error("instance pool is exhausted");
+
+  std::uint32_t slot = free_slots.back();
+  free_slots.pop_back();
+  used[slot] = true;
+
+  Chip8::CPU &cpu = cpus[slot];
+  cpu.reset();
+  cpu.attach_trace(nullptr);
+  cpu.watch_writes(0, nullptr);
+  return cpu;
+}
+
+void InstancePool::release(Chip8::CPU &cpu) {
+  std::size_t slot = index_of(cpu);
+  if (!used[slot])
+	throw std::runtime_error("cpu was already released to instance pool");
+
+  used[slot] = false;
+  free_slots.push_back(static_cast<std::uint32_t>(slot));
+}
+
+std::size_t InstancePool::index_of(const Chip8::CPU &cpu) const {
+  const Chip8::CPU *address = &cpu;
+  if (address < cpus || address >= cpus + count)
+	throw std::runtime_error("cpu doesn't belong to instance pool");
+  return static_cast<std::size_t>(address - cpus);
+}
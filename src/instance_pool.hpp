@@ -0,0 +1,101 @@
+#ifndef CHIP8_EMU_CPP_INSTANCE_POOL_HPP
+#define CHIP8_EMU_CPP_INSTANCE_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "conf.hpp"
+#include "cpu.hpp"
+
+/**
+ * \brief Where memory of instance pool comes from.
+ */
+struct InstancePoolConf {
+  bool huge_pages = true; //!< Back the arena with 2 MB pages, explicit ones if reserved, transparent otherwise.
+  int numa_node = -1; //!< Bind the arena to this NUMA node, -1 leaves placement to the kernel.
+};
+
+/**
+ * \brief Fixed number of cpus living in one contiguous arena, handed out and taken back in constant time.
+ *
+ * Every cpu is constructed once, when the pool is created, so acquiring one only resets it without allocating.
+ * Arena is mapped in 2 MB huge pages when possible, so that thousands of cpus need only a few TLB entries, and can
+ * be bound to a NUMA node before it's first touched, so that all cpus live next to the threads running them.
+ *
+ * Cpus share the pool's memory image and quirks. Without image, their memory holds fonts only after reset and rom
+ * must be loaded into every acquired cpu.
+ */
+class InstancePool {
+  Chip8::CPU *cpus = nullptr; // first cpu of the arena
+  std::size_t count = 0;
+  std::size_t arena_size = 0;
+  const char *backing = "4 KB pages";
+  std::vector<std::uint32_t> free_slots; // stack of released cpu indices, never reallocated
+  std::vector<bool> used;
+
+  void map_arena(const InstancePoolConf &conf);
+
+public:
+  /**
+   * \brief Maps arena and constructs all cpus in it.
+   *
+   * Throws runtime error if arena can't be mapped or bound to requested NUMA node.
+   *
+   * @param capacity number of cpus
+   * @param image rom shared by all cpus, may be null
+   * @param rom quirks and XO-CHIP mode of all cpus
+   * @param conf page size and NUMA placement of the arena
+   */
+  InstancePool(std::size_t capacity, std::shared_ptr<const Chip8::MemoryImage> image, const RomConf &rom,
+			   const InstancePoolConf &conf = {});
+  InstancePool(const InstancePool &) = delete;
+  InstancePool &operator=(const InstancePool &) = delete;
+  ~InstancePool();
+
+  /**
+   * \brief Takes a free cpu out of the pool.
+   *
+   * Cpu is reset as if it was just constructed, with trace and write watcher detached. Random number generator starts
+   * again from the cpu's last seed, so reacquired cpu repeats its sequence unless the caller seeds it. Throws runtime
+   * error when every cpu is in use.
+   *
+   * @return cpu owned by the pool until it's released
+   */
+  Chip8::CPU &acquire();
+
+  /**
+   * \brief Returns cpu to the pool.
+   *
+   * Throws runtime error for cpus which don't come from this pool or are already released.
+   *
+   * @param cpu cpu returned by acquire
+   */
+  void release(Chip8::CPU &cpu);
+
+  /**
+   * \brief Gets position of the cpu in the arena.
+   *
+   * @param cpu cpu returned by acquire
+   * @return index less than capacity(), stable for the lifetime of the pool
+   */
+  [[nodiscard]] std::size_t index_of(const Chip8::CPU &cpu) const;
+
+  /** \brief Total number of cpus. */
+  [[nodiscard]] std::size_t capacity() const { return count; }
+
+  /** \brief Number of cpus which can still be acquired. */
+  [[nodiscard]] std::size_t available() const { return free_slots.size(); }
+
+  /** \brief Size of the arena in bytes, rounded up to whole huge pages. */
+  [[nodiscard]] std::size_t memory_size() const { return arena_size; }
+
+  /**
+   * \brief Gets kind of pages backing the arena.
+   *
+   * @return "explicit huge pages", "transparent huge pages" or "4 KB pages"
+   */
+  [[nodiscard]] const char *page_backing() const { return backing; }
+};
+
+#endif //CHIP8_EMU_CPP_INSTANCE_POOL_HPP
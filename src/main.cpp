@@ -1,14 +1,17 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <json.hpp>
 #include "conf.hpp"
 #include "app.hpp"
+#include "rom_pack.hpp"
 
 using json = nlohmann::json;
 
 const std::string RESOURCE_DIR = "resources";
+const std::string ROM_PACK_FILE = "roms.pack";
 
 json load_configuration_file(const std::string &name);
 
@@ -18,20 +21,35 @@ int main(int argc, char *argv[]) {
 	return 0;
   }
 
-  // Load rom info
-  json j = load_configuration_file("roms.json");
-
   std::string rom_name = argv[1];
-  json rom_data;
+  std::filesystem::path resources_path = std::filesystem::current_path().append(RESOURCE_DIR);
 
-  try {
-	rom_data = j[rom_name];
-  } catch (json::out_of_range &) {
-	std::cerr << "got unknown rom" << std::endl;
-	return 0;
+  // Load rom info, rom pack is preferred because it doesn't require parsing roms.json nor opening rom files, unless
+  // roms.json or the rom changed since it was built
+  std::unique_ptr<RomPack> rom_pack;
+  const RomPackEntry *entry = nullptr;
+  RomConf config;
+
+  if (std::filesystem::exists(resources_path / ROM_PACK_FILE)) {
+	rom_pack = std::make_unique<RomPack>((resources_path / ROM_PACK_FILE).string());
+	entry = rom_pack->find(rom_name);
+	if (entry && rom_pack->outdated(*entry, resources_path)) {
+	  std::cerr << ROM_PACK_FILE << " is older than roms.json or the rom, ignoring it until rom_pack target is rebuilt"
+				<< std::endl;
+	  entry = nullptr;
+	}
   }
 
-  RomConf config(rom_data, std::filesystem::current_path().append(RESOURCE_DIR));
+  if (entry) {
+	config = rom_pack->config(*entry, resources_path);
+  } else {
+	json j = load_configuration_file("roms.json");
+	if (!j.contains(rom_name)) {
+	  std::cerr << "got unknown rom" << std::endl;
+	  return 0;
+	}
+	config = RomConf(j[rom_name], resources_path);
+  }
 
   // Load app config
   json k = load_configuration_file("app_conf.json");
@@ -39,6 +57,39 @@ int main(int argc, char *argv[]) {
 
   App app(app_configuration);
   app.init_emulation(config);
+
+  bool cold_boot = false; // boot from PC_INIT even when rom has a snapshot
+  for (int i = 2; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--record" && i + 1 < argc) {
+	  app.record_movie(argv[++i], resources_path);
+	  cold_boot = true; // movies are replayed from boot
+	} else if (option == "--cold") {
+	  cold_boot = true;
+	} else if (option == "--export-shm" && i + 1 < argc) {
+	  app.export_frames(argv[++i]);
+	} else if (option == "--capture" && i + 1 < argc) {
+	  app.capture_frames(argv[++i]);
+	} else if (option == "--trace" && i + 1 < argc) {
+	  app.enable_trace(std::stoul(argv[++i]));
+	} else if (option == "--turbo" && i + 1 < argc) {
+	  std::string speed = argv[++i];
+	  app.enable_turbo(speed == "max" ? 0 : std::stod(speed));
+	} else {
+	  std::cerr << "unknown option " << option << std::endl;
+	  return 0;
+	}
+  }
+
+  if (!config.snapshot_location.empty() && !cold_boot) {
+	try {
+	  app.restore_snapshot(config.snapshot_location);
+	} catch (const std::runtime_error &e) {
+	  std::cerr << "ignoring snapshot " << config.snapshot_location << ": " << e.what() << ", booting the rom"
+				<< std::endl;
+	}
+  }
+
   app.run();
 
   return 0;
@@ -0,0 +1,232 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+#include "movie.hpp"
+
+namespace {
+const char MOVIE_MAGIC[4] = {'C', '8', 'M', 'V'};
+const std::uint16_t MOVIE_VERSION = 2; // 2 stores rom relative to resources directory
+
+const unsigned FLAG_LOAD_STORE_QUIRK = 0x1;
+const unsigned FLAG_SHIFT_QUIRK = 0x2;
+const unsigned FLAG_WRAPPING = 0x4;
+const unsigned FLAG_XO_CHIP = 0x8;
+const unsigned FLAG_SCHIP = 0x10;
+
+const unsigned KEY_PRESSED = 0x80;
+
+/**
+ * Writes little-endian number of given size.
+ */
+void put(std::ostream &out, std::uint64_t value, unsigned size) {
+  for (unsigned i = 0; i < size; i++)
+	out.put(static_cast<char>((value >> (8u * i)) & 0xFFu));
+}
+
+/**
+ * Writes number as LEB128, so that small cycle deltas take a single byte.
+ */
+void put_varint(std::ostream &out, std::uint64_t value) {
+  while (value >= 0x80) {
+	out.put(static_cast<char>((value & 0x7Fu) | 0x80u));
+	value >>= 7u;
+  }
+  out.put(static_cast<char>(value));
+}
+
+std::uint64_t get(std::istream &in, unsigned size) {
+  std::uint64_t value = 0;
+  for (unsigned i = 0; i < size; i++) {
+	int byte = in.get();
+	if (byte == std::char_traits<char>::eof())
+	  throw std::runtime_error("unexpected end of movie file");
+	value |= static_cast<std::uint64_t>(byte) << (8u * i);
+  }
+  return value;
+}
+
+std::uint64_t get_varint(std::istream &in) {
+  std::uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+	auto byte = get(in, 1);
+	value |= (byte & 0x7Fu) << shift;
+	if (!(byte & 0x80u))
+	  return value;
+  }
+  throw std::runtime_error("invalid number in movie file");
+}
+}
+
+void Movie::save(const std::string &path) const {
+  std::ofstream out(path, std::ofstream::binary);
+  if (!out.is_open())
+	throw std::runtime_error("unable to open movie file at: " + path);
+
+  out.write(MOVIE_MAGIC, sizeof(MOVIE_MAGIC));
+  put(out, MOVIE_VERSION, 2);
+
+  std::uint64_t period_bits;
+  std::memcpy(&period_bits, &config.emulation_period, sizeof(period_bits));
+  put(out, period_bits, 8);
+
+  unsigned flags = 0;
+  if (config.load_store_quirk)
+	flags |= FLAG_LOAD_STORE_QUIRK;
+  if (config.shift_quirk)
+	flags |= FLAG_SHIFT_QUIRK;
+  if (config.wrapping)
+	flags |= FLAG_WRAPPING;
+  if (config.xo_chip)
+	flags |= FLAG_XO_CHIP;
+  if (config.schip)
+	flags |= FLAG_SCHIP;
+  put(out, flags, 1);
+
+  put(out, rom.size(), 2);
+  out.write(rom.data(), static_cast<std::streamsize>(rom.size()));
+
+  put(out, seed, 4);
+  put(out, length, 8);
+
+  put(out, events.size(), 4);
+  std::uint64_t last_cycle = 0;
+  for (const auto &event : events) {
+	put_varint(out, event.cycle - last_cycle);
+	put(out, event.key | (event.value ? KEY_PRESSED : 0u), 1);
+	last_cycle = event.cycle;
+  }
+
+  put(out, checkpoints.size(), 4);
+  last_cycle = 0;
+  for (const auto &checkpoint : checkpoints) {
+	put_varint(out, checkpoint.cycle - last_cycle);
+	put(out, checkpoint.hash, 8);
+	last_cycle = checkpoint.cycle;
+  }
+
+  if (!out)
+	throw std::runtime_error("unable to write movie file at: " + path);
+}
+
+Movie Movie::load(const std::string &path, const std::filesystem::path &resources_path) {
+  std::ifstream in(path, std::ifstream::binary);
+  if (!in.is_open())
+	throw std::runtime_error("unable to open movie file at: " + path);
+
+  char magic[sizeof(MOVIE_MAGIC)];
+  in.read(magic, sizeof(magic));
+  if (!in || std::memcmp(magic, MOVIE_MAGIC, sizeof(magic)) != 0)
+	throw std::runtime_error("not a movie file: " + path);
+  if (get(in, 2) != MOVIE_VERSION)
+	throw std::runtime_error("unsupported movie version");
+
+  Movie movie;
+
+  std::uint64_t period_bits = get(in, 8);
+  std::memcpy(&movie.config.emulation_period, &period_bits, sizeof(period_bits));
+
+  auto flags = get(in, 1);
+  movie.config.load_store_quirk = flags & FLAG_LOAD_STORE_QUIRK;
+  movie.config.shift_quirk = flags & FLAG_SHIFT_QUIRK;
+  movie.config.wrapping = flags & FLAG_WRAPPING;
+  movie.config.xo_chip = flags & FLAG_XO_CHIP;
+  movie.config.schip = flags & FLAG_SCHIP;
+
+  movie.rom.resize(get(in, 2));
+  in.read(movie.rom.data(), static_cast<std::streamsize>(movie.rom.size()));
+  movie.config.rom_location = (resources_path / movie.rom).string();
+
+  movie.seed = static_cast<std::uint32_t>(get(in, 4));
+  movie.length = get(in, 8);
+
+  auto n_events = get(in, 4);
+  std::uint64_t cycle = 0;
+  for (std::uint64_t i = 0; i < n_events; i++) {
+	cycle += get_varint(in);
+	auto key = get(in, 1);
+	movie.events.push_back(KeyEvent{cycle, static_cast<unsigned char>(key & 0xFu), (key & KEY_PRESSED) != 0});
+  }
+
+  auto n_checkpoints = get(in, 4);
+  cycle = 0;
+  for (std::uint64_t i = 0; i < n_checkpoints; i++) {
+	cycle += get_varint(in);
+	movie.checkpoints.push_back(Checkpoint{cycle, get(in, 8)});
+  }
+
+  return movie;
+}
+
+MovieRecorder::MovieRecorder(std::string path, const RomConf &config, std::uint32_t seed,
+							 const std::filesystem::path &resources_path, std::uint64_t checkpoint_period) :
+	path(std::move(path)), checkpoint_period(checkpoint_period), next_checkpoint(checkpoint_period) {
+  auto rom_location = std::filesystem::path(config.rom_location).lexically_normal();
+  auto relative = rom_location.lexically_relative(resources_path.lexically_normal());
+  if (relative.empty() || *relative.begin() == "..")
+	throw std::runtime_error("rom " + config.rom_location + " isn't in resources directory " + resources_path.string());
+
+  movie.config = config;
+  movie.rom = relative.generic_string();
+  movie.seed = seed;
+}
+
+void MovieRecorder::update(const Emulator &emulator) {
+  if (emulator.cycle_count() < next_checkpoint)
+	return;
+
+  movie.checkpoints.push_back(Checkpoint{emulator.cycle_count(), frame_hash(emulator.cpu)});
+  next_checkpoint = emulator.cycle_count() + checkpoint_period;
+}
+
+void MovieRecorder::finish(const Emulator &emulator) {
+  movie.length = emulator.cycle_count();
+  if (movie.checkpoints.empty() || movie.checkpoints.back().cycle != movie.length)
+	movie.checkpoints.push_back(Checkpoint{movie.length, frame_hash(emulator.cpu)});
+  movie.events = emulator.key_events();
+  movie.save(path);
+}
+
+ReplayResult replay(const Movie &movie, FrameRecorder *frames) {
+  ReplayResult result;
+  Emulator emulator;
+  emulator.load_config(movie.config, movie.seed);
+  emulator.capture_frames(frames);
+
+  auto event = movie.events.cbegin();
+  for (const auto &checkpoint : movie.checkpoints) {
+	for (; event != movie.events.cend() && event->cycle <= checkpoint.cycle; event++) {
+	  emulator.run_until(event->cycle);
+	  emulator.set_key(event->key, event->value);
+	}
+
+	emulator.run_until(checkpoint.cycle);
+	if (frame_hash(emulator.cpu) != checkpoint.hash) {
+	  result.matched = false;
+	  result.mismatch_cycle = checkpoint.cycle;
+	  result.cycles = emulator.cycle_count();
+	  return result;
+	}
+	result.verified++;
+  }
+
+  for (; event != movie.events.cend(); event++) {
+	emulator.run_until(event->cycle);
+	emulator.set_key(event->key, event->value);
+  }
+  emulator.run_until(movie.length);
+
+  result.cycles = emulator.cycle_count();
+  return result;
+}
+
+std::uint64_t frame_hash(const Chip8::CPU &cpu) {
+  std::uint64_t hash = 0xcbf29ce484222325u;
+  for (unsigned int y = 0; y < cpu.display_height(); y++) {
+	for (unsigned int x = 0; x < cpu.display_width(); x++) {
+	  hash ^= static_cast<std::uint64_t>(cpu.color(x, y));
+	  hash *= 0x100000001b3u;
+	}
+  }
+  return hash;
+}
@@ -0,0 +1,129 @@
+#ifndef CHIP8_EMU_CPP_MOVIE_HPP
+#define CHIP8_EMU_CPP_MOVIE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "chip8/cpu.hpp"
+#include "conf.hpp"
+#include "emulator.hpp"
+
+const std::uint64_t DEFAULT_CHECKPOINT_PERIOD = 5000; // cycles between framebuffer hashes
+
+/**
+ * \brief Framebuffer hash taken at given cpu cycle.
+ */
+struct Checkpoint {
+  std::uint64_t cycle; //!< Number of cpu cycles executed before the hash was taken.
+  std::uint64_t hash; //!< Hash of the display.
+};
+
+/**
+ * \brief Recorded emulation session.
+ *
+ * Contains everything required to replay emulation exactly: rom configuration, seed of cpu's random number
+ * generator and every key transition with cycle at which it happened. Framebuffer hashes taken during recording
+ * allow to verify the replay. Rom is stored relative to the resources directory, so that movies can be replayed from
+ * any checkout.
+ */
+struct Movie {
+  RomConf config; //!< Configuration of the recorded rom, rom_location is resolved against resources directory.
+  std::string rom; //!< Rom location relative to resources directory, like "location" in roms.json.
+  std::uint32_t seed = 0; //!< Seed of cpu's random number generator.
+  std::uint64_t length = 0; //!< Number of cycles in the recording.
+  std::vector<KeyEvent> events; //!< Key transitions in order of application.
+  std::vector<Checkpoint> checkpoints; //!< Framebuffer hashes in order of cycles.
+
+  /**
+   * \brief Saves movie in binary format.
+   *
+   * Throws runtime error when file can't be written.
+   *
+   * @param path destination file
+   */
+  void save(const std::string &path) const;
+
+  /**
+   * \brief Loads movie from binary format.
+   *
+   * Throws runtime error when file can't be read or isn't a valid movie.
+   *
+   * @param path source file
+   * @param resources_path resources directory in which the rom is looked up
+   * @return loaded movie
+   */
+  static Movie load(const std::string &path, const std::filesystem::path &resources_path);
+};
+
+/**
+ * \brief Records emulation session into a movie.
+ */
+class MovieRecorder {
+  Movie movie;
+  std::string path;
+  std::uint64_t checkpoint_period;
+  std::uint64_t next_checkpoint;
+
+public:
+  /**
+   * \brief Starts recording of emulation which was loaded with given configuration and seed.
+   *
+   * Throws runtime error when the rom isn't located in resources directory.
+   *
+   * @param path file to which movie is saved
+   * @param config configuration of the rom
+   * @param seed seed of cpu's random number generator
+   * @param resources_path resources directory, rom location is stored relative to it
+   * @param checkpoint_period minimal number of cycles between framebuffer hashes
+   */
+  MovieRecorder(std::string path, const RomConf &config, std::uint32_t seed,
+				const std::filesystem::path &resources_path,
+				std::uint64_t checkpoint_period = DEFAULT_CHECKPOINT_PERIOD);
+
+  /**
+   * \brief Takes framebuffer hash if enough cycles passed since the last one.
+   *
+   * @param emulator recorded emulator
+   */
+  void update(const Emulator &emulator);
+
+  /**
+   * \brief Takes final framebuffer hash, copies key transitions and saves the movie.
+   *
+   * @param emulator recorded emulator
+   */
+  void finish(const Emulator &emulator);
+};
+
+/**
+ * \brief Result of movie replay.
+ */
+struct ReplayResult {
+  bool matched = true; //!< Did every framebuffer hash match.
+  std::uint64_t cycles = 0; //!< Number of replayed cycles.
+  std::size_t verified = 0; //!< Number of matched framebuffer hashes.
+  std::uint64_t mismatch_cycle = 0; //!< Cycle of the first mismatched hash, valid only when not matched.
+};
+
+/**
+ * \brief Replays movie as fast as possible.
+ *
+ * Runs emulation without any host timing, applies recorded key transitions at their cycles and compares
+ * framebuffer hashes at checkpoints. Replay stops at the first mismatch.
+ *
+ * @param movie movie to replay
+ * @param frames recorder capturing every replayed frame, may be null
+ * @return result of the replay
+ */
+ReplayResult replay(const Movie &movie, FrameRecorder *frames = nullptr);
+
+/**
+ * \brief Computes FNV-1a hash of cpu's display.
+ *
+ * @param cpu cpu which display is hashed
+ * @return 64-bit hash
+ */
+std::uint64_t frame_hash(const Chip8::CPU &cpu);
+
+#endif //CHIP8_EMU_CPP_MOVIE_HPP
@@ -0,0 +1,253 @@
+#include "perf_counters.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace {
+const std::array<const char *, N_PERF_EVENTS> EVENT_NAMES = {
+	"cycles", "instructions", "branches", "branch-misses", "L1d-misses", "L1i-misses", "L2-misses", "LLC-misses",
+};
+
+std::int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+	  std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef __linux__
+/**
+ * \brief Raw perf event, type and config.
+ */
+struct EventCode {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+/**
+ * \brief Opens event stopped as a group leader, or as a member of the leader's group when group is given.
+ */
+int open_event(EventCode code, int group) {
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = code.type;
+  attr.config = code.config;
+  attr.disabled = group < 0; // members follow their leader
+  attr.exclude_kernel = 1; // allowed for unprivileged users with perf_event_paranoid <= 2
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+std::uint64_t cache_miss(std::uint64_t cache) {
+  return cache | PERF_COUNT_HW_CACHE_OP_READ << 8u | PERF_COUNT_HW_CACHE_RESULT_MISS << 16u;
+}
+
+/**
+ * \brief Finds model specific L2 miss event of the running cpu, there is no generic one.
+ *
+ * @return raw event config, 0 when unknown
+ */
+std::uint64_t host_l2_miss_event() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx))
+	return 0;
+  char vendor[13] = {};
+  std::memcpy(vendor, &ebx, 4);
+  std::memcpy(vendor + 4, &edx, 4);
+  std::memcpy(vendor + 8, &ecx, 4);
+
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+	return 0;
+  unsigned int family = (eax >> 8u) & 0xFu;
+  unsigned int model = (eax >> 4u) & 0xFu;
+  if (family == 0x6 || family == 0xF)
+	model |= ((eax >> 16u) & 0xFu) << 4u;
+  if (family == 0xF)
+	family += (eax >> 20u) & 0xFFu;
+  return l2_miss_event(vendor, family, model);
+#else
+  return 0;
+#endif
+}
+#endif
+}
+
+std::uint64_t l2_miss_event(const std::string &vendor, unsigned int family, unsigned int model) {
+  if (vendor == "GenuineIntel" && family == 0x6) {
+	switch (model) {
+	case 0x4E: // Skylake mobile
+	case 0x5E: // Skylake desktop
+	case 0x55: // Skylake-SP, Cascade Lake
+	case 0x8E: // Kaby Lake, Coffee Lake, Whiskey Lake mobile
+	case 0x9E: // Kaby Lake, Coffee Lake desktop
+	case 0xA5: // Comet Lake
+	case 0xA6: // Comet Lake mobile
+	  return 0x3F24; // L2_RQSTS.MISS
+	default:return 0;
+	}
+  }
+  if (vendor == "AuthenticAMD" && (family == 0x17 || family == 0x19))
+	return 0x0964; // L2CacheReqStat, instruction and data cache fill misses
+  return 0;
+}
+
+const char *perf_event_name(PerfEvent event) {
+  return EVENT_NAMES[static_cast<std::size_t>(event)];
+}
+
+PerfCounters::PerfCounters() {
+  fds.fill(-1);
+  for (std::size_t i = 0; i < N_PERF_EVENTS; i++)
+	leaders[i] = i;
+#ifdef __linux__
+  std::uint64_t l2_misses = host_l2_miss_event();
+  const std::array<EventCode, N_PERF_EVENTS> codes = {{
+	  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+	  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	  {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+	  {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1I)},
+	  {PERF_TYPE_RAW, l2_misses},
+	  {PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+  }};
+
+  int first_error = 0;
+  for (std::size_t group = 0; group < N_PERF_EVENTS; group += PERF_GROUP_SIZE) {
+	int leader = -1;
+	for (std::size_t i = group; i < group + PERF_GROUP_SIZE && i < N_PERF_EVENTS; i++) {
+	  if (codes[i].type == PERF_TYPE_RAW && codes[i].config == 0)
+		continue; // no L2 event on this cpu
+	  if (leader >= 0) {
+		fds[i] = open_event(codes[i], fds[leader]);
+		if (fds[i] >= 0) {
+		  leaders[i] = static_cast<std::size_t>(leader);
+		  continue;
+		}
+	  }
+	  fds[i] = open_event(codes[i], -1); // first of the group, or doesn't fit into it
+	  if (fds[i] < 0 && first_error == 0)
+		first_error = errno;
+	  if (fds[i] >= 0 && leader < 0)
+		leader = static_cast<int>(i);
+	}
+  }
+
+  if (!available()) {
+	if (first_error == EACCES || first_error == EPERM)
+	  failure = "perf_event_open denied, lower /proc/sys/kernel/perf_event_paranoid";
+	else if (first_error == ENOENT || first_error == EOPNOTSUPP)
+	  failure = "cpu has no hardware counters, e.g. virtual machine without PMU";
+	else
+	  failure = std::string("perf_event_open failed: ") + std::strerror(first_error);
+  }
+#else
+  failure = "perf_event_open requires linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+  for (int fd : fds) {
+	if (fd >= 0)
+	  close(fd);
+  }
+}
+
+bool PerfCounters::available() const {
+  for (int fd : fds) {
+	if (fd >= 0)
+	  return true;
+  }
+  return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+  for (std::size_t i = 0; i < N_PERF_EVENTS; i++) {
+	if (fds[i] >= 0 && leaders[i] == i) {
+	  ioctl(fds[i], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	  ioctl(fds[i], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+  }
+#endif
+  start_time = now_ns();
+}
+
+PerfSample PerfCounters::stop() {
+  PerfSample sample;
+  sample.seconds = static_cast<double>(now_ns() - start_time) / 1e9;
+#ifdef __linux__
+  for (std::size_t i = 0; i < N_PERF_EVENTS; i++) {
+	if (fds[i] >= 0 && leaders[i] == i)
+	  ioctl(fds[i], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  for (std::size_t leader = 0; leader < N_PERF_EVENTS; leader++) {
+	if (fds[leader] < 0 || leaders[leader] != leader)
+	  continue;
+	std::uint64_t values[3 + PERF_GROUP_SIZE] = {}; // number of events, time enabled, time running, counts
+	ssize_t size = read(fds[leader], values, sizeof(values));
+	if (size < static_cast<ssize_t>(3 * sizeof(std::uint64_t)) || values[2] == 0)
+	  continue;
+	double scale = static_cast<double>(values[1]) / static_cast<double>(values[2]); // group was multiplexed
+
+	// counts follow the order in which events joined the group
+	std::uint64_t n = 0;
+	for (std::size_t i = leader; i < N_PERF_EVENTS && n < values[0] && n < PERF_GROUP_SIZE; i++) {
+	  if (fds[i] < 0 || leaders[i] != leader)
+		continue;
+	  sample.counts[i] = static_cast<double>(values[3 + n++]) * scale;
+	  sample.valid[i] = true;
+	}
+  }
+#endif
+  return sample;
+}
+
+void print_perf_header(std::ostream &out) {
+  out << std::left << std::setw(10) << "rom" << std::setw(12) << "engine" << std::right << std::setw(10) << "M ops/s"
+	  << std::setw(8) << "IPC" << std::setw(10) << "ins/op" << std::setw(10) << "br-miss%" << std::setw(10)
+	  << "miss/op" << std::setw(10) << "L1d/kop" << std::setw(10) << "L1i/kop" << std::setw(10) << "L2/kop"
+	  << std::setw(10) << "LLC/kop" << std::endl;
+}
+
+void print_perf_row(std::ostream &out, const std::string &rom, const std::string &engine, const PerfSample &sample,
+					std::uint64_t emulated) {
+  auto ops = static_cast<double>(emulated ? emulated : 1);
+  auto column = [&](bool valid, double value, int precision) {
+	out << std::setw(10) << std::fixed << std::setprecision(precision);
+	if (valid)
+	  out << value;
+	else
+	  out << "-";
+  };
+
+  out << std::left << std::setw(10) << rom << std::setw(12) << engine << std::right;
+  column(sample.seconds > 0, ops / sample.seconds / 1e6, 1);
+  out << std::setw(8) << std::fixed << std::setprecision(2);
+  if (sample.has(PerfEvent::CYCLES) && sample.has(PerfEvent::INSTRUCTIONS) && sample.count(PerfEvent::CYCLES) > 0)
+	out << sample.count(PerfEvent::INSTRUCTIONS) / sample.count(PerfEvent::CYCLES);
+  else
+	out << "-";
+  column(sample.has(PerfEvent::INSTRUCTIONS), sample.count(PerfEvent::INSTRUCTIONS) / ops, 1);
+  bool branches = sample.has(PerfEvent::BRANCHES) && sample.has(PerfEvent::BRANCH_MISSES)
+	  && sample.count(PerfEvent::BRANCHES) > 0;
+  column(branches, 100.0 * sample.count(PerfEvent::BRANCH_MISSES) / sample.count(PerfEvent::BRANCHES), 2);
+  column(sample.has(PerfEvent::BRANCH_MISSES), sample.count(PerfEvent::BRANCH_MISSES) / ops, 3);
+  column(sample.has(PerfEvent::L1D_MISSES), 1000.0 * sample.count(PerfEvent::L1D_MISSES) / ops, 2);
+  column(sample.has(PerfEvent::L1I_MISSES), 1000.0 * sample.count(PerfEvent::L1I_MISSES) / ops, 2);
+  column(sample.has(PerfEvent::L2_MISSES), 1000.0 * sample.count(PerfEvent::L2_MISSES) / ops, 2);
+  column(sample.has(PerfEvent::LLC_MISSES), 1000.0 * sample.count(PerfEvent::LLC_MISSES) / ops, 2);
+  out << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,131 @@
+#ifndef CHIP8_EMU_CPP_PERF_COUNTERS_HPP
+#define CHIP8_EMU_CPP_PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * \brief Hardware event counted by PerfCounters.
+ */
+enum class PerfEvent {
+  CYCLES, //!< Cpu cycles.
+  INSTRUCTIONS, //!< Retired instructions.
+  BRANCHES, //!< Retired branch instructions.
+  BRANCH_MISSES, //!< Mispredicted branches.
+  L1D_MISSES, //!< Level 1 data cache read misses.
+  L1I_MISSES, //!< Level 1 instruction cache read misses.
+  L2_MISSES, //!< Level 2 cache misses, only on cpus with a known raw event, see PerfCounters.
+  LLC_MISSES, //!< Last level cache read misses.
+};
+
+const std::size_t N_PERF_EVENTS = 8;
+const std::size_t PERF_GROUP_SIZE = 4; // events counted together, fits general purpose counters of any x86 PMU
+
+/**
+ * \brief Gets short name of the event.
+ *
+ * @return e.g. "branch-misses"
+ */
+const char *perf_event_name(PerfEvent event);
+
+/**
+ * \brief Counts of all events over a measured interval.
+ */
+struct PerfSample {
+  std::array<double, N_PERF_EVENTS> counts{}; //!< Count of each event, scaled up when the kernel multiplexed it.
+  std::array<bool, N_PERF_EVENTS> valid{}; //!< Was the event counted at all.
+  double seconds = 0.0; //!< Wall clock duration of the interval.
+
+  /** \brief Gets count of the event, 0 when it wasn't counted. */
+  [[nodiscard]] double count(PerfEvent event) const { return counts[static_cast<std::size_t>(event)]; }
+
+  /** \brief Was the event counted. */
+  [[nodiscard]] bool has(PerfEvent event) const { return valid[static_cast<std::size_t>(event)]; }
+};
+
+/**
+ * \brief Hardware performance counters of the calling thread, read through Linux perf_event_open.
+ *
+ * Only user space is counted, which works with the default perf_event_paranoid setting of 2. Events are opened in
+ * groups of PERF_GROUP_SIZE in the order of PerfEvent, so that cycles, instructions and branches are always counted
+ * over the same interval and ratios between them are exact. Groups are read at once and scaled by the time they were
+ * actually counted when the kernel multiplexed them. Event missing on a cpu (or in a virtual machine without PMU) is
+ * left out of its group, event which can't be scheduled with its group gets a group of its own. Generic perf events
+ * have no level 2 cache, L2 misses are counted with a raw event only on cpus where its code is known, see
+ * l2_miss_event().
+ */
+class PerfCounters {
+  std::array<int, N_PERF_EVENTS> fds{};
+  std::array<std::size_t, N_PERF_EVENTS> leaders{}; // event leading the group of each event
+  std::string failure; // why no event could be opened
+  std::int64_t start_time = 0; // nanoseconds of steady clock when start was called
+
+public:
+  /**
+   * \brief Opens counters of the calling thread, all of them stopped.
+   *
+   * Doesn't throw when counters aren't available, see available().
+   */
+  PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+  ~PerfCounters();
+
+  /** \brief Was the event opened. */
+  [[nodiscard]] bool available(PerfEvent event) const { return fds[static_cast<std::size_t>(event)] >= 0; }
+
+  /** \brief Was any event opened. */
+  [[nodiscard]] bool available() const;
+
+  /** \brief Reason why no event could be opened, e.g. denied by perf_event_paranoid, empty when some were. */
+  [[nodiscard]] const std::string &error() const { return failure; }
+
+  /**
+   * \brief Zeroes and starts all counters.
+   */
+  void start();
+
+  /**
+   * \brief Stops all counters and reads them.
+   *
+   * @return counts since start
+   */
+  PerfSample stop();
+};
+
+/**
+ * \brief Finds raw perf event counting L2 cache misses.
+ *
+ * Known are L2_RQSTS.MISS (0x3F24) of Skylake based Intel cores and L2CacheReqStat data and instruction fill misses
+ * (0x0964) of AMD Zen 1 to 4, the same codes count other events on other models.
+ *
+ * @param vendor cpuid vendor string, e.g. "GenuineIntel" or "AuthenticAMD"
+ * @param family cpu family including the extended family
+ * @param model cpu model including the extended model
+ * @return raw event config, 0 when L2 misses can't be counted
+ */
+std::uint64_t l2_miss_event(const std::string &vendor, unsigned int family, unsigned int model);
+
+/**
+ * \brief Prints header of the table written by print_perf_row.
+ */
+void print_perf_header(std::ostream &out);
+
+/**
+ * \brief Prints counts per emulated instruction as one row of a table.
+ *
+ * Missing events are printed as "-".
+ *
+ * @param out stream to print to
+ * @param rom rom name
+ * @param engine engine name
+ * @param sample counts of the run
+ * @param emulated number of CHIP-8 instructions executed during the run
+ */
+void print_perf_row(std::ostream &out, const std::string &rom, const std::string &engine, const PerfSample &sample,
+					std::uint64_t emulated);
+
+#endif //CHIP8_EMU_CPP_PERF_COUNTERS_HPP
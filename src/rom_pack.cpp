@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "rom_pack.hpp"
+
+namespace {
+const char ROM_PACK_MAGIC[4] = {'C', '8', 'P', 'K'};
+
+/**
+ * Checks whether file is missing or modified later than given time.
+ */
+bool newer(const std::filesystem::path &path, const timespec &time) {
+  struct stat st{};
+  if (stat(path.c_str(), &st) < 0)
+	return true;
+  return st.st_mtim.tv_sec > time.tv_sec || (st.st_mtim.tv_sec == time.tv_sec && st.st_mtim.tv_nsec > time.tv_nsec);
+}
+}
+
+RomPack::RomPack(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+	throw std::runtime_error("unable to open rom pack at: " + path);
+
+  struct stat st{};
+  if (fstat(fd, &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(RomPackHeader)) {
+	close(fd);
+	throw std::runtime_error("not a rom pack: " + path);
+  }
+  size = static_cast<std::size_t>(st.st_size);
+  modified = st.st_mtim;
+
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // mapping stays valid after closing the descriptor
+  if (mapping == MAP_FAILED)
+	throw std::runtime_error("unable to map rom pack at: " + path);
+  data = static_cast<const unsigned char *>(mapping);
+
+  RomPackHeader header{};
+  std::memcpy(&header, data, sizeof(header));
+  bool valid = std::memcmp(header.magic, ROM_PACK_MAGIC, sizeof(ROM_PACK_MAGIC)) == 0
+	  && header.version == ROM_PACK_VERSION
+	  && header.toc_offset % alignof(RomPackEntry) == 0
+	  && header.toc_offset + static_cast<std::size_t>(header.count) * sizeof(RomPackEntry) <= size;
+  if (!valid) {
+	munmap(mapping, size);
+	throw std::runtime_error("not a rom pack: " + path);
+  }
+
+  entries = reinterpret_cast<const RomPackEntry *>(data + header.toc_offset);
+  count = header.count;
+
+  for (const auto &entry : *this) {
+	if (entry.name_offset + std::size_t{entry.name_size} > size
+		|| entry.location_offset + std::size_t{entry.location_size} > size
+		|| entry.rom_offset + std::size_t{entry.rom_size} > size
+		|| entry.snapshot_offset + std::size_t{entry.snapshot_size} > size) {
+	  munmap(mapping, size);
+	  throw std::runtime_error("corrupted rom pack: " + path);
+	}
+  }
+}
+
+RomPack::~RomPack() {
+  munmap(const_cast<unsigned char *>(data), size);
+}
+
+const RomPackEntry *RomPack::find(std::string_view rom_name) const {
+  auto it = std::lower_bound(entries, entries + count, rom_name, [this](const RomPackEntry &entry, std::string_view n) {
+	return name(entry) < n;
+  });
+
+  if (it == entries + count || name(*it) != rom_name)
+	return nullptr;
+  return it;
+}
+
+std::string_view RomPack::name(const RomPackEntry &entry) const {
+  return {reinterpret_cast<const char *>(data + entry.name_offset), entry.name_size};
+}
+
+RomConf RomPack::config(const RomPackEntry &entry, std::filesystem::path resources_path) const {
+  RomConf config;
+  config.emulation_period = entry.emulation_period;
+  config.load_store_quirk = entry.flags & ROM_PACK_LOAD_STORE_QUIRK;
+  config.shift_quirk = entry.flags & ROM_PACK_SHIFT_QUIRK;
+  config.wrapping = entry.flags & ROM_PACK_WRAPPING;
+  config.xo_chip = entry.flags & ROM_PACK_XO_CHIP;
+  config.schip = entry.flags & ROM_PACK_SCHIP;
+
+  std::string_view location(reinterpret_cast<const char *>(data + entry.location_offset), entry.location_size);
+  if (entry.snapshot_size) {
+	std::string_view snapshot(reinterpret_cast<const char *>(data + entry.snapshot_offset), entry.snapshot_size);
+	config.snapshot_location = (resources_path / snapshot).string();
+  }
+  config.rom_location = resources_path.append(location).string();
+  config.rom_data = data + entry.rom_offset;
+  config.rom_size = entry.rom_size;
+
+  return config;
+}
+
+bool RomPack::outdated(const RomPackEntry &entry, const std::filesystem::path &resources_path) const {
+  std::string_view location(reinterpret_cast<const char *>(data + entry.location_offset), entry.location_size);
+  if (newer(resources_path / "roms.json", modified) || newer(resources_path / location, modified))
+	return true;
+
+  std::string_view snapshot(reinterpret_cast<const char *>(data + entry.snapshot_offset), entry.snapshot_size);
+  return !snapshot.empty() && newer(resources_path / snapshot, modified);
+}
+
+void write_rom_pack(const std::string &path, std::vector<RomPackSource> roms) {
+  std::sort(roms.begin(), roms.end(), [](const RomPackSource &a, const RomPackSource &b) { return a.name < b.name; });
+  auto duplicate = std::adjacent_find(roms.begin(), roms.end(), [](const RomPackSource &a, const RomPackSource &b) {
+	return a.name == b.name;
+  });
+  if (duplicate != roms.end())
+	throw std::runtime_error("duplicated rom name: " + duplicate->name);
+
+  RomPackHeader header{};
+  std::memcpy(header.magic, ROM_PACK_MAGIC, sizeof(ROM_PACK_MAGIC));
+  header.version = ROM_PACK_VERSION;
+  header.count = static_cast<std::uint32_t>(roms.size());
+  header.toc_offset = sizeof(RomPackHeader);
+
+  // layout: header, table of contents, names, rom and snapshot locations, rom bytes
+  std::vector<RomPackEntry> toc(roms.size());
+  std::string strings;
+  std::vector<unsigned char> bytes;
+  std::size_t strings_offset = header.toc_offset + toc.size() * sizeof(RomPackEntry);
+
+  for (std::size_t i = 0; i < roms.size(); i++) {
+	const auto &rom = roms[i];
+	auto &entry = toc[i];
+
+	entry.emulation_period = rom.config.emulation_period;
+	entry.name_offset = static_cast<std::uint32_t>(strings_offset + strings.size());
+	entry.name_size = static_cast<std::uint16_t>(rom.name.size());
+	strings += rom.name;
+	entry.location_offset = static_cast<std::uint32_t>(strings_offset + strings.size());
+	entry.location_size = static_cast<std::uint16_t>(rom.location.size());
+	strings += rom.location;
+	entry.snapshot_offset = static_cast<std::uint32_t>(strings_offset + strings.size());
+	entry.snapshot_size = static_cast<std::uint16_t>(rom.snapshot.size());
+	strings += rom.snapshot;
+
+	entry.rom_offset = static_cast<std::uint32_t>(bytes.size()); // fixed up below
+	entry.rom_size = static_cast<std::uint32_t>(rom.rom.size());
+	bytes.insert(bytes.end(), rom.rom.begin(), rom.rom.end());
+
+	entry.flags = 0;
+	if (rom.config.load_store_quirk)
+	  entry.flags |= ROM_PACK_LOAD_STORE_QUIRK;
+	if (rom.config.shift_quirk)
+	  entry.flags |= ROM_PACK_SHIFT_QUIRK;
+	if (rom.config.wrapping)
+	  entry.flags |= ROM_PACK_WRAPPING;
+	if (rom.config.xo_chip)
+	  entry.flags |= ROM_PACK_XO_CHIP;
+	if (rom.config.schip)
+	  entry.flags |= ROM_PACK_SCHIP;
+  }
+
+  std::size_t bytes_offset = strings_offset + strings.size();
+  for (auto &entry : toc)
+	entry.rom_offset += static_cast<std::uint32_t>(bytes_offset);
+
+  std::ofstream out(path, std::ofstream::binary);
+  if (!out.is_open())
+	throw std::runtime_error("unable to open rom pack at: " + path);
+
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(RomPackEntry)));
+  out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+  out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+  if (!out)
+	throw std::runtime_error("unable to write rom pack at: " + path);
+}
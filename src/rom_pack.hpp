@@ -0,0 +1,146 @@
+#ifndef CHIP8_EMU_CPP_ROM_PACK_HPP
+#define CHIP8_EMU_CPP_ROM_PACK_HPP
+
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "conf.hpp"
+
+/**
+ * \brief Header at the beginning of the rom pack file.
+ *
+ * All numbers are stored in host byte order, rom pack is meant to be built on the machine that uses it.
+ */
+struct RomPackHeader {
+  char magic[4]; //!< Always "C8PK".
+  std::uint32_t version; //!< Format version.
+  std::uint32_t count; //!< Number of entries in the table of contents.
+  std::uint32_t toc_offset; //!< Offset of the table of contents from the beginning of the file.
+};
+
+/**
+ * \brief Table of contents entry describing a single rom.
+ *
+ * Entries are sorted by name. Offsets are relative to the beginning of the file.
+ */
+struct RomPackEntry {
+  double emulation_period; //!< Time between calling cpu's cycle function in seconds.
+  std::uint32_t name_offset; //!< Offset of the rom name.
+  std::uint32_t location_offset; //!< Offset of the rom location relative to resources directory.
+  std::uint32_t rom_offset; //!< Offset of the rom bytes.
+  std::uint32_t rom_size; //!< Size of the rom in bytes.
+  std::uint32_t snapshot_offset; //!< Offset of the warm start snapshot location relative to resources directory.
+  std::uint16_t name_size; //!< Size of the rom name in bytes.
+  std::uint16_t location_size; //!< Size of the rom location in bytes.
+  std::uint16_t snapshot_size; //!< Size of the snapshot location in bytes, 0 when there is no snapshot.
+  std::uint8_t flags; //!< Quirk flags, see ROM_PACK_* constants.
+  std::uint8_t reserved[5]; //!< Padding, always 0.
+};
+
+static_assert(sizeof(RomPackHeader) == 16, "rom pack header layout is part of the file format");
+static_assert(sizeof(RomPackEntry) == 40, "rom pack entry layout is part of the file format");
+
+const std::uint32_t ROM_PACK_VERSION = 2;
+const std::uint8_t ROM_PACK_LOAD_STORE_QUIRK = 0x1;
+const std::uint8_t ROM_PACK_SHIFT_QUIRK = 0x2;
+const std::uint8_t ROM_PACK_WRAPPING = 0x4;
+const std::uint8_t ROM_PACK_XO_CHIP = 0x8;
+const std::uint8_t ROM_PACK_SCHIP = 0x10;
+
+/**
+ * \brief Read-only memory mapped rom pack.
+ *
+ * Rom pack is a single file containing configuration and bytes of many roms. Opening it maps the file into memory,
+ * so looking up a rom and loading it doesn't require any further file access or parsing.
+ */
+class RomPack {
+  const unsigned char *data = nullptr;
+  std::size_t size = 0;
+  const RomPackEntry *entries = nullptr;
+  std::uint32_t count = 0;
+  timespec modified{}; // modification time of the pack file
+
+public:
+  /**
+   * \brief Maps rom pack file into memory.
+   *
+   * Throws runtime error when file can't be mapped or isn't a valid rom pack.
+   *
+   * @param path rom pack file
+   */
+  explicit RomPack(const std::string &path);
+  RomPack(const RomPack &) = delete;
+  RomPack &operator=(const RomPack &) = delete;
+  ~RomPack();
+
+  /**
+   * \brief Finds rom by name.
+   *
+   * @param name rom name as in roms.json
+   * @return entry of the rom or nullptr if there is no such rom
+   */
+  [[nodiscard]] const RomPackEntry *find(std::string_view name) const;
+
+  /**
+   * \brief Gets name of the rom.
+   *
+   * @param entry entry from this pack
+   * @return view into the mapped file
+   */
+  [[nodiscard]] std::string_view name(const RomPackEntry &entry) const;
+
+  /**
+   * \brief Creates emulation configuration for the rom.
+   *
+   * Configuration points straight at rom bytes in the mapped file, so it's valid only as long as the pack is open.
+   *
+   * @param entry entry from this pack
+   * @param resources_path path to resources directory
+   * @return emulation configuration
+   */
+  [[nodiscard]] RomConf config(const RomPackEntry &entry, std::filesystem::path resources_path) const;
+
+  /**
+   * \brief Checks whether the rom changed since the pack was built.
+   *
+   * Pack is outdated when roms.json, the rom file or its snapshot is newer than the pack or missing. Only these few
+   * files are looked at, so the check stays cheap.
+   *
+   * @param entry entry from this pack
+   * @param resources_path path to resources directory
+   * @return true when the pack has to be rebuilt before using the rom from it
+   */
+  [[nodiscard]] bool outdated(const RomPackEntry &entry, const std::filesystem::path &resources_path) const;
+
+  /** \brief Gets first entry, entries are sorted by name. */
+  [[nodiscard]] const RomPackEntry *begin() const { return entries; }
+
+  /** \brief Gets past the last entry. */
+  [[nodiscard]] const RomPackEntry *end() const { return entries + count; }
+};
+
+/**
+ * \brief Rom to put into a rom pack.
+ */
+struct RomPackSource {
+  std::string name; //!< Rom name.
+  std::string location; //!< Rom location relative to resources directory.
+  std::string snapshot; //!< Warm start snapshot location relative to resources directory, may be empty.
+  RomConf config; //!< Emulation configuration.
+  std::vector<unsigned char> rom; //!< Rom bytes.
+};
+
+/**
+ * \brief Writes rom pack file.
+ *
+ * Throws runtime error when file can't be written or when any of the names is duplicated.
+ *
+ * @param path destination file
+ * @param roms roms to pack, order doesn't matter
+ */
+void write_rom_pack(const std::string &path, std::vector<RomPackSource> roms);
+
+#endif //CHIP8_EMU_CPP_ROM_PACK_HPP
@@ -0,0 +1,95 @@
+#include "session_executor.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+const std::chrono::duration<double> FRAME_DURATION{Chip8::TIMER_PERIOD};
+
+/**
+ * \brief Finds out if the cpu stays unchanged until a key is pressed.
+ */
+SessionState parked_state(const Chip8::CPU &cpu) {
+  if (cpu.waiting_for_key())
+	return SessionState::WAITING_FOR_KEY;
+  if (cpu.exited())
+	return SessionState::IDLE;
+  if (cpu.pc() + 1u >= Chip8::MEMORY_SIZE)
+	return SessionState::RUNNING; // next cycle throws
+
+  unsigned short opcode = cpu.get_opcode();
+  if ((opcode & 0xF000u) == 0x1000 && (opcode & 0x0FFFu) == cpu.pc())
+	return SessionState::IDLE;
+  return SessionState::RUNNING;
+}
+}
+
+SessionExecutor::Hosted::~Hosted() {
+  if (session.handle)
+	session.handle.destroy();
+}
+
+SessionExecutor::Session SessionExecutor::host(Hosted &hosted) {
+  for (;;) {
+	hosted.emulator.run(FRAME_DURATION, Emulator::Clock::time_point{});
+	hosted.frames++;
+	emulated++;
+	hosted.state = parked_state(hosted.emulator.cpu);
+	co_await std::suspend_always{};
+  }
+}
+
+std::size_t SessionExecutor::spawn(const RomConf &config, std::uint32_t random_seed) {
+  auto hosted = std::make_unique<Hosted>();
+  hosted->emulator.load_config(config, random_seed);
+  hosted->frames = frame;
+  hosted->session = host(*hosted);
+
+  sessions.push_back(std::move(hosted));
+  runnable.push_back(sessions.size() - 1);
+  return sessions.size() - 1;
+}
+
+void SessionExecutor::tick() {
+  frame++;
+  resumed.swap(runnable);
+
+  for (auto id : resumed) {
+	Hosted &hosted = *sessions[id];
+	hosted.session.handle.resume();
+
+	if (hosted.session.handle.done()) {
+	  hosted.state = SessionState::FAULTED;
+	  try {
+		std::rethrow_exception(hosted.session.handle.promise().error);
+	  } catch (const std::exception &e) {
+		hosted.error = e.what();
+	  }
+	} else if (hosted.state == SessionState::RUNNING) {
+	  runnable.push_back(id);
+	}
+  }
+  resumed.clear();
+}
+
+void SessionExecutor::catch_up(Hosted &hosted) {
+  // frame by frame, so that cycles are counted exactly like by run
+  for (; hosted.frames < frame; hosted.frames++) {
+	hosted.emulator.idle(FRAME_DURATION);
+	skipped++;
+  }
+}
+
+void SessionExecutor::set_key(std::size_t id, unsigned int key, bool value) {
+  Hosted &hosted = *sessions.at(id);
+  bool parked = hosted.state == SessionState::WAITING_FOR_KEY || hosted.state == SessionState::IDLE;
+
+  if (parked)
+	catch_up(hosted);
+  hosted.emulator.set_key(key, value);
+
+  if (parked && value) {
+	hosted.state = SessionState::RUNNING;
+	runnable.push_back(id);
+  }
+}
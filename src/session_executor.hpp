@@ -0,0 +1,137 @@
+#ifndef CHIP8_EMU_CPP_SESSION_EXECUTOR_HPP
+#define CHIP8_EMU_CPP_SESSION_EXECUTOR_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+#include "emulator.hpp"
+
+/**
+ * \brief What a hosted session is doing between ticks.
+ */
+enum class SessionState {
+  RUNNING, //!< Emulates one frame on every tick.
+  WAITING_FOR_KEY, //!< Blocked in Fx0A without pressed key, costs nothing until a key is pressed.
+  IDLE, //!< Jumps to itself or exited with 00FD, costs nothing until a key is pressed.
+  FAULTED, //!< Cpu threw, session never runs again.
+};
+
+/**
+ * \brief Hosts thousands of emulator sessions on a single thread.
+ *
+ * Every session is a coroutine emulating one 60 Hz frame per tick and yielding back to the executor at the end of it.
+ * When a frame ends on an instruction which leaves the cpu unchanged, i.e. Fx0A without pressed key, jump to itself
+ * or exit, the session is parked and isn't resumed at all until a key is pressed. Timers of a parked session are
+ * caught up with Emulator::idle right before the key is applied, so emulation matches the one done frame by frame,
+ * except that input lands on frame boundaries.
+ *
+ * Executor isn't thread safe, hosts with many cores should run one executor per core.
+ */
+class SessionExecutor {
+  struct Hosted;
+
+  /**
+   * \brief Coroutine emulating one session, see host.
+   */
+  struct Session {
+	struct promise_type {
+	  Session get_return_object() { return Session{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+	  std::suspend_always initial_suspend() noexcept { return {}; }
+	  std::suspend_always final_suspend() noexcept { return {}; }
+	  void return_void() {}
+	  void unhandled_exception() { error = std::current_exception(); }
+
+	  std::exception_ptr error; // thrown by the cpu
+	};
+
+	std::coroutine_handle<promise_type> handle;
+  };
+
+  struct Hosted {
+	Emulator emulator;
+	Session session{};
+	SessionState state = SessionState::RUNNING;
+	std::uint64_t frames = 0; // frames emulated or skipped so far
+	std::string error;
+
+	~Hosted();
+  };
+
+  std::vector<std::unique_ptr<Hosted>> sessions;
+  std::vector<std::size_t> runnable; // sessions resumed by the next tick
+  std::vector<std::size_t> resumed; // sessions being resumed by the current tick
+  std::uint64_t frame = 0; // number of ticks so far
+  std::uint64_t emulated = 0; // frames emulated by all sessions
+  std::uint64_t skipped = 0; // frames parked sessions didn't have to emulate
+
+  Session host(Hosted &hosted);
+  void catch_up(Hosted &hosted);
+
+public:
+  SessionExecutor() = default;
+  SessionExecutor(const SessionExecutor &) = delete;
+  SessionExecutor &operator=(const SessionExecutor &) = delete;
+
+  /**
+   * \brief Loads rom into a new session, which starts running with the next tick.
+   *
+   * Throws runtime error when rom can't be loaded.
+   *
+   * @param config rom, speed and quirks of the session
+   * @param random_seed seed for cpu's random number generator
+   * @return session id
+   */
+  std::size_t spawn(const RomConf &config, std::uint32_t random_seed);
+
+  /**
+   * \brief Emulates one 60 Hz frame of every running session.
+   *
+   * Parked sessions aren't touched, so a tick costs only as much as the sessions which actually run.
+   */
+  void tick();
+
+  /**
+   * \brief Sets key of a session, pressing a key wakes parked session up.
+   *
+   * @param id session id returned by spawn
+   * @param key key number in range 0-15 inclusive
+   * @param value is key pressed
+   */
+  void set_key(std::size_t id, unsigned int key, bool value);
+
+  /**
+   * \brief Gets emulator of a session.
+   *
+   * Parked session's timers lag behind until it wakes up.
+   *
+   * @param id session id returned by spawn
+   */
+  [[nodiscard]] const Emulator &emulator(std::size_t id) const { return sessions.at(id)->emulator; }
+
+  /** \brief Gets what a session is doing. */
+  [[nodiscard]] SessionState state(std::size_t id) const { return sessions.at(id)->state; }
+
+  /** \brief Gets message of the error which stopped a faulted session. */
+  [[nodiscard]] const std::string &error(std::size_t id) const { return sessions.at(id)->error; }
+
+  /** \brief Number of hosted sessions. */
+  [[nodiscard]] std::size_t size() const { return sessions.size(); }
+
+  /** \brief Number of sessions resumed by the next tick. */
+  [[nodiscard]] std::size_t running() const { return runnable.size(); }
+
+  /** \brief Number of ticks so far. */
+  [[nodiscard]] std::uint64_t ticks() const { return frame; }
+
+  /** \brief Number of frames emulated by all sessions. */
+  [[nodiscard]] std::uint64_t emulated_frames() const { return emulated; }
+
+  /** \brief Number of frames parked sessions skipped instead of emulating. */
+  [[nodiscard]] std::uint64_t skipped_frames() const { return skipped; }
+};
+
+#endif //CHIP8_EMU_CPP_SESSION_EXECUTOR_HPP
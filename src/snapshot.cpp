@@ -0,0 +1,190 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "snapshot.hpp"
+
+namespace {
+const char SNAPSHOT_MAGIC[4] = {'C', '8', 'S', 'S'};
+const std::uint16_t SNAPSHOT_VERSION = 2; // 2 records rom hash and settings
+
+const unsigned FLAG_HIGH_RESOLUTION = 0x1;
+const unsigned FLAG_HALTED = 0x2;
+const unsigned FLAG_HAS_PATTERN = 0x4;
+
+const unsigned FLAG_LOAD_STORE_QUIRK = 0x1;
+const unsigned FLAG_SHIFT_QUIRK = 0x2;
+const unsigned FLAG_WRAPPING = 0x4;
+const unsigned FLAG_XO_CHIP = 0x8;
+const unsigned FLAG_SCHIP = 0x10;
+
+/**
+ * Writes little-endian number of given size.
+ */
+void put(std::ostream &out, std::uint64_t value, unsigned size) {
+  for (unsigned i = 0; i < size; i++)
+	out.put(static_cast<char>((value >> (8u * i)) & 0xFFu));
+}
+
+void put_double(std::ostream &out, double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  put(out, bits, 8);
+}
+
+std::uint64_t get(std::istream &in, unsigned size) {
+  std::uint64_t value = 0;
+  for (unsigned i = 0; i < size; i++) {
+	int byte = in.get();
+	if (byte == std::char_traits<char>::eof())
+	  throw std::runtime_error("unexpected end of snapshot file");
+	value |= static_cast<std::uint64_t>(byte) << (8u * i);
+  }
+  return value;
+}
+
+double get_double(std::istream &in) {
+  std::uint64_t bits = get(in, 8);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+}
+
+std::uint64_t rom_hash(const unsigned char *data, std::size_t size) {
+  std::uint64_t hash = 0xcbf29ce484222325u;
+  for (std::size_t i = 0; i < size; i++) {
+	hash ^= data[i];
+	hash *= 0x100000001b3u;
+  }
+  return hash;
+}
+
+void Snapshot::save(const std::string &path) const {
+  std::ofstream out(path, std::ofstream::binary);
+  if (!out.is_open())
+	throw std::runtime_error("unable to open snapshot file at: " + path);
+
+  out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  put(out, SNAPSHOT_VERSION, 2);
+
+  put(out, rom, 8);
+  put_double(out, emulation_period);
+  unsigned settings = 0;
+  if (load_store_quirk)
+	settings |= FLAG_LOAD_STORE_QUIRK;
+  if (shift_quirk)
+	settings |= FLAG_SHIFT_QUIRK;
+  if (wrapping)
+	settings |= FLAG_WRAPPING;
+  if (xo_chip)
+	settings |= FLAG_XO_CHIP;
+  if (schip)
+	settings |= FLAG_SCHIP;
+  put(out, settings, 1);
+
+  put(out, cycles, 8);
+  put_double(out, cycle_counter);
+  put_double(out, timer_counter);
+  put(out, seed, 4);
+
+  put(out, cpu.memory.size(), 4);
+  out.write(reinterpret_cast<const char *>(cpu.memory.data()), static_cast<std::streamsize>(cpu.memory.size()));
+  for (auto v : cpu.registers)
+	put(out, v, 1);
+  for (auto address : cpu.stack)
+	put(out, address, 2);
+  for (const auto &plane : cpu.planes) {
+	for (const auto &row : plane) {
+	  put(out, row.left, 8);
+	  put(out, row.right, 8);
+	}
+  }
+
+  unsigned flags = 0;
+  if (cpu.high_resolution)
+	flags |= FLAG_HIGH_RESOLUTION;
+  if (cpu.halted)
+	flags |= FLAG_HALTED;
+  if (cpu.has_pattern)
+	flags |= FLAG_HAS_PATTERN;
+  put(out, flags, 1);
+  put(out, cpu.plane_mask, 1);
+  put(out, cpu.pc, 2);
+  put(out, cpu.index, 2);
+  put(out, cpu.delay_timer, 1);
+  put(out, cpu.sound_timer, 1);
+  put(out, cpu.sp, 1);
+  put(out, cpu.keyboard, 2);
+  put(out, cpu.rng, 4);
+  out.write(reinterpret_cast<const char *>(cpu.pattern.data()), static_cast<std::streamsize>(cpu.pattern.size()));
+  put(out, cpu.pitch, 1);
+
+  if (!out)
+	throw std::runtime_error("unable to write snapshot file at: " + path);
+}
+
+Snapshot Snapshot::load(const std::string &path) {
+  std::ifstream in(path, std::ifstream::binary);
+  if (!in.is_open())
+	throw std::runtime_error("unable to open snapshot file at: " + path);
+
+  char magic[sizeof(SNAPSHOT_MAGIC)];
+  in.read(magic, sizeof(magic));
+  if (!in || std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0)
+	throw std::runtime_error("not a snapshot file: " + path);
+  if (get(in, 2) != SNAPSHOT_VERSION)
+	throw std::runtime_error("unsupported snapshot version");
+
+  Snapshot snapshot;
+  snapshot.rom = get(in, 8);
+  snapshot.emulation_period = get_double(in);
+  auto settings = get(in, 1);
+  snapshot.load_store_quirk = settings & FLAG_LOAD_STORE_QUIRK;
+  snapshot.shift_quirk = settings & FLAG_SHIFT_QUIRK;
+  snapshot.wrapping = settings & FLAG_WRAPPING;
+  snapshot.xo_chip = settings & FLAG_XO_CHIP;
+  snapshot.schip = settings & FLAG_SCHIP;
+
+  snapshot.cycles = get(in, 8);
+  snapshot.cycle_counter = get_double(in);
+  snapshot.timer_counter = get_double(in);
+  snapshot.seed = static_cast<std::uint32_t>(get(in, 4));
+
+  auto memory_size = get(in, 4);
+  if (memory_size != Chip8::MEMORY_SIZE && memory_size != Chip8::XO_MEMORY_SIZE)
+	throw std::runtime_error("invalid memory size in snapshot file");
+  Chip8::CPUState &cpu = snapshot.cpu;
+  cpu.memory.resize(memory_size);
+  in.read(reinterpret_cast<char *>(cpu.memory.data()), static_cast<std::streamsize>(memory_size));
+  for (auto &v : cpu.registers)
+	v = static_cast<unsigned char>(get(in, 1));
+  for (auto &address : cpu.stack)
+	address = static_cast<unsigned short>(get(in, 2));
+  for (auto &plane : cpu.planes) {
+	for (auto &row : plane) {
+	  row.left = get(in, 8);
+	  row.right = get(in, 8);
+	}
+  }
+
+  auto flags = get(in, 1);
+  cpu.high_resolution = flags & FLAG_HIGH_RESOLUTION;
+  cpu.halted = flags & FLAG_HALTED;
+  cpu.has_pattern = flags & FLAG_HAS_PATTERN;
+  cpu.plane_mask = static_cast<unsigned char>(get(in, 1));
+  cpu.pc = static_cast<unsigned short>(get(in, 2));
+  cpu.index = static_cast<unsigned short>(get(in, 2));
+  cpu.delay_timer = static_cast<unsigned char>(get(in, 1));
+  cpu.sound_timer = static_cast<unsigned char>(get(in, 1));
+  cpu.sp = static_cast<unsigned char>(get(in, 1));
+  cpu.keyboard = static_cast<std::uint16_t>(get(in, 2));
+  cpu.rng = static_cast<std::uint32_t>(get(in, 4));
+  in.read(reinterpret_cast<char *>(cpu.pattern.data()), static_cast<std::streamsize>(cpu.pattern.size()));
+  cpu.pitch = static_cast<unsigned char>(get(in, 1));
+
+  if (!in)
+	throw std::runtime_error("unexpected end of snapshot file");
+  if (cpu.sp > Chip8::STACK_SIZE || cpu.pc >= Chip8::MEMORY_SIZE)
+	throw std::runtime_error("invalid cpu state in snapshot file");
+  return snapshot;
+}
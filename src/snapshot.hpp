@@ -0,0 +1,57 @@
+#ifndef CHIP8_EMU_CPP_SNAPSHOT_HPP
+#define CHIP8_EMU_CPP_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "chip8/cpu.hpp"
+
+/**
+ * \brief Computes FNV-1a hash of rom contents, used to tell which rom a snapshot was taken from.
+ *
+ * @param data rom contents
+ * @param size size of the rom in bytes
+ * @return 64-bit hash
+ */
+std::uint64_t rom_hash(const unsigned char *data, std::size_t size);
+
+/**
+ * \brief Emulator captured at some point, e.g. after the title screen, to start from instead of booting the rom.
+ *
+ * Besides the state it records the rom and settings it was taken with, so that it isn't restored over an edited rom.
+ */
+struct Snapshot {
+  Chip8::CPUState cpu; //!< Whole cpu state.
+  std::uint64_t cycles = 0; //!< Number of cycles executed before capture.
+  double cycle_counter = 0; //!< Fraction of a cycle left from the last run.
+  double timer_counter = 0; //!< Cycles until next timers update.
+  std::uint32_t seed = 0; //!< Seed the cpu's random number generator started with.
+  std::uint64_t rom = 0; //!< Hash of the loaded rom, see rom_hash.
+  double emulation_period = 0; //!< Time between cycles in seconds.
+  bool load_store_quirk = false; //!< Load store quirk flag.
+  bool shift_quirk = false; //!< Shift quirk flag.
+  bool wrapping = true; //!< Wrapping flag.
+  bool schip = false; //!< SUPER-CHIP mode flag, set in XO-CHIP mode as well.
+  bool xo_chip = false; //!< XO-CHIP mode flag.
+
+  /**
+   * \brief Saves snapshot in binary format.
+   *
+   * Throws runtime error when file can't be written.
+   *
+   * @param path destination file
+   */
+  void save(const std::string &path) const;
+
+  /**
+   * \brief Loads snapshot from binary format.
+   *
+   * Throws runtime error when file can't be read or isn't a valid snapshot.
+   *
+   * @param path source file
+   * @return loaded snapshot
+   */
+  static Snapshot load(const std::string &path);
+};
+
+#endif //CHIP8_EMU_CPP_SNAPSHOT_HPP
@@ -0,0 +1,65 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0)
+	threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (unsigned i = 1; i < threads; i++)
+	workers.emplace_back(&ThreadPool::worker_loop, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+	std::lock_guard<std::mutex> lock(mutex);
+	stopping = true;
+  }
+  start.notify_all();
+
+  for (auto &worker : workers)
+	worker.join();
+}
+
+void ThreadPool::work() {
+  for (std::size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+	task(context, i);
+}
+
+void ThreadPool::worker_loop() {
+  std::uint64_t seen = 0;
+
+  while (true) {
+	{
+	  std::unique_lock<std::mutex> lock(mutex);
+	  start.wait(lock, [&] { return stopping || generation != seen; });
+	  if (stopping)
+		return;
+	  seen = generation;
+	}
+
+	work();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (--busy == 0)
+	  done.notify_one();
+  }
+}
+
+void ThreadPool::run(Task loop_task, void *loop_context, std::size_t loop_count) {
+  {
+	std::lock_guard<std::mutex> lock(mutex);
+	task = loop_task;
+	context = loop_context;
+	count = loop_count;
+	next = 0;
+	busy = static_cast<unsigned>(workers.size());
+	generation++;
+  }
+  start.notify_all();
+
+  work();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&] { return busy == 0; });
+}
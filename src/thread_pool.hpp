@@ -0,0 +1,62 @@
+#ifndef CHIP8_EMU_CPP_THREAD_POOL_HPP
+#define CHIP8_EMU_CPP_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Fixed set of threads executing parallel loops.
+ *
+ * Running a loop doesn't allocate, so the pool can be used for work done many times per second.
+ */
+class ThreadPool {
+  using Task = void (*)(void *context, std::size_t index);
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  std::uint64_t generation = 0; // incremented for every loop
+  unsigned busy = 0; // number of workers still working on current loop
+  bool stopping = false;
+
+  Task task = nullptr;
+  void *context = nullptr;
+  std::size_t count = 0;
+  std::atomic<std::size_t> next{0}; // next index to execute
+
+  void work();
+  void worker_loop();
+  void run(Task loop_task, void *loop_context, std::size_t loop_count);
+
+public:
+  /**
+   * \brief Starts threads.
+   *
+   * @param threads total number of threads executing loops including the calling one, 0 means one per core
+   */
+  explicit ThreadPool(unsigned threads = 0);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  /**
+   * \brief Calls function for every index in range 0 to n - 1 and waits until all calls finish.
+   *
+   * Calling thread takes part in the work. Indices are handed out one by one, so calls can take different time.
+   *
+   * @param n number of indices
+   * @param function callable taking std::size_t index
+   */
+  template<typename F>
+  void parallel_for(std::size_t n, F &function) {
+	run([](void *f, std::size_t i) { (*static_cast<F *>(f))(i); }, &function, n);
+  }
+};
+
+#endif //CHIP8_EMU_CPP_THREAD_POOL_HPP
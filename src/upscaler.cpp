@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "upscaler.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define UPSCALER_SSE2 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define UPSCALER_AVX2 1 // compiled for avx2 through target attribute, used only when cpu supports it
+#endif
+#endif
+
+namespace {
+/**
+ * \brief Maps byte of packed pixels to 8 bytes of 0 or 1, leftmost pixel first in memory.
+ */
+std::array<std::uint64_t, 256> make_bit_bytes() {
+  std::array<std::uint64_t, 256> table{};
+  for (unsigned int value = 0; value < 256; value++) {
+	unsigned char bytes[8];
+	for (unsigned int bit = 0; bit < 8; bit++)
+	  bytes[bit] = static_cast<unsigned char>((value >> (7u - bit)) & 1u);
+	std::memcpy(&table[value], bytes, sizeof(bytes));
+  }
+  return table;
+}
+
+const std::array<std::uint64_t, 256> BIT_BYTES = make_bit_bytes();
+
+/**
+ * \brief Fills output row with runs of palette colors, run of column i spans columns [starts[i], starts[i + 1]).
+ */
+void fill_row_portable(const unsigned char *indices, unsigned int count, const std::uint32_t *starts,
+					   std::uint32_t *out) {
+  for (unsigned int i = 0; i < count; i++)
+	std::fill(out + starts[i], out + starts[i + 1], UPSCALE_PALETTE[indices[i]]);
+}
+
+#ifdef UPSCALER_SSE2
+void fill_row_sse2(const unsigned char *indices, unsigned int count, const std::uint32_t *starts, std::uint32_t *out) {
+  for (unsigned int i = 0; i < count; i++) {
+	std::uint32_t color = UPSCALE_PALETTE[indices[i]];
+	std::uint32_t start = starts[i], end = starts[i + 1];
+	if (end - start < 4) {
+	  std::fill(out + start, out + end, color);
+	  continue;
+	}
+	__m128i colors = _mm_set1_epi32(static_cast<int>(color));
+	for (std::uint32_t x = start; x + 4 <= end; x += 4)
+	  _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), colors);
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(out + end - 4), colors); // overlaps, covers the tail
+  }
+}
+
+inline __m128i blend(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline __m128i load(const unsigned char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+inline void store(unsigned char *p, __m128i value) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), value);
+}
+#endif
+
+#ifdef UPSCALER_AVX2
+__attribute__((target("avx2")))
+void fill_row_avx2(const unsigned char *indices, unsigned int count, const std::uint32_t *starts, std::uint32_t *out) {
+  for (unsigned int i = 0; i < count; i++) {
+	std::uint32_t color = UPSCALE_PALETTE[indices[i]];
+	std::uint32_t start = starts[i], end = starts[i + 1];
+	if (end - start < 8) {
+	  if (end - start < 4) {
+		std::fill(out + start, out + end, color);
+	  } else {
+		__m128i colors = _mm_set1_epi32(static_cast<int>(color));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + start), colors);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + end - 4), colors);
+	  }
+	  continue;
+	}
+	__m256i colors = _mm256_set1_epi32(static_cast<int>(color));
+	for (std::uint32_t x = start; x + 8 <= end; x += 8)
+	  _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), colors);
+	_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + end - 8), colors); // overlaps, covers the tail
+  }
+}
+
+bool has_avx2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+#endif
+}
+
+UpscaleFilter parse_upscale_filter(const std::string &name) {
+  if (name == "nearest")
+	return UpscaleFilter::NEAREST;
+  if (name == "scale2x")
+	return UpscaleFilter::SCALE2X;
+  if (name == "scale3x")
+	return UpscaleFilter::SCALE3X;
+  throw std::runtime_error("unknown upscale filter " + name);
+}
+
+Upscaler::Upscaler(UpscaleFilter filter, unsigned int width, unsigned int height, bool simd) :
+	filter(filter), width(width), height(height), simd(simd) {
+  if (width == 0 || height == 0)
+	throw std::runtime_error("upscaler output can't be empty");
+}
+
+const char *Upscaler::instruction_set() const {
+#ifdef UPSCALER_AVX2
+  if (simd && has_avx2())
+	return "avx2";
+#endif
+#ifdef UPSCALER_SSE2
+  if (simd)
+	return "sse2";
+#endif
+  return "portable";
+}
+
+void Upscaler::prepare(unsigned int display_width, unsigned int display_height) {
+  if (display_width == source_width && display_height == source_height)
+	return;
+
+  source_width = display_width;
+  source_height = display_height;
+  stride = source_width + 2;
+  source.assign(stride * (source_height + 2), 0);
+
+  unsigned int factor = filter == UpscaleFilter::SCALE2X ? 2 : filter == UpscaleFilter::SCALE3X ? 3 : 1;
+  unsigned int filtered_width = source_width * factor;
+  unsigned int filtered_height = source_height * factor;
+  if (factor > 1)
+	scaled.assign(static_cast<std::size_t>(filtered_width) * filtered_height, 0);
+
+  column_start.resize(filtered_width + 1);
+  for (unsigned int column = 0; column <= filtered_width; column++)
+	column_start[column] = static_cast<std::uint32_t>(static_cast<std::uint64_t>(column) * width / filtered_width);
+  row_source.resize(height);
+  for (unsigned int row = 0; row < height; row++)
+	row_source[row] = static_cast<unsigned int>(static_cast<std::uint64_t>(row) * filtered_height / height);
+}
+
+void Upscaler::unpack(const Chip8::CPU &cpu) {
+  const auto &planes = cpu.get_planes();
+
+  for (unsigned int y = 0; y < source_height; y++) {
+	unsigned char *row = source.data() + (y + 1) * stride + 1;
+	for (unsigned int x = 0; x < source_width; x += 8) {
+	  std::uint64_t pixels = 0;
+	  for (unsigned int plane = 0; plane < Chip8::N_PLANES; plane++) {
+		const Chip8::DisplayRow &packed = planes[plane][y];
+		std::uint64_t word = x < 64 ? packed.left : packed.right;
+		pixels |= BIT_BYTES[(word >> (56u - x % 64)) & 0xFFu] << plane; // bytes are 0 or 1, no carries
+	  }
+	  std::memcpy(row + x, &pixels, sizeof(pixels));
+	}
+	row[-1] = row[0];
+	row[source_width] = row[source_width - 1];
+  }
+  std::memcpy(source.data(), source.data() + stride, stride);
+  std::memcpy(source.data() + (source_height + 1) * stride, source.data() + source_height * stride, stride);
+}
+
+void Upscaler::scale2x() {
+  std::size_t out_width = 2 * source_width;
+  auto below = static_cast<std::ptrdiff_t>(stride); // offset of pixel below
+
+  for (unsigned int y = 0; y < source_height; y++) {
+	const unsigned char *e = source.data() + (y + 1) * stride + 1;
+	unsigned char *top = scaled.data() + 2 * y * out_width;
+	unsigned char *bottom = top + out_width;
+	unsigned int x = 0;
+
+#ifdef UPSCALER_SSE2
+	for (; simd && x + 16 <= source_width; x += 16) {
+	  __m128i b = load(e + x - below), d = load(e + x - 1), c = load(e + x), f = load(e + x + 1);
+	  __m128i h = load(e + x + below);
+	  __m128i db = _mm_cmpeq_epi8(d, b), bf = _mm_cmpeq_epi8(b, f);
+	  __m128i dh = _mm_cmpeq_epi8(d, h), hf = _mm_cmpeq_epi8(h, f);
+
+	  __m128i e0 = blend(_mm_andnot_si128(_mm_or_si128(bf, dh), db), d, c);
+	  __m128i e1 = blend(_mm_andnot_si128(_mm_or_si128(db, hf), bf), f, c);
+	  __m128i e2 = blend(_mm_andnot_si128(_mm_or_si128(db, hf), dh), d, c);
+	  __m128i e3 = blend(_mm_andnot_si128(_mm_or_si128(dh, bf), hf), f, c);
+
+	  store(top + 2 * x, _mm_unpacklo_epi8(e0, e1));
+	  store(top + 2 * x + 16, _mm_unpackhi_epi8(e0, e1));
+	  store(bottom + 2 * x, _mm_unpacklo_epi8(e2, e3));
+	  store(bottom + 2 * x + 16, _mm_unpackhi_epi8(e2, e3));
+	}
+#endif
+
+	for (; x < source_width; x++) {
+	  const unsigned char *p = e + x;
+	  unsigned char b = p[-below], d = p[-1], c = p[0], f = p[1], h = p[below];
+	  top[2 * x] = d == b && b != f && d != h ? d : c;
+	  top[2 * x + 1] = b == f && b != d && f != h ? f : c;
+	  bottom[2 * x] = d == h && d != b && h != f ? d : c;
+	  bottom[2 * x + 1] = h == f && d != h && b != f ? f : c;
+	}
+  }
+}
+
+void Upscaler::scale3x() {
+  std::size_t out_width = 3 * source_width;
+  auto below = static_cast<std::ptrdiff_t>(stride); // offset of pixel below
+
+  for (unsigned int y = 0; y < source_height; y++) {
+	const unsigned char *e = source.data() + (y + 1) * stride + 1;
+	unsigned char *rows[3];
+	rows[0] = scaled.data() + 3 * y * out_width;
+	rows[1] = rows[0] + out_width;
+	rows[2] = rows[1] + out_width;
+	unsigned int x = 0;
+
+#ifdef UPSCALER_SSE2
+	for (; simd && x + 16 <= source_width; x += 16) {
+	  __m128i a = load(e + x - below - 1), b = load(e + x - below), c = load(e + x - below + 1);
+	  __m128i d = load(e + x - 1), m = load(e + x), f = load(e + x + 1);
+	  __m128i g = load(e + x + below - 1), h = load(e + x + below), i = load(e + x + below + 1);
+	  __m128i db = _mm_cmpeq_epi8(d, b), bf = _mm_cmpeq_epi8(b, f);
+	  __m128i dh = _mm_cmpeq_epi8(d, h), hf = _mm_cmpeq_epi8(h, f);
+	  __m128i ea = _mm_cmpeq_epi8(m, a), ec = _mm_cmpeq_epi8(m, c);
+	  __m128i eg = _mm_cmpeq_epi8(m, g), ei = _mm_cmpeq_epi8(m, i);
+
+	  // corner rules of Scale2x, edges also look at the corner pixel
+	  __m128i c0 = _mm_andnot_si128(_mm_or_si128(bf, dh), db);
+	  __m128i c2 = _mm_andnot_si128(_mm_or_si128(db, hf), bf);
+	  __m128i c6 = _mm_andnot_si128(_mm_or_si128(db, hf), dh);
+	  __m128i c8 = _mm_andnot_si128(_mm_or_si128(dh, bf), hf);
+
+	  alignas(16) unsigned char out[9][16];
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[0]), blend(c0, d, m));
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[1]),
+					  blend(_mm_or_si128(_mm_andnot_si128(ec, c0), _mm_andnot_si128(ea, c2)), b, m));
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[2]), blend(c2, f, m));
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[3]),
+					  blend(_mm_or_si128(_mm_andnot_si128(eg, c0), _mm_andnot_si128(ea, c6)), d, m));
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[4]), m);
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[5]),
+					  blend(_mm_or_si128(_mm_andnot_si128(ei, c2), _mm_andnot_si128(ec, c8)), f, m));
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[6]), blend(c6, d, m));
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[7]),
+					  blend(_mm_or_si128(_mm_andnot_si128(ei, c6), _mm_andnot_si128(eg, c8)), h, m));
+	  _mm_store_si128(reinterpret_cast<__m128i *>(out[8]), blend(c8, f, m));
+
+	  // three way byte interleave has no SSE2 instruction
+	  for (unsigned int lane = 0; lane < 16; lane++) {
+		for (unsigned int row = 0; row < 3; row++) {
+		  for (unsigned int column = 0; column < 3; column++)
+			rows[row][3 * (x + lane) + column] = out[3 * row + column][lane];
+		}
+	  }
+	}
+#endif
+
+	for (; x < source_width; x++) {
+	  const unsigned char *p = e + x;
+	  unsigned char a = p[-below - 1], b = p[-below], c = p[-below + 1];
+	  unsigned char d = p[-1], m = p[0], f = p[1];
+	  unsigned char g = p[below - 1], h = p[below], i = p[below + 1];
+	  bool c0 = d == b && b != f && d != h;
+	  bool c2 = b == f && b != d && f != h;
+	  bool c6 = d == h && d != b && h != f;
+	  bool c8 = h == f && d != h && b != f;
+	  unsigned char *out = rows[0] + 3 * x;
+	  out[0] = c0 ? d : m;
+	  out[1] = (c0 && m != c) || (c2 && m != a) ? b : m;
+	  out[2] = c2 ? f : m;
+	  out = rows[1] + 3 * x;
+	  out[0] = (c0 && m != g) || (c6 && m != a) ? d : m;
+	  out[1] = m;
+	  out[2] = (c2 && m != i) || (c8 && m != c) ? f : m;
+	  out = rows[2] + 3 * x;
+	  out[0] = c6 ? d : m;
+	  out[1] = (c6 && m != i) || (c8 && m != g) ? h : m;
+	  out[2] = c8 ? f : m;
+	}
+  }
+}
+
+void Upscaler::render(const Chip8::CPU &cpu, std::uint32_t *pixels, std::size_t pitch) {
+  prepare(cpu.display_width(), cpu.display_height());
+  unpack(cpu);
+
+  const unsigned char *filtered = source.data() + stride + 1;
+  std::size_t filtered_stride = stride;
+  if (filter == UpscaleFilter::SCALE2X) {
+	scale2x();
+	filtered = scaled.data();
+	filtered_stride = 2 * source_width;
+  } else if (filter == UpscaleFilter::SCALE3X) {
+	scale3x();
+	filtered = scaled.data();
+	filtered_stride = 3 * source_width;
+  }
+
+  auto fill_row = fill_row_portable;
+#ifdef UPSCALER_SSE2
+  if (simd)
+	fill_row = fill_row_sse2;
+#endif
+#ifdef UPSCALER_AVX2
+  if (simd && has_avx2())
+	fill_row = fill_row_avx2;
+#endif
+
+  auto columns = static_cast<unsigned int>(column_start.size() - 1);
+  auto *out = reinterpret_cast<unsigned char *>(pixels);
+  for (unsigned int row = 0; row < height; row++, out += pitch) {
+	if (row > 0 && row_source[row] == row_source[row - 1])
+	  std::memcpy(out, out - pitch, width * sizeof(std::uint32_t)); // same source row, copy previous output
+	else
+	  fill_row(filtered + row_source[row] * filtered_stride, columns, column_start.data(),
+			   reinterpret_cast<std::uint32_t *>(out));
+  }
+}
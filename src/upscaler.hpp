@@ -0,0 +1,90 @@
+#ifndef CHIP8_EMU_CPP_UPSCALER_HPP
+#define CHIP8_EMU_CPP_UPSCALER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cpu.hpp"
+
+/**
+ * \brief Pixel art filter applied before scaling display to the output size.
+ */
+enum class UpscaleFilter {
+  NEAREST, //!< Every pixel becomes a rectangle.
+  SCALE2X, //!< Scale2x (EPX), smooths diagonals while doubling the resolution.
+  SCALE3X, //!< Scale3x, smooths diagonals while tripling the resolution.
+};
+
+/**
+ * \brief Gets filter from its name in app_conf.json.
+ *
+ * Throws runtime error for unknown names.
+ *
+ * @param name "nearest", "scale2x" or "scale3x"
+ * @return matching filter
+ */
+UpscaleFilter parse_upscale_filter(const std::string &name);
+
+/** \brief ARGB8888 color of each XO-CHIP color index, 1 is the only color outside of XO-CHIP. */
+const std::array<std::uint32_t, 1u << Chip8::N_PLANES> UPSCALE_PALETTE = {
+	0xFF000000, 0xFFFFFFFF, 0xFFAAAAAA, 0xFF555555,
+};
+
+/**
+ * \brief Scales cpu's display into ARGB8888 pixels of any size.
+ *
+ * Display is unpacked into color indices, optionally filtered by Scale2x or Scale3x and then scaled with nearest
+ * neighbour to the output size. Filters work on 16 pixels at once with SSE2, output is filled with runs of
+ * identical pixels using AVX2 when the cpu supports it. Output rows coming from the same source row are copied.
+ * Nothing is allocated after the first frame of each resolution.
+ */
+class Upscaler {
+  UpscaleFilter filter;
+  unsigned int width;
+  unsigned int height;
+  bool simd;
+
+  unsigned int source_width = 0; // display size the buffers below are prepared for
+  unsigned int source_height = 0;
+  std::size_t stride = 0; // bytes per row of source, including border
+  std::vector<unsigned char> source; // color indices with one pixel border replicated around
+  std::vector<unsigned char> scaled; // color indices after filter
+  std::vector<std::uint32_t> column_start; // first output column of each filtered column, one extra at the end
+  std::vector<unsigned int> row_source; // filtered row shown at each output row
+
+  void prepare(unsigned int display_width, unsigned int display_height);
+  void unpack(const Chip8::CPU &cpu);
+  void scale2x();
+  void scale3x();
+
+public:
+  /**
+   * \brief Creates upscaler writing output of given size.
+   *
+   * @param filter filter applied before scaling
+   * @param width output width in pixels
+   * @param height output height in pixels
+   * @param simd use SSE2/AVX2 kernels when available, false forces portable code
+   */
+  Upscaler(UpscaleFilter filter, unsigned int width, unsigned int height, bool simd = true);
+
+  /**
+   * \brief Draws display of the cpu.
+   *
+   * @param cpu cpu which display is drawn, in any resolution
+   * @param pixels first output pixel, e.g. of locked streaming texture
+   * @param pitch bytes between starts of output rows
+   */
+  void render(const Chip8::CPU &cpu, std::uint32_t *pixels, std::size_t pitch);
+
+  /**
+   * \brief Gets instruction set used by kernels.
+   *
+   * @return "avx2", "sse2" or "portable"
+   */
+  [[nodiscard]] const char *instruction_set() const;
+};
+
+#endif //CHIP8_EMU_CPP_UPSCALER_HPP
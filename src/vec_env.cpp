@@ -0,0 +1,123 @@
+#include "vec_env.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace {
+const std::size_t DISPLAY_SIZE = Chip8::SCREEN_WIDTH * Chip8::SCREEN_HEIGHT;
+
+std::shared_ptr<const Chip8::MemoryImage> create_image(const unsigned char *data, std::size_t size,
+													   const RomConf &rom) {
+  // shared image covers only CHIP-8 memory, XO-CHIP roms reaching into extended memory can't be shared
+  if (rom.xo_chip && size >= Chip8::MEMORY_SIZE - 0x200)
+	throw std::runtime_error("XO-CHIP rom of " + std::to_string(size) + " bytes is too large for VecEnv, at most "
+								 + std::to_string(Chip8::MEMORY_SIZE - 0x200 - 1) + " bytes are supported");
+  return Chip8::MemoryImage::create(data, size);
+}
+
+std::shared_ptr<const Chip8::MemoryImage> load_image(const RomConf &rom) {
+  if (rom.rom_data)
+	return create_image(rom.rom_data, rom.rom_size, rom);
+
+  std::ifstream file(rom.rom_location, std::ifstream::binary);
+  if (!file.is_open())
+	throw std::runtime_error("unable to open rom file at: " + rom.rom_location);
+  std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(file), {});
+  return create_image(buffer.data(), buffer.size(), rom);
+}
+}
+
+std::uint16_t action_mask(std::initializer_list<unsigned int> keys) {
+  std::uint16_t mask = 0;
+  for (auto key : keys) {
+	if (key >= Chip8::KEYBOARD_SIZE)
+	  throw std::runtime_error("no such key");
+	mask = static_cast<std::uint16_t>(mask | (1u << key));
+  }
+  return mask;
+}
+
+VecEnv::Instance::Instance(const std::shared_ptr<const Chip8::MemoryImage> &image, const RomConf &rom) :
+	cpu(image, rom.load_store_quirk, rom.shift_quirk, rom.wrapping) {
+  cpu.set_schip(rom.schip);
+  cpu.set_xo_chip(rom.xo_chip);
+}
+
+VecEnv::VecEnv(const VecEnvConf &conf, std::size_t n) :
+	actions(conf.actions), format(conf.format), frame_skip(conf.frame_skip),
+	cycles_per_frame(Chip8::TIMER_PERIOD / conf.rom.emulation_period), pool(conf.threads) {
+  if (actions.empty())
+	throw std::runtime_error("no actions");
+
+  auto image = load_image(conf.rom);
+  instances.reserve(n);
+  for (std::size_t i = 0; i < n; i++)
+	instances.push_back(std::make_unique<Instance>(image, conf.rom));
+}
+
+std::size_t VecEnv::observation_size() const {
+  return format == ObservationFormat::PACKED_BITS ? DISPLAY_SIZE / 8 : DISPLAY_SIZE;
+}
+
+void VecEnv::observe(const Instance &instance, unsigned char *observation) const {
+  if (format == ObservationFormat::PACKED_BITS) {
+	instance.cpu.pack_display(observation);
+  } else {
+	unsigned char packed[DISPLAY_SIZE / 8];
+	instance.cpu.pack_display(packed);
+	for (std::size_t pixel = 0; pixel < DISPLAY_SIZE; pixel++)
+	  observation[pixel] = (packed[pixel / 8] >> (7u - pixel % 8)) & 1u;
+  }
+}
+
+void VecEnv::run_frame(Instance &instance) const {
+  // cycles of a frame are rounded so that their sum follows speed exactly
+  auto first = static_cast<std::uint64_t>(std::floor(static_cast<double>(instance.frames) * cycles_per_frame));
+  auto last = static_cast<std::uint64_t>(std::floor(static_cast<double>(instance.frames + 1) * cycles_per_frame));
+  instance.frames++;
+
+  for (auto cycle = first; cycle < last; cycle++)
+	instance.engine.cycle();
+  instance.cpu.update_timers();
+}
+
+void VecEnv::reset(const std::uint32_t *seeds, unsigned char *observations) {
+  auto size = observation_size();
+  auto task = [&](std::size_t i) {
+	auto &instance = *instances[i];
+	instance.cpu.reset();
+	instance.cpu.seed_random(seeds[i]);
+	instance.frames = 0;
+	instance.faulted = false;
+	observe(instance, observations + i * size);
+  };
+  pool.parallel_for(instances.size(), task);
+}
+
+void VecEnv::step(const unsigned int *actions_taken, unsigned char *observations, unsigned char *done) {
+  for (std::size_t i = 0; i < instances.size(); i++)
+	if (actions_taken[i] >= actions.size())
+	  throw std::runtime_error("no such action");
+
+  auto size = observation_size();
+  auto task = [&](std::size_t i) {
+	auto &instance = *instances[i];
+	if (!instance.faulted) {
+	  instance.cpu.set_keys(actions[actions_taken[i]]);
+	  try {
+		for (unsigned int frame = 0; frame < frame_skip; frame++)
+		  run_frame(instance);
+	  } catch (const std::runtime_error &) {
+		instance.faulted = true;
+	  }
+	}
+	observe(instance, observations + i * size);
+	if (done)
+	  done[i] = instance.faulted;
+  };
+  pool.parallel_for(instances.size(), task);
+}
@@ -0,0 +1,126 @@
+#ifndef CHIP8_EMU_CPP_VEC_ENV_HPP
+#define CHIP8_EMU_CPP_VEC_ENV_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+#include "conf.hpp"
+#include "cpu.hpp"
+#include "predecoded.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * \brief Layout of observations written by VecEnv.
+ */
+enum class ObservationFormat {
+  PACKED_BITS, //!< 8 pixels per byte, see Chip8::CPU::pack_display.
+  BYTES //!< One byte per pixel, 0 or 1.
+};
+
+/**
+ * \brief Builds key mask of an action.
+ *
+ * @param keys keys pressed by the action
+ * @return mask where bit n is set when key n is pressed
+ */
+std::uint16_t action_mask(std::initializer_list<unsigned int> keys);
+
+/**
+ * \brief Configuration of vectorized environment.
+ */
+struct VecEnvConf {
+  RomConf rom; //!< Rom, speed and quirks shared by all environments.
+  unsigned int frame_skip = 4; //!< Number of 60 Hz frames emulated per step, action is held for all of them.
+  std::vector<std::uint16_t> actions; //!< Key mask held for each action, action i presses keys in actions[i].
+  ObservationFormat format = ObservationFormat::PACKED_BITS; //!< Layout of observations.
+  unsigned int threads = 0; //!< Number of threads stepping environments, 0 means one per core.
+};
+
+/**
+ * \brief Many instances of the same rom stepped together, meant for reinforcement learning.
+ *
+ * All instances share one memory image of the rom, so memory is copied only for written pages. Observations of all
+ * instances are written into one buffer supplied by the caller, instance i at offset i * observation_size(). Steps
+ * are executed in parallel and don't allocate memory.
+ *
+ * Instance which hit an error (e.g. unknown opcode) is marked as done and stays frozen until next reset.
+ *
+ * XO-CHIP roms run in XO-CHIP mode as long as they fit into the shared CHIP-8 memory image, larger ones are rejected.
+ */
+class VecEnv {
+  struct Instance {
+	Chip8::CPU cpu;
+	Chip8::PredecodedEngine engine{cpu};
+	std::uint64_t frames = 0;
+	bool faulted = false;
+
+	explicit Instance(const std::shared_ptr<const Chip8::MemoryImage> &image, const RomConf &rom);
+  };
+
+  std::vector<std::unique_ptr<Instance>> instances;
+  std::vector<std::uint16_t> actions;
+  ObservationFormat format;
+  unsigned int frame_skip;
+  double cycles_per_frame;
+  ThreadPool pool;
+
+  void observe(const Instance &instance, unsigned char *observation) const;
+  void run_frame(Instance &instance) const;
+
+public:
+  /**
+   * \brief Creates environments and loads rom into them.
+   *
+   * Throws runtime error if rom can't be loaded (including XO-CHIP roms larger than CHIP-8 memory) or there are no
+   * actions.
+   *
+   * @param conf configuration shared by all instances
+   * @param n number of instances
+   */
+  VecEnv(const VecEnvConf &conf, std::size_t n);
+
+  /**
+   * \brief Number of instances.
+   */
+  [[nodiscard]] std::size_t size() const { return instances.size(); }
+
+  /**
+   * \brief Number of actions.
+   */
+  [[nodiscard]] std::size_t action_count() const { return actions.size(); }
+
+  /**
+   * \brief Size of one observation in bytes.
+   */
+  [[nodiscard]] std::size_t observation_size() const;
+
+  /**
+   * \brief Restarts all instances.
+   *
+   * @param seeds random seed for each instance
+   * @param observations buffer of size() * observation_size() bytes receiving first observations
+   */
+  void reset(const std::uint32_t *seeds, unsigned char *observations);
+
+  /**
+   * \brief Holds one action in every instance for frame_skip frames.
+   *
+   * Throws runtime error if any action is out of range, before any instance is stepped.
+   *
+   * @param actions action index for each instance
+   * @param observations buffer of size() * observation_size() bytes receiving observations after the step
+   * @param done buffer of size() bytes receiving 1 for instances which hit an error, may be null
+   */
+  void step(const unsigned int *actions, unsigned char *observations, unsigned char *done = nullptr);
+
+  /**
+   * \brief Gives access to instance's cpu e.g. to read score from memory.
+   *
+   * @param i instance index
+   */
+  [[nodiscard]] const Chip8::CPU &cpu(std::size_t i) const { return instances.at(i)->cpu; }
+};
+
+#endif //CHIP8_EMU_CPP_VEC_ENV_HPP
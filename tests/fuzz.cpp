@@ -0,0 +1,273 @@
+// Fuzzing harness for chip8_lib.
+//
+// Input is interpreted as: flags (1 byte, bits 0-2 are quirks, bit 3 enables XO-CHIP and bit 4 SUPER-CHIP), random
+// seed (4 bytes), number of key events (1 byte), key events (1 byte each, lower nibble is the key, highest bit tells
+// if it's pressed) and the rest is a rom. Rom is executed for a bounded number of cycles on a single cpu, which is
+// reset between runs instead of being constructed again.
+//
+// When CHIP8_LIBFUZZER is defined only LLVMFuzzerTestOneInput is provided. Otherwise harness has its own mutator
+// guided by instruction and instruction-to-instruction coverage and reports how often each handler was executed.
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "cpu.hpp"
+#include "instructions.hpp"
+
+namespace {
+const std::size_t HEADER_SIZE = 6;
+const std::size_t MAX_KEY_EVENTS = 32;
+const std::size_t MAX_ROM_SIZE = Chip8::MEMORY_SIZE - Chip8::PC_INIT - 1;
+const std::size_t MAX_INPUT_SIZE = HEADER_SIZE + MAX_KEY_EVENTS + MAX_ROM_SIZE;
+const unsigned KEY_PERIOD = 16; // cycles between key events
+const unsigned TIMER_PERIOD = 8; // cycles between timers updates
+const std::size_t MAX_CORPUS_SIZE = 4096;
+
+/**
+ * Counts executed instructions, transitions between them and faults.
+ */
+struct Coverage {
+  std::array<std::uint64_t, Chip8::N_INSTRUCTIONS> executed{};
+  std::array<bool, Chip8::N_INSTRUCTIONS * Chip8::N_INSTRUCTIONS> edges{};
+  std::vector<std::pair<std::string, std::uint64_t>> faults;
+
+  /**
+   * Records fault, opcodes are stripped from unknown opcode messages so they count as one kind.
+   * Returns true when it's the first fault of this kind.
+   */
+  bool fault(const char *message) {
+	const char *unknown = "unknown opcode";
+	std::size_t length = std::strncmp(message, unknown, std::strlen(unknown)) == 0 ? std::strlen(unknown)
+																				   : std::strlen(message);
+
+	for (auto &known : faults) {
+	  if (known.first.compare(0, std::string::npos, message, length) == 0) {
+		known.second++;
+		return false;
+	  }
+	}
+	faults.emplace_back(std::string(message, length), 1);
+	return true;
+  }
+};
+
+unsigned max_cycles = 500;
+
+/**
+ * Runs single input. Returns true when it reached instruction, transition or fault not seen before.
+ */
+bool run_input(Chip8::CPU &cpu, const std::uint8_t *data, std::size_t size, Coverage &coverage) {
+  if (size < HEADER_SIZE)
+	return false;
+
+  std::uint8_t flags = data[0];
+  std::uint32_t seed = data[1] | (data[2] << 8u) | (data[3] << 16u) | (static_cast<std::uint32_t>(data[4]) << 24u);
+  std::size_t n_keys = std::min<std::size_t>({std::size_t{data[5]}, MAX_KEY_EVENTS, size - HEADER_SIZE});
+  const std::uint8_t *keys = data + HEADER_SIZE;
+  const std::uint8_t *rom = keys + n_keys;
+  std::size_t rom_size = std::min(size - HEADER_SIZE - n_keys, MAX_ROM_SIZE);
+
+  cpu.reset();
+  cpu.set_quirks(flags & 0x1u, flags & 0x2u, flags & 0x4u);
+  cpu.set_schip(flags & 0x10u);
+  cpu.set_xo_chip(flags & 0x8u);
+  cpu.seed_random(seed);
+  cpu.load_rom(rom, rom_size);
+
+  bool new_coverage = false;
+  unsigned previous = Chip8::UNKNOWN;
+  std::size_t key_index = 0;
+
+  try {
+	for (unsigned cycle = 0; cycle < max_cycles; cycle++) {
+	  if (cycle % KEY_PERIOD == 0 && key_index < n_keys) {
+		std::uint8_t key = keys[key_index++];
+		cpu.set_key(key & 0xFu, key & 0x80u);
+	  }
+	  if (cycle % TIMER_PERIOD == 0)
+		cpu.update_timers();
+
+	  unsigned id = Chip8::Instruction::decode(cpu.get_opcode(), cpu.mode());
+	  if (coverage.executed[id]++ == 0)
+		new_coverage = true;
+	  if (!coverage.edges[previous * Chip8::N_INSTRUCTIONS + id]) {
+		coverage.edges[previous * Chip8::N_INSTRUCTIONS + id] = true;
+		new_coverage = true;
+	  }
+	  previous = id;
+
+	  cpu.cycle();
+	}
+  } catch (const std::runtime_error &e) {
+	new_coverage |= coverage.fault(e.what());
+  }
+
+  return new_coverage;
+}
+}
+
+#ifdef CHIP8_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size) {
+  static Chip8::CPU cpu;
+  static Coverage coverage;
+  run_input(cpu, data, size, coverage);
+  return 0;
+}
+
+#else
+
+namespace {
+/**
+ * Xorshift64 generator driving the mutator.
+ */
+struct Random {
+  std::uint64_t state;
+
+  std::uint64_t next() {
+	state ^= state << 13u;
+	state ^= state >> 7u;
+	state ^= state << 17u;
+	return state;
+  }
+
+  std::size_t below(std::size_t n) { return static_cast<std::size_t>(next() % n); }
+};
+
+/**
+ * Opcode of an instruction, operands are nibbles set in the mask.
+ */
+struct OpcodeTemplate {
+  std::uint16_t opcode;
+  std::uint16_t operands;
+};
+
+/**
+ * Builds one template per instruction from its name, hex digits are fixed and letters are operands.
+ */
+std::array<OpcodeTemplate, Chip8::N_INSTRUCTIONS - 1> make_templates() {
+  std::array<OpcodeTemplate, Chip8::N_INSTRUCTIONS - 1> templates{};
+  for (unsigned id = 1; id < Chip8::N_INSTRUCTIONS; id++) {
+	const char *name = Chip8::Instruction::NAMES[id];
+	OpcodeTemplate &opcode = templates[id - 1];
+	for (unsigned i = 0; i < 4; i++) {
+	  auto shift = 12 - 4 * i;
+	  if (std::isxdigit(static_cast<unsigned char>(name[i])))
+		opcode.opcode |= static_cast<std::uint16_t>(std::stoul(std::string(1, name[i]), nullptr, 16) << shift);
+	  else
+		opcode.operands |= static_cast<std::uint16_t>(0xFu << shift);
+	}
+  }
+  return templates;
+}
+
+// opcodes with random operands are far more likely to reach handlers than random bytes
+const std::array<OpcodeTemplate, Chip8::N_INSTRUCTIONS - 1> OPCODE_TEMPLATES = make_templates();
+
+void mutate(std::vector<std::uint8_t> &input, Random &random) {
+  unsigned n_mutations = 1 + static_cast<unsigned>(random.below(4));
+  for (unsigned i = 0; i < n_mutations; i++) {
+	switch (random.below(5)) {
+	case 0: // flip a bit
+	  input[random.below(input.size())] ^= static_cast<std::uint8_t>(1u << random.below(8));
+	  break;
+	case 1: // random byte
+	  input[random.below(input.size())] = static_cast<std::uint8_t>(random.next());
+	  break;
+	case 2: { // opcode from templates with random operands, fixed nibbles are kept
+	  if (input.size() < HEADER_SIZE + 2)
+		break;
+	  std::size_t position = HEADER_SIZE + random.below(input.size() - HEADER_SIZE - 1);
+	  const OpcodeTemplate &opcode_template = OPCODE_TEMPLATES[random.below(OPCODE_TEMPLATES.size())];
+	  auto opcode = static_cast<std::uint16_t>(opcode_template.opcode | (random.next() & opcode_template.operands));
+	  input[position] = static_cast<std::uint8_t>(opcode >> 8u);
+	  input[position + 1] = static_cast<std::uint8_t>(opcode);
+	  break;
+	}
+	case 3: // grow
+	  if (input.size() < MAX_INPUT_SIZE)
+		input.push_back(static_cast<std::uint8_t>(random.next()));
+	  break;
+	default: // shrink
+	  if (input.size() > HEADER_SIZE + 2)
+		input.pop_back();
+	  break;
+	}
+  }
+}
+
+void print_report(const Coverage &coverage, std::uint64_t runs, double seconds, std::size_t corpus_size) {
+  std::cout << runs << " runs in " << seconds << " s (" << static_cast<double>(runs) / seconds << " runs/s), corpus "
+			<< corpus_size << std::endl;
+
+  std::cout << "executed instructions:" << std::endl;
+  for (unsigned id = 1; id < Chip8::N_INSTRUCTIONS; id++)
+	std::cout << "  " << Chip8::Instruction::NAMES[id] << " " << coverage.executed[id] << std::endl;
+
+  std::cout << "faults:" << std::endl;
+  for (const auto &fault : coverage.faults)
+	std::cout << "  " << fault.first << " " << fault.second << std::endl;
+}
+}
+
+int main(int argc, char *argv[]) {
+  std::uint64_t runs = 1000000;
+  Random random{0x9E3779B97F4A7C15u};
+  std::vector<std::vector<std::uint8_t>> corpus;
+
+  for (int i = 1; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--runs" && i + 1 < argc) {
+	  runs = std::stoull(argv[++i]);
+	} else if (option == "--seed" && i + 1 < argc) {
+	  random.state = std::stoull(argv[++i]) | 1u;
+	} else if (option == "--max-cycles" && i + 1 < argc) {
+	  max_cycles = static_cast<unsigned>(std::stoul(argv[++i]));
+	} else if (std::filesystem::is_directory(option)) {
+	  // every file in the directory is used as a rom in initial corpus
+	  for (const auto &file : std::filesystem::directory_iterator(option)) {
+		std::ifstream rom(file.path(), std::ifstream::binary);
+		std::vector<std::uint8_t> input(HEADER_SIZE, 0);
+		input.insert(input.end(), std::istreambuf_iterator<char>(rom), {});
+		input.resize(std::min(input.size(), MAX_INPUT_SIZE));
+		corpus.push_back(std::move(input));
+	  }
+	} else {
+	  std::cout << "usage: " << argv[0] << " [--runs N] [--seed N] [--max-cycles N] [CORPUS_DIR]" << std::endl;
+	  return 0;
+	}
+  }
+
+  if (corpus.empty())
+	corpus.emplace_back(HEADER_SIZE + 64, 0);
+
+  Chip8::CPU cpu;
+  Coverage coverage;
+  std::vector<std::uint8_t> input;
+  input.reserve(MAX_INPUT_SIZE);
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::uint64_t run = 0; run < runs; run++) {
+	const auto &parent = corpus[random.below(corpus.size())];
+	input.assign(parent.begin(), parent.end());
+	mutate(input, random);
+
+	if (run_input(cpu, input.data(), input.size(), coverage) && corpus.size() < MAX_CORPUS_SIZE)
+	  corpus.push_back(input);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  print_report(coverage, runs, elapsed.count(), corpus.size());
+  return 0;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "session_executor.hpp"
+
+TEST_CASE ("SESSION EXECUTOR TEST") {
+  // sets delay timer, waits for a key, copies it into sound timer and jumps to itself
+  std::vector<unsigned char> rom = {0x60, 0x3C, 0xF0, 0x15, 0xF1, 0x0A, 0xF1, 0x18, 0x12, 0x08};
+  RomConf config;
+  config.rom_data = rom.data();
+  config.rom_size = rom.size();
+  const std::chrono::duration<double> frame(Chip8::TIMER_PERIOD);
+
+  Emulator reference;
+  reference.load_config(config, 7);
+  SessionExecutor executor;
+  auto id = executor.spawn(config, 7);
+  REQUIRE(executor.running() == 1);
+
+  for (unsigned int i = 0; i < 30; i++) {
+	reference.run(frame, Emulator::Clock::time_point{});
+	executor.tick();
+  }
+  REQUIRE(executor.state(id) == SessionState::WAITING_FOR_KEY);
+  REQUIRE(executor.running() == 0);
+  REQUIRE(executor.emulated_frames() == 1);
+
+  reference.set_key(9, true);
+  executor.set_key(id, 9, true);
+  REQUIRE(executor.state(id) == SessionState::RUNNING);
+  REQUIRE(executor.skipped_frames() == 29);
+  for (unsigned int i = 0; i < 8; i++) {
+	reference.run(frame, Emulator::Clock::time_point{});
+	executor.tick();
+  }
+  REQUIRE(executor.state(id) == SessionState::IDLE);
+  REQUIRE(executor.emulated_frames() == 2);
+
+  // releasing doesn't wake the session, but catches its timers up
+  reference.set_key(9, false);
+  executor.set_key(id, 9, false);
+  REQUIRE(executor.state(id) == SessionState::IDLE);
+  const Emulator &hosted = executor.emulator(id);
+  REQUIRE(hosted.cycle_count() == reference.cycle_count());
+  REQUIRE(hosted.cpu.pc() == reference.cpu.pc());
+  REQUIRE(hosted.cpu.registers()[1] == 9);
+  REQUIRE(hosted.cpu.delay_timer() == reference.cpu.delay_timer());
+  REQUIRE(hosted.cpu.sound_timer() == reference.cpu.sound_timer());
+  REQUIRE(hosted.cpu.sound_timer() > 0);
+  REQUIRE(hosted.key_events().size() == 2);
+  REQUIRE(hosted.key_events()[0].cycle == reference.key_events()[0].cycle);
+
+  std::vector<unsigned char> broken = {0xFF, 0xFF};
+  config.rom_data = broken.data();
+  config.rom_size = broken.size();
+  auto faulty = executor.spawn(config, 1);
+  executor.tick();
+  REQUIRE(executor.state(faulty) == SessionState::FAULTED);
+  REQUIRE(!executor.error(faulty).empty());
+  REQUIRE(executor.running() == 0);
+}
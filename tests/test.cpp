@@ -1,6 +1,23 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 #include "cpu.hpp"
+#include "predecoded.hpp"
+#include "disassembler.hpp"
+#include "debugger.hpp"
+#include "analysis.hpp"
+#include "upscaler.hpp"
+#include "calibration.hpp"
+#include "emulator.hpp"
+#include "instance_pool.hpp"
+#include "perf_counters.hpp"
+#include "movie.hpp"
+#include "rom_pack.hpp"
+#include "frame_recorder.hpp"
+#include "frame_export.hpp"
+#include "vec_env.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 TEST_CASE ("DRAW + FONT TEST") {
   Chip8::CPU cpu;
@@ -10,14 +27,12 @@ TEST_CASE ("DRAW + FONT TEST") {
   for (unsigned int i = 0; i < rom.size(); i++)
 	cpu.cycle();
 
-  auto display = cpu.get_display();
   std::vector<unsigned char> data;
 
   for (unsigned int i = 0; i < 5; i++) {
 	unsigned char v = 0;
 	for (unsigned int j = 0; j < 8; j++) {
-	  auto index = i * Chip8::SCREEN_WIDTH + j;
-	  bool pixel = display[index];
+	  bool pixel = cpu.pixel(j, i);
 	  v = (v << 1u) | pixel;
 	}
 	data.push_back(v);
@@ -33,4 +48,1062 @@ TEST_CASE ("DRAW + FONT TEST") {
   // TODO test no wrapping
   // TODO test without fonts
   // TODO separate font test from draw test
-}
\ No newline at end of file
+}
+
+TEST_CASE ("KEYBOARD TEST") {
+  Chip8::CPU cpu;
+  std::vector<unsigned char> rom = {0xF3, 0x0A, 0xE3, 0x9E, 0xFF, 0xFF, 0x00, 0x00}; // wait for key, skip if pressed
+  cpu.load_rom(rom);
+
+  cpu.cycle();
+  cpu.cycle(); // no key pressed, Fx0A blocks
+
+  cpu.set_key(0xB, true);
+  cpu.set_key(0x5, true);
+  REQUIRE(cpu.keys() == 0x0820);
+  REQUIRE(cpu.key(0xB));
+  REQUIRE_FALSE(cpu.key(0x4));
+  REQUIRE_THROWS(cpu.set_key(16, true));
+
+  cpu.cycle(); // Fx0A stores lowest pressed key in V3
+  cpu.set_key(0xB, false);
+  REQUIRE(cpu.keys() == 0x0020);
+
+  cpu.cycle(); // Ex9E skips, key 5 is pressed
+  REQUIRE_NOTHROW(cpu.cycle()); // lands on 0x0000 at 0x206 instead of unknown opcode
+}
+
+TEST_CASE ("SHARED MEMORY TEST") {
+  // store BCD of 123 at 0x300, then draw its first digit
+  std::vector<unsigned char> rom = {0x60, 0x7B, 0xA3, 0x00, 0xF0, 0x33, 0xF0, 0x65, 0xF0, 0x29, 0xD1, 0x15};
+  auto image = Chip8::MemoryImage::create(rom.data(), rom.size());
+
+  Chip8::CPU owner;
+  owner.load_rom(rom);
+  Chip8::CPU first(image);
+  Chip8::CPU second(image);
+  REQUIRE(owner.shared_page_count() == 0);
+  REQUIRE(first.shared_page_count() == Chip8::N_PAGES);
+
+  for (unsigned int i = 0; i < 3; i++) {
+	owner.cycle();
+	first.cycle();
+  }
+  REQUIRE(first.shared_page_count() == Chip8::N_PAGES - 1); // only page with 0x300 was copied
+  REQUIRE(second.shared_page_count() == Chip8::N_PAGES);
+
+  Chip8::CPU fork(first);
+  REQUIRE(fork.shared_page_count() == Chip8::N_PAGES - 1);
+
+  for (unsigned int i = 0; i < 3; i++) {
+	owner.cycle();
+	first.cycle();
+	fork.cycle();
+  }
+  REQUIRE(first.get_display() == owner.get_display());
+  REQUIRE(fork.get_display() == owner.get_display());
+
+  for (unsigned int i = 0; i < 6; i++)
+	second.cycle();
+  REQUIRE(second.get_display() == owner.get_display());
+  REQUIRE(second.shared_page_count() == Chip8::N_PAGES - 1);
+}
+
+TEST_CASE ("PREDECODED SELF-MODIFYING CODE TEST") {
+  std::vector<unsigned char> rom = {
+	  0x22, 0x0C, // call 0x20C
+	  0x60, 0x6A, 0x61, 0x42, // V0 = 0x6A, V1 = 0x42
+	  0xA2, 0x0C, 0xF1, 0x55, // overwrite subroutine with 6A42
+	  0x22, 0x0C, // call 0x20C again
+	  0x6A, 0x00, 0x00, 0xEE, // subroutine: VA = 0, return
+  };
+
+  Chip8::CPU reference;
+  Chip8::CPU candidate;
+  Chip8::PredecodedEngine engine(candidate);
+  reference.load_rom(rom);
+  candidate.load_rom(rom);
+
+  for (unsigned int i = 0; i < 10; i++) {
+	reference.cycle();
+	engine.cycle();
+  }
+
+  REQUIRE(reference.registers()[0xA] == 0x42);
+  REQUIRE(candidate.registers() == reference.registers());
+  REQUIRE(candidate.pc() == reference.pc());
+}
+
+TEST_CASE ("TRACE BUFFER TEST") {
+  std::vector<unsigned char> rom = {
+	  0x6F, 0x07, // VF = 7
+	  0xA3, 0x00, // I = 0x300
+	  0x12, 0x08, // jump to 0x208
+	  0x00, 0x00,
+	  0xFF, 0xFF, // unknown opcode
+  };
+
+  Chip8::CPU cpu;
+  Chip8::TraceBuffer trace(2);
+  cpu.attach_trace(&trace);
+  cpu.load_rom(rom);
+
+  for (unsigned int i = 0; i < 3; i++)
+	cpu.cycle();
+  REQUIRE_THROWS(cpu.cycle());
+
+  // only last two instructions are remembered, the faulting one included
+  REQUIRE(trace.total() == 4);
+  REQUIRE(trace.size() == 2);
+  REQUIRE(trace[0].pc == 0x204);
+  REQUIRE(trace[0].index == 0x300);
+  REQUIRE(trace[0].vf == 7);
+  REQUIRE(trace[1].pc == 0x208);
+  REQUIRE(trace[1].opcode == 0xFFFF);
+}
+
+TEST_CASE ("DEBUGGER TEST") {
+  std::vector<unsigned char> rom = {
+	  0x60, 0x01, // V0 = 1
+	  0x70, 0x01, // loop: V0 += 1
+	  0xA3, 0x00, // I = 0x300
+	  0xF0, 0x55, // store V0 at 0x300
+	  0x12, 0x02, // jump to loop
+  };
+
+  Chip8::CPU cpu;
+  cpu.load_rom(rom);
+  Chip8::Debugger debugger(cpu);
+
+  debugger.add_breakpoint(0x206);
+  REQUIRE(debugger.run(100) == Chip8::StopReason::BREAKPOINT);
+  REQUIRE(cpu.pc() == 0x206);
+  REQUIRE(cpu.read(0x300) == 0);
+
+  // continuing from a breakpoint executes the instruction at it
+  debugger.remove_breakpoint(0x206);
+  debugger.add_watchpoint(0x300, 0x300);
+  REQUIRE(debugger.run(100) == Chip8::StopReason::WATCHPOINT);
+  REQUIRE(debugger.watch_address() == 0x300);
+  REQUIRE(cpu.read(0x300) == 2);
+
+  debugger.remove_watchpoint(0x300, 0x300);
+  debugger.add_condition(Chip8::register_equals(0, 5));
+  REQUIRE(debugger.run(100) == Chip8::StopReason::CONDITION);
+  REQUIRE(cpu.registers()[0] == 5);
+  REQUIRE(debugger.step() == Chip8::StopReason::CONDITION);
+}
+
+TEST_CASE ("ANALYSIS TEST") {
+  std::vector<unsigned char> rom = {
+	  0x22, 0x0A, // 200: call 0x20A
+	  0xA2, 0x10, // 202: I = sprite at 0x210
+	  0xD0, 0x12, // 204: draw 2 rows
+	  0x12, 0x02, // 206: jump to 0x202
+	  0x00, 0x00,
+	  0x30, 0x00, // 20A: skip if V0 == 0
+	  0x00, 0xEE, // 20C: return
+	  0x00, 0xEE, // 20E: return
+	  0xF0, 0x90, // 210: sprite
+  };
+
+  Chip8::RomAnalysis analysis = Chip8::analyze(rom.data(), rom.size());
+
+  REQUIRE(analysis.instructions.size() == 7);
+  REQUIRE_FALSE(analysis.is_code(0x208));
+  REQUIRE_FALSE(analysis.is_code(0x210));
+  REQUIRE(analysis.blocks.size() == 5);
+  REQUIRE(analysis.block_containing(0x204)->start == 0x202);
+  REQUIRE(analysis.block_containing(0x20A)->successors == std::vector<unsigned short>{0x20C, 0x20E});
+  REQUIRE(analysis.call_graph.at(0x200) == std::vector<unsigned short>{0x20A});
+  REQUIRE(analysis.call_graph.at(0x20A).empty());
+  REQUIRE(analysis.sprites.size() == 1);
+  REQUIRE(analysis.sprites[0].start == 0x210);
+  REQUIRE(analysis.sprites[0].size == 2);
+}
+
+TEST_CASE ("SCHIP DISPLAY TEST") {
+  Chip8::CPU cpu;
+  cpu.set_schip(true);
+  std::vector<unsigned char> rom = {
+	  0x00, 0xFF, // 200: high resolution
+	  0x60, 0x7C, // 202: V0 = 124
+	  0x61, 0x02, // 204: V1 = 2
+	  0xA2, 0x14, // 206: I = 0x214
+	  0xD0, 0x10, // 208: draw 16x16 sprite at (124, 2), wraps around the right edge
+	  0x00, 0xC3, // 20A: scroll down 3
+	  0x00, 0xFB, // 20C: scroll right 4
+	  0x00, 0xFC, // 20E: scroll left 4
+	  0x00, 0xFD, // 210: exit
+	  0x00, 0x00,
+	  0xFF, 0x01, // 214: sprite rows, first is 1111111100000001
+  };
+  rom.resize(rom.size() + 30, 0x00);
+  cpu.load_rom(rom);
+
+  cpu.cycle();
+  REQUIRE(cpu.hires());
+  REQUIRE(cpu.display_width() == Chip8::HIRES_WIDTH);
+  REQUIRE(cpu.display_height() == Chip8::HIRES_HEIGHT);
+
+  for (int i = 0; i < 4; i++)
+	cpu.cycle();
+  REQUIRE(cpu.registers()[0xF] == 0);
+  for (unsigned int x = 124; x < 128; x++)
+	REQUIRE(cpu.pixel(x, 2));
+  for (unsigned int x = 0; x < 4; x++)
+	REQUIRE(cpu.pixel(x, 2));
+  REQUIRE_FALSE(cpu.pixel(4, 2));
+  REQUIRE(cpu.pixel(11, 2));
+
+  cpu.cycle();
+  REQUIRE_FALSE(cpu.pixel(124, 2));
+  REQUIRE(cpu.pixel(124, 5));
+  REQUIRE(cpu.pixel(11, 5));
+
+  // scrolling right drops pixels at the right edge, scrolling back left leaves a gap
+  cpu.cycle();
+  REQUIRE(cpu.pixel(0, 5) == false);
+  REQUIRE(cpu.pixel(4, 5));
+  REQUIRE(cpu.pixel(15, 5));
+  cpu.cycle();
+  REQUIRE(cpu.pixel(0, 5));
+  REQUIRE(cpu.pixel(11, 5));
+  REQUIRE_FALSE(cpu.pixel(124, 5));
+
+  // low resolution view covers 2x2 pixels
+  std::array<unsigned char, Chip8::SCREEN_WIDTH * Chip8::SCREEN_HEIGHT / 8> packed{};
+  cpu.pack_display(packed.data());
+  REQUIRE(packed[2 * 8] == 0xC4);
+
+  cpu.cycle();
+  cpu.cycle();
+  REQUIRE(cpu.exited());
+  REQUIRE(cpu.pc() == 0x210);
+
+  cpu.reset();
+  REQUIRE_FALSE(cpu.hires());
+  REQUIRE_FALSE(cpu.exited());
+}
+
+TEST_CASE ("XO-CHIP TEST") {
+  Chip8::CPU cpu;
+  Chip8::TraceBuffer trace(8);
+  cpu.attach_trace(&trace);
+  cpu.set_xo_chip(true);
+  REQUIRE(cpu.memory_size() == Chip8::XO_MEMORY_SIZE);
+
+  std::vector<unsigned char> rom = {
+	  0xF0, 0x00, 0x20, 0x00, // 200: I = 0x2000
+	  0x60, 0x12, // 204: V0 = 0x12
+	  0x61, 0x34, // 206: V1 = 0x34
+	  0x50, 0x12, // 208: save V0 - V1
+	  0x60, 0x00, // 20A: V0 = 0
+	  0x61, 0x00, // 20C: V1 = 0
+	  0x51, 0x03, // 20E: load V1 - V0, reversed
+	  0x31, 0x12, // 210: skip if V1 == 0x12, skips whole long load
+	  0xF0, 0x00, 0x03, 0x00, // 212: I = 0x300
+	  0xF3, 0x01, // 216: select both planes
+	  0xA2, 0x30, // 218: I = 0x230
+	  0xD0, 0x11, // 21A: draw 1 row into each plane at (V0, V1)
+	  0xF0, 0x02, // 21C: load audio pattern
+	  0x62, 0x50, // 21E: V2 = 0x50
+	  0xF2, 0x3A, // 220: pitch = V2
+	  0xF2, 0x01, // 222: select plane 1
+	  0x00, 0xE0, // 224: clear plane 1
+  };
+  rom.resize(0x30, 0x00);
+  rom.push_back(0x80); // 230: plane 0 sprite
+  rom.push_back(0xC0); // 231: plane 1 sprite
+  rom.resize(5000, 0x00);
+  rom.back() = 0xAB; // past CHIP-8 memory
+  cpu.load_rom(rom);
+  REQUIRE(cpu.read_data(0x200 + 4999) == 0xAB);
+
+  for (int i = 0; i < 6; i++)
+	cpu.cycle();
+  REQUIRE(cpu.index() == 0x2000);
+  REQUIRE(cpu.read_data(0x2000) == 0x12);
+
+  // index past 0xFFF keeps its top digit in the trace
+  std::ostringstream dump;
+  trace.dump(dump, cpu.mode());
+  REQUIRE(dump.str().find("I=2000 ") != std::string::npos);
+  REQUIRE(cpu.read_data(0x2001) == 0x34);
+
+  cpu.cycle();
+  cpu.cycle();
+  REQUIRE(cpu.registers()[1] == 0x12);
+  REQUIRE(cpu.registers()[0] == 0x34);
+  REQUIRE(cpu.pc() == 0x216);
+
+  for (int i = 0; i < 6; i++)
+	cpu.cycle();
+  REQUIRE(cpu.selected_planes() == 3);
+  REQUIRE(cpu.color(0x34, 0x12) == 3);
+  REQUIRE(cpu.color(0x35, 0x12) == 2);
+  REQUIRE(cpu.color(0x36, 0x12) == 0);
+  REQUIRE(cpu.get_display()[0x12].left == 1ull << (63 - 0x34));
+  REQUIRE(cpu.audio_pattern_loaded());
+  REQUIRE(cpu.audio_pattern()[1] == 0xC0);
+  REQUIRE(cpu.audio_pitch() == 0x50);
+
+  cpu.cycle();
+  cpu.cycle();
+  REQUIRE(cpu.color(0x34, 0x12) == 1);
+  REQUIRE(cpu.color(0x35, 0x12) == 0);
+
+  cpu.reset();
+  REQUIRE(cpu.xo());
+  REQUIRE(cpu.read_data(0x2000) == 0);
+  REQUIRE(cpu.selected_planes() == 1);
+  REQUIRE_THROWS(cpu.load_rom(std::vector<unsigned char>(Chip8::XO_MEMORY_SIZE, 0)));
+}
+
+TEST_CASE ("XO-CHIP OPCODE GATING TEST") {
+  for (unsigned short opcode : {0x5012, 0x5013, 0xF000, 0xF201, 0xF002, 0xF03A}) {
+	REQUIRE(Chip8::Instruction::decode(opcode, Chip8::Mode::CHIP8) == Chip8::UNKNOWN);
+	REQUIRE(Chip8::Instruction::decode(opcode, Chip8::Mode::SCHIP) == Chip8::UNKNOWN);
+	REQUIRE(Chip8::Instruction::decode(opcode, Chip8::Mode::XO_CHIP) != Chip8::UNKNOWN);
+	REQUIRE(Chip8::disassemble(opcode, Chip8::Mode::CHIP8).rfind("DW ", 0) == 0);
+  }
+  REQUIRE(Chip8::Instruction::decode(0x5010, Chip8::Mode::CHIP8) == Chip8::ID_5xy0);
+
+  std::vector<unsigned char> rom = {
+	  0xF2, 0x01, // 200: select plane 2
+	  0x50, 0x12, // 202: save V0 - V1
+  };
+  Chip8::CPU interpreted;
+  interpreted.load_rom(rom);
+  REQUIRE_THROWS_WITH(interpreted.cycle(), "unknown opcode F201");
+
+  Chip8::CPU predecoded;
+  predecoded.load_rom(rom);
+  Chip8::PredecodedEngine engine(predecoded);
+  REQUIRE_THROWS_WITH(engine.cycle(), "unknown opcode F201");
+
+  // switching the mode drops instructions decoded before
+  predecoded.set_xo_chip(true);
+  engine.cycle();
+  engine.cycle();
+  REQUIRE(predecoded.selected_planes() == 2);
+  REQUIRE(predecoded.pc() == 0x204);
+}
+
+TEST_CASE ("SCHIP OPCODE GATING TEST") {
+  for (unsigned short opcode : {0x00C4, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF}) {
+	REQUIRE(Chip8::Instruction::decode(opcode, Chip8::Mode::CHIP8) == Chip8::UNKNOWN);
+	REQUIRE(Chip8::Instruction::decode(opcode, Chip8::Mode::SCHIP) != Chip8::UNKNOWN);
+	REQUIRE(Chip8::Instruction::decode(opcode, Chip8::Mode::XO_CHIP) != Chip8::UNKNOWN);
+	REQUIRE(Chip8::disassemble(opcode, Chip8::Mode::CHIP8).rfind("DW ", 0) == 0);
+  }
+  REQUIRE(Chip8::Instruction::decode(0x00E0, Chip8::Mode::CHIP8) == Chip8::ID_00E0);
+  REQUIRE(Chip8::mode_of(false, true) == Chip8::Mode::XO_CHIP);
+
+  // Dxy0 draws nothing on the original CHIP-8 and 16x16 sprite in SUPER-CHIP mode
+  std::vector<unsigned char> rom = {
+	  0x60, 0xFF, // 200: V0 = 0xFF
+	  0xA3, 0x00, // 202: I = 0x300
+	  0xF0, 0x55, // 204: fill 0x300 with V0
+	  0xA3, 0x00, // 206: I = 0x300
+	  0x61, 0x00, // 208: V1 = 0
+	  0xD1, 0x10, // 20A: draw V1, V1
+	  0x00, 0xFF, // 20C: high resolution
+  };
+  Chip8::CPU chip8;
+  chip8.load_rom(rom);
+  for (int i = 0; i < 6; i++)
+	chip8.cycle();
+  REQUIRE(chip8.get_display() == Chip8::Display{});
+  REQUIRE(chip8.registers()[0xF] == 0);
+  REQUIRE(chip8.pc() == 0x20C);
+  REQUIRE_THROWS_WITH(chip8.cycle(), "unknown opcode 00FF");
+  REQUIRE(!chip8.hires());
+
+  Chip8::CPU schip;
+  schip.set_schip(true);
+  REQUIRE(schip.mode() == Chip8::Mode::SCHIP);
+  schip.load_rom(rom);
+  for (int i = 0; i < 7; i++)
+	schip.cycle();
+  REQUIRE(schip.hires());
+  schip.reset();
+  REQUIRE(schip.schip());
+  schip.load_rom(rom);
+  for (int i = 0; i < 6; i++)
+	schip.cycle();
+  REQUIRE(schip.pixel(0, 0));
+  REQUIRE(schip.pixel(7, 0));
+  REQUIRE(!schip.pixel(8, 0)); // second byte of the row is 0x301
+
+  // switching the mode drops instructions decoded before
+  Chip8::CPU predecoded;
+  predecoded.load_rom(rom);
+  Chip8::PredecodedEngine engine(predecoded);
+  for (int i = 0; i < 6; i++)
+	engine.cycle();
+  REQUIRE_THROWS_WITH(engine.cycle(), "unknown opcode 00FF");
+  predecoded.set_schip(true);
+  engine.cycle();
+  REQUIRE(predecoded.hires());
+}
+
+TEST_CASE ("UPSCALER TEST") {
+  Chip8::CPU cpu;
+  // draw "1" at (0, 0), diagonal at (8, 0) from 0x208, then stop
+  cpu.load_rom({0xA0, 0x05, 0xD0, 0x05, 0xA2, 0x0C, 0x60, 0x08, 0xD0, 0x12, 0x12, 0x0A, 0x80, 0x40});
+  for (int i = 0; i < 5; i++)
+	cpu.cycle();
+  REQUIRE(cpu.pixel(8, 0));
+  REQUIRE(cpu.pixel(9, 1));
+
+  const std::uint32_t black = UPSCALE_PALETTE[0], white = UPSCALE_PALETTE[1];
+  std::vector<std::uint32_t> pixels(128 * 64);
+  Upscaler nearest(UpscaleFilter::NEAREST, 128, 64);
+  nearest.render(cpu, pixels.data(), 128 * sizeof(std::uint32_t));
+  REQUIRE(pixels[2 * 128 + 4] == white); // "1" starts at (2, 0)
+  REQUIRE(pixels[1 * 128 + 5] == white);
+  REQUIRE(pixels[0] == black);
+  REQUIRE(pixels[1 * 128 + 2] == black);
+
+  // Scale2x fills the corner between diagonal pixels, nearest leaves a step
+  Upscaler scale2x(UpscaleFilter::SCALE2X, 128, 64);
+  scale2x.render(cpu, pixels.data(), 128 * sizeof(std::uint32_t));
+  REQUIRE(pixels[1 * 128 + 17] == white);
+  REQUIRE(pixels[2 * 128 + 18] == white);
+  REQUIRE(pixels[1 * 128 + 18] == white);
+  REQUIRE(pixels[0 * 128 + 18] == black);
+  REQUIRE_THROWS(parse_upscale_filter("bilinear"));
+  REQUIRE(parse_upscale_filter("scale3x") == UpscaleFilter::SCALE3X);
+
+  // kernels produce the same image as portable code in every mode and at odd output sizes
+  std::vector<unsigned char> rom = {0x00, 0xFF, 0xF3, 0x01, 0x60, 0x00, 0x61, 0x00, 0xA0, 0x00, 0xD0, 0x10,
+									0x70, 0x0B, 0x71, 0x05, 0x12, 0x0A};
+  for (bool xo : {false, true}) {
+	// both planes are selected only in XO-CHIP mode, SUPER-CHIP cpu runs a NOP instead
+	rom[2] = xo ? 0xF3 : 0x00;
+	rom[3] = xo ? 0x01 : 0x00;
+	cpu.set_schip(true);
+	cpu.set_xo_chip(xo);
+	cpu.reset();
+	cpu.load_rom(rom);
+	for (int i = 0; i < 2000; i++)
+	  cpu.cycle();
+	REQUIRE(cpu.hires());
+	for (auto filter : {UpscaleFilter::NEAREST, UpscaleFilter::SCALE2X, UpscaleFilter::SCALE3X}) {
+	  for (unsigned int width : {640u, 333u}) {
+		std::vector<std::uint32_t> simd(width * 201), portable(width * 201);
+		Upscaler(filter, width, 201, true).render(cpu, simd.data(), width * sizeof(std::uint32_t));
+		Upscaler(filter, width, 201, false).render(cpu, portable.data(), width * sizeof(std::uint32_t));
+		REQUIRE(simd == portable);
+	  }
+	}
+  }
+}
+
+TEST_CASE ("CALIBRATION TEST") {
+  // draws a counter and waits one frame with Fx07 polling loop, about 9 cycles of work per frame
+  std::vector<unsigned char> throttled = {0x60, 0x00, 0xF1, 0x29, 0xD0, 0x05, 0x62, 0x01, 0xF2, 0x15, 0xF2, 0x07,
+										  0x32, 0x00, 0x12, 0x0A, 0xD0, 0x05, 0x71, 0x01, 0x12, 0x02};
+  RomConf rom;
+  rom.emulation_period = 1.0 / 1000;
+  rom.rom_data = throttled.data();
+  rom.rom_size = throttled.size();
+  CalibrationConf conf;
+  conf.frames = 600;
+
+  Calibration calibration = calibrate(rom, conf);
+  REQUIRE(calibration.configured_speed == 1000);
+  REQUIRE(calibration.throttled);
+  REQUIRE(calibration.reference.idle_fraction() > 0.2);
+  REQUIRE(calibration.reference.timer_wait_cycles > 0);
+  REQUIRE(calibration.recommended_speed < 1000);
+  REQUIRE(calibration.recommended_speed >= 9 * 60);
+  REQUIRE(calibration.rejected_speed == calibration.recommended_speed - conf.step);
+
+  SpeedProfile recommended = profile_speed(rom, calibration.recommended_speed, conf);
+  REQUIRE(recommended.settled.size() == calibration.reference.settled.size());
+  REQUIRE(recommended.settled.back().hash == calibration.reference.settled.back().hash);
+
+  // counter drawn as fast as possible changes with speed
+  std::vector<unsigned char> busy = {0x60, 0x00, 0xF1, 0x29, 0xD0, 0x05, 0xD0, 0x05, 0x71, 0x01, 0x12, 0x02};
+  rom.rom_data = busy.data();
+  rom.rom_size = busy.size();
+  calibration = calibrate(rom, conf);
+  REQUIRE_FALSE(calibration.throttled);
+  REQUIRE(calibration.recommended_speed == 1000);
+}
+
+TEST_CASE ("SNAPSHOT TEST") {
+  // draws random sprites while counting in memory, waits a frame between them
+  std::vector<unsigned char> rom = {0xC0, 0x3F, 0xC1, 0x1F, 0xA0, 0x00, 0xF2, 0x1E, 0xD0, 0x13, 0x72, 0x01,
+									0xA3, 0x10, 0xF2, 0x55, 0x63, 0x01, 0xF3, 0x15, 0xF3, 0x07, 0x33, 0x00,
+									0x12, 0x14, 0x12, 0x00};
+  RomConf config;
+  config.rom_data = rom.data();
+  config.rom_size = rom.size();
+
+  Emulator original;
+  original.load_config(config, 1234);
+  original.run_until(5000);
+  original.set_key(3, true);
+  original.run_until(5003);
+
+  auto path = (std::filesystem::temp_directory_path() / "chip8_snapshot_test.c8s").string();
+  original.snapshot().save(path);
+  Snapshot snapshot = Snapshot::load(path);
+  std::filesystem::remove(path);
+
+  Emulator restored;
+  restored.load_config(config, 1);
+  restored.run_until(100);
+  restored.restore(snapshot);
+  REQUIRE(restored.cycle_count() == 5003);
+  REQUIRE(restored.random_seed() == 1234);
+  REQUIRE(restored.key_events().empty());
+  REQUIRE(restored.cpu.keys() == original.cpu.keys());
+
+  original.run(std::chrono::duration<double>(2.0));
+  restored.run(std::chrono::duration<double>(2.0));
+  REQUIRE(restored.cycle_count() == original.cycle_count());
+  REQUIRE(restored.cpu.pc() == original.cpu.pc());
+  REQUIRE(restored.cpu.registers() == original.cpu.registers());
+  REQUIRE(restored.cpu.delay_timer() == original.cpu.delay_timer());
+  REQUIRE(restored.cpu.get_planes() == original.cpu.get_planes());
+  REQUIRE(original.cpu.get_display() != Chip8::Display{});
+  REQUIRE(restored.cpu.state().memory == original.cpu.state().memory);
+
+  Chip8::CPU xo;
+  xo.set_xo_chip(true);
+  REQUIRE_THROWS(xo.restore(snapshot.cpu));
+
+  // snapshot isn't restored over an edited rom or with different settings
+  std::vector<unsigned char> edited = rom;
+  edited[1] = 0x1F;
+  RomConf edited_config = config;
+  edited_config.rom_data = edited.data();
+  Emulator other;
+  other.load_config(edited_config, 1);
+  REQUIRE_THROWS(other.restore(snapshot));
+  REQUIRE(other.cycle_count() == 0);
+  REQUIRE(other.cpu.pc() == Chip8::PC_INIT);
+
+  RomConf quirky = config;
+  quirky.shift_quirk = true;
+  other.load_config(quirky, 1);
+  REQUIRE_THROWS(other.restore(snapshot));
+  RomConf faster = config;
+  faster.emulation_period = 1.0 / 1000;
+  other.load_config(faster, 1);
+  REQUIRE_THROWS(other.restore(snapshot));
+}
+
+TEST_CASE ("INSTANCE POOL TEST") {
+  // store BCD of 123 at 0x300, then draw its first digit
+  std::vector<unsigned char> rom = {0x60, 0x7B, 0xA3, 0x00, 0xF0, 0x33, 0xF0, 0x65, 0xF0, 0x29, 0xD1, 0x15};
+  auto image = Chip8::MemoryImage::create(rom.data(), rom.size());
+  RomConf config;
+  config.shift_quirk = true;
+
+  Chip8::CPU reference(image);
+  for (unsigned int i = 0; i < 6; i++)
+	reference.cycle();
+
+  InstancePool pool(3, image, config);
+  REQUIRE(pool.capacity() == 3);
+  REQUIRE(pool.memory_size() >= 3 * sizeof(Chip8::CPU));
+
+  Chip8::CPU &first = pool.acquire();
+  Chip8::CPU &second = pool.acquire();
+  REQUIRE(pool.index_of(first) == 0);
+  REQUIRE(pool.index_of(second) == 1);
+  REQUIRE(pool.available() == 1);
+  REQUIRE(first.shift_quirk());
+  REQUIRE(reinterpret_cast<std::uintptr_t>(&second) % Chip8::CACHE_LINE_SIZE == 0);
+
+  for (unsigned int i = 0; i < 6; i++)
+	first.cycle();
+  REQUIRE(first.get_display() == reference.get_display());
+
+  // reacquired cpu is reset, rom comes back from the shared image
+  pool.release(first);
+  REQUIRE_THROWS(pool.release(first));
+  Chip8::CPU &again = pool.acquire();
+  REQUIRE(&again == &first);
+  REQUIRE(again.pc() == Chip8::PC_INIT);
+  REQUIRE(again.get_display() == Chip8::Display{});
+  REQUIRE(again.shared_page_count() == Chip8::N_PAGES);
+  for (unsigned int i = 0; i < 6; i++)
+	again.cycle();
+  REQUIRE(again.get_display() == reference.get_display());
+
+  pool.acquire();
+  REQUIRE_THROWS(pool.acquire());
+  REQUIRE_THROWS(pool.release(reference));
+
+  // reacquired cpu draws the same random numbers instead of continuing the previous sequence
+  std::vector<unsigned char> random_rom = {0xC0, 0xFF, 0xC1, 0xFF};
+  InstancePool random_pool(1, Chip8::MemoryImage::create(random_rom.data(), random_rom.size()), config);
+  Chip8::CPU &seeded = random_pool.acquire();
+  seeded.seed_random(0xC8C8C8C8);
+  seeded.cycle();
+  seeded.cycle();
+  auto drawn = seeded.registers();
+  random_pool.release(seeded);
+  Chip8::CPU &recycled = random_pool.acquire();
+  recycled.cycle();
+  recycled.cycle();
+  REQUIRE(recycled.registers() == drawn);
+}
+
+TEST_CASE ("EMULATOR IDLE TEST") {
+  // sets delay timer and waits for a key
+  std::vector<unsigned char> rom = {0x60, 0xF0, 0xF0, 0x15, 0xF1, 0x0A};
+  RomConf config;
+  config.rom_data = rom.data();
+  config.rom_size = rom.size();
+  config.emulation_period = 1.0 / 700;
+  const std::chrono::duration<double> frame(Chip8::TIMER_PERIOD);
+
+  Emulator running, idle;
+  running.load_config(config, 1);
+  idle.load_config(config, 1);
+  running.run(frame, Emulator::Clock::time_point{});
+  idle.run(frame, Emulator::Clock::time_point{});
+  for (unsigned int i = 0; i < 100; i++) {
+	running.run(frame, Emulator::Clock::time_point{});
+	idle.idle(frame);
+  }
+
+  REQUIRE(idle.cycle_count() == running.cycle_count());
+  REQUIRE(idle.cpu.delay_timer() == running.cpu.delay_timer());
+  REQUIRE(idle.cpu.delay_timer() < 0xF0 - 90);
+  REQUIRE(idle.snapshot().timer_counter == running.snapshot().timer_counter);
+  REQUIRE(idle.snapshot().cycle_counter == running.snapshot().cycle_counter);
+}
+
+TEST_CASE ("KEY WAIT TEST") {
+  // sets delay timer, waits for a key and stores delay timer left
+  std::vector<unsigned char> rom = {0x60, 0xF0, 0xF0, 0x15, 0xF1, 0x0A, 0xF2, 0x07, 0x12, 0x08};
+  RomConf config;
+  config.rom_data = rom.data();
+  config.rom_size = rom.size();
+  config.emulation_period = 1.0 / 600;
+
+  Emulator emulator;
+  emulator.load_config(config, 1);
+  emulator.run_until(3);
+  REQUIRE(emulator.cpu.waiting_for_key());
+  REQUIRE(emulator.cpu.pc() == 0x204);
+
+  // waiting costs no instructions, but time keeps going
+  emulator.enable_trace(16);
+  emulator.run_until(3 + 600);
+  REQUIRE(emulator.cycle_count() == 603);
+  REQUIRE(emulator.trace_buffer()->size() == 0);
+  REQUIRE(emulator.cpu.delay_timer() == 0xF0 - 60);
+  REQUIRE(emulator.cpu.waiting_for_key());
+
+  emulator.set_key(4, false);
+  REQUIRE(emulator.cpu.waiting_for_key());
+  emulator.set_key(4, true);
+  REQUIRE(!emulator.cpu.waiting_for_key());
+  emulator.run_until(606);
+  REQUIRE(emulator.cpu.registers()[1] == 4);
+  REQUIRE(emulator.cpu.registers()[2] == 0xF0 - 60);
+  REQUIRE(emulator.cpu.pc() == 0x208);
+
+  Chip8::CPU cpu;
+  cpu.load_rom(rom);
+  for (unsigned int i = 0; i < 3; i++)
+	cpu.cycle();
+  REQUIRE(cpu.waiting_for_key());
+  cpu.set_keys(0x0001);
+  REQUIRE(!cpu.waiting_for_key());
+}
+
+TEST_CASE ("TIMESTAMPED KEYS TEST") {
+  std::vector<unsigned char> rom = {0x12, 0x00}; // jump to itself forever
+  RomConf config;
+  config.rom_data = rom.data();
+  config.rom_size = rom.size();
+  config.emulation_period = 1.0 / 1024;
+
+  Emulator emulator;
+  emulator.load_config(config, 1);
+  Emulator::Clock::time_point start{};
+  auto at = [&](double seconds) {
+	return start + std::chrono::duration_cast<Emulator::Clock::duration>(std::chrono::duration<double>(seconds));
+  };
+
+  // 128 cycles run over 0.125 s, presses land on cycles proportional to their time in the interval
+  emulator.push_key(5, true, at(-0.01));
+  emulator.push_key(3, true, at(0.03125));
+  emulator.push_key(3, false, at(0.09375));
+  emulator.push_key(7, true, at(0.2));
+  emulator.run(std::chrono::duration<double>(0.125), at(0.125));
+  REQUIRE(emulator.cycle_count() == 128);
+
+  const auto &events = emulator.key_events();
+  REQUIRE(events.size() == 4);
+  std::vector<std::uint64_t> cycles{0, 32, 96, 128}; // out of interval ones are clamped to its ends
+  std::vector<unsigned int> keys{5, 3, 3, 7};
+  std::vector<bool> values{true, true, false, true};
+  for (std::size_t i = 0; i < events.size(); i++) {
+	REQUIRE(events[i].cycle == cycles[i]);
+	REQUIRE(events[i].key == keys[i]);
+	REQUIRE(events[i].value == values[i]);
+  }
+
+  // next interval starts where the previous one ended
+  emulator.push_key(5, false, at(0.1875));
+  emulator.run(std::chrono::duration<double>(0.125), at(0.25));
+  REQUIRE(emulator.key_events().size() == 5);
+  REQUIRE(emulator.key_events().back().cycle == 128 + 64);
+}
+
+TEST_CASE ("PERF COUNTERS TEST") {
+  PerfCounters counters;
+  REQUIRE(counters.available() == counters.error().empty());
+  REQUIRE(std::string(perf_event_name(PerfEvent::BRANCH_MISSES)) == "branch-misses");
+
+  counters.start();
+  Chip8::CPU cpu;
+  cpu.load_rom(std::vector<unsigned char>{0x70, 0x01, 0x12, 0x00}); // add 1 to V0 forever
+  for (unsigned int i = 0; i < 10000; i++)
+	cpu.cycle();
+  PerfSample sample = counters.stop();
+
+  REQUIRE(sample.seconds > 0);
+  for (std::size_t i = 0; i < N_PERF_EVENTS; i++) {
+	auto event = static_cast<PerfEvent>(i);
+	REQUIRE(sample.has(event) == counters.available(event));
+  }
+  if (sample.has(PerfEvent::INSTRUCTIONS))
+	REQUIRE(sample.count(PerfEvent::INSTRUCTIONS) > 10000);
+
+  // raw L2 event codes are used only on models known to have them
+  REQUIRE(l2_miss_event("GenuineIntel", 0x6, 0x5E) == 0x3F24);
+  REQUIRE(l2_miss_event("GenuineIntel", 0x6, 0x97) == 0);
+  REQUIRE(l2_miss_event("AuthenticAMD", 0x19, 0x21) == 0x0964);
+  REQUIRE(l2_miss_event("AuthenticAMD", 0x15, 0x02) == 0);
+  REQUIRE(l2_miss_event("HygonGenuine", 0x18, 0x00) == 0);
+
+  // missing events are printed as "-"
+  std::ostringstream row;
+  print_perf_row(row, "LOOP", "interpreter", PerfSample{}, 10000);
+  REQUIRE(row.str().find('-') != std::string::npos);
+  REQUIRE(row.str().find("LOOP") == 0);
+}
+
+TEST_CASE ("MOVIE TEST") {
+  // draws random sprite at position chosen by the last pressed key, waits a frame between them
+  std::vector<unsigned char> rom = {0xC0, 0x3F, 0xA0, 0x00, 0xF1, 0x0A, 0xD0, 0x15, 0xF2, 0x15, 0xF2, 0x07,
+									0x32, 0x00, 0x12, 0x0A, 0x71, 0x01, 0x12, 0x00};
+  auto resources = std::filesystem::temp_directory_path() / "chip8_movie_test";
+  std::filesystem::create_directories(resources / "roms");
+  std::ofstream(resources / "roms" / "LOOP", std::ofstream::binary)
+	  .write(reinterpret_cast<const char *>(rom.data()), static_cast<std::streamsize>(rom.size()));
+  RomConf config(nlohmann::json{{"location", "roms/LOOP"}, {"speed", 600}}, resources);
+
+  auto movie_path = (resources / "session.c8mv").string();
+  Emulator emulator;
+  emulator.load_config(config, 77);
+  MovieRecorder recorder(movie_path, config, emulator.random_seed(), resources, 100);
+  for (unsigned int frame = 0; frame < 120; frame++) {
+	if (frame % 20 == 5)
+	  emulator.set_key(frame % 16, true);
+	if (frame % 20 == 9)
+	  emulator.set_key(frame % 16, false);
+	emulator.run_until((frame + 1) * 10);
+	recorder.update(emulator);
+  }
+  recorder.finish(emulator);
+  REQUIRE(!emulator.key_events().empty());
+  REQUIRE(emulator.cpu.get_display() != Chip8::Display{});
+  REQUIRE_THROWS(MovieRecorder(movie_path, config, 1, resources / "roms" / "other"));
+
+  // rom is stored relative to resources, so the movie replays from a moved directory
+  auto moved = std::filesystem::temp_directory_path() / "chip8_movie_test_moved";
+  std::filesystem::remove_all(moved);
+  std::filesystem::rename(resources, moved);
+  Movie movie = Movie::load((moved / "session.c8mv").string(), moved);
+  REQUIRE(movie.rom == "roms/LOOP");
+  REQUIRE(movie.config.rom_location == (moved / "roms" / "LOOP").string());
+  REQUIRE(movie.seed == 77);
+  REQUIRE(movie.length == 1200);
+  REQUIRE(movie.events.size() == emulator.key_events().size());
+  for (std::size_t i = 0; i < movie.events.size(); i++) {
+	REQUIRE(movie.events[i].cycle == emulator.key_events()[i].cycle);
+	REQUIRE(movie.events[i].key == emulator.key_events()[i].key);
+	REQUIRE(movie.events[i].value == emulator.key_events()[i].value);
+  }
+  REQUIRE(movie.checkpoints.size() == 12);
+  REQUIRE(movie.checkpoints.back().hash == frame_hash(emulator.cpu));
+
+  ReplayResult result = replay(movie);
+  REQUIRE(result.matched);
+  REQUIRE(result.verified == movie.checkpoints.size());
+  REQUIRE(result.cycles == 1200);
+
+  movie.checkpoints[3].hash ^= 1u;
+  result = replay(movie);
+  REQUIRE(!result.matched);
+  REQUIRE(result.mismatch_cycle == movie.checkpoints[3].cycle);
+  std::filesystem::remove_all(moved);
+}
+
+TEST_CASE ("ROM PACK TEST") {
+  auto resources = std::filesystem::temp_directory_path() / "chip8_rom_pack_test";
+  std::filesystem::create_directories(resources / "roms");
+  std::vector<unsigned char> pong = {0x12, 0x00};
+  std::vector<unsigned char> brix = {0x60, 0x01, 0x12, 0x02, 0x00};
+  std::ofstream(resources / "roms.json") << "{}";
+  std::ofstream(resources / "roms" / "PONG", std::ofstream::binary)
+	  .write(reinterpret_cast<const char *>(pong.data()), static_cast<std::streamsize>(pong.size()));
+  std::ofstream(resources / "roms" / "BRIX", std::ofstream::binary)
+	  .write(reinterpret_cast<const char *>(brix.data()), static_cast<std::streamsize>(brix.size()));
+
+  RomConf quirky;
+  quirky.shift_quirk = true;
+  quirky.emulation_period = 1.0 / 1000;
+  auto path = (resources / "roms.pack").string();
+  write_rom_pack(path, {RomPackSource{"PONG", "roms/PONG", "", RomConf(), pong},
+						RomPackSource{"BRIX", "roms/BRIX", "snapshots/BRIX.c8s", quirky, brix}});
+  REQUIRE_THROWS(write_rom_pack(path + ".dup", {RomPackSource{"PONG", "roms/PONG", "", RomConf(), pong},
+												RomPackSource{"PONG", "roms/PONG", "", RomConf(), pong}}));
+
+  {
+	RomPack pack(path);
+	REQUIRE(pack.end() - pack.begin() == 2);
+	REQUIRE(pack.name(*pack.begin()) == "BRIX");
+	REQUIRE(pack.find("TETRIS") == nullptr);
+
+	const RomPackEntry *entry = pack.find("BRIX");
+	REQUIRE(entry != nullptr);
+	RomConf config = pack.config(*entry, resources);
+	REQUIRE(std::vector<unsigned char>(config.rom_data, config.rom_data + config.rom_size) == brix);
+	REQUIRE(config.emulation_period == quirky.emulation_period);
+	REQUIRE(config.shift_quirk);
+	REQUIRE(!config.load_store_quirk);
+	REQUIRE(config.rom_location == (resources / "roms" / "BRIX").string());
+	REQUIRE(config.snapshot_location == (resources / "snapshots" / "BRIX.c8s").string());
+
+	// missing snapshot, then edited roms.json make the pack outdated
+	const RomPackEntry *pong_entry = pack.find("PONG");
+	REQUIRE(!pack.outdated(*pong_entry, resources));
+	REQUIRE(pack.outdated(*entry, resources));
+	std::filesystem::last_write_time(resources / "roms.json",
+									 std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+	REQUIRE(pack.outdated(*pong_entry, resources));
+  }
+
+  std::vector<char> bytes;
+  {
+	std::ifstream in(path, std::ifstream::binary);
+	bytes.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  auto write_corrupted = [&](const std::vector<char> &corrupted) {
+	std::ofstream(path, std::ofstream::binary | std::ofstream::trunc)
+		.write(corrupted.data(), static_cast<std::streamsize>(corrupted.size()));
+  };
+
+  // truncated header, wrong magic, table of contents past the end, rom past the end
+  write_corrupted(std::vector<char>(bytes.begin(), bytes.begin() + 8));
+  REQUIRE_THROWS(RomPack(path));
+  auto corrupted = bytes;
+  corrupted[0] = 'X';
+  write_corrupted(corrupted);
+  REQUIRE_THROWS(RomPack(path));
+  corrupted = bytes;
+  RomPackHeader header{};
+  std::memcpy(&header, corrupted.data(), sizeof(header));
+  header.count = 1000;
+  std::memcpy(corrupted.data(), &header, sizeof(header));
+  write_corrupted(corrupted);
+  REQUIRE_THROWS(RomPack(path));
+  corrupted = bytes;
+  RomPackEntry entry{};
+  std::memcpy(&entry, corrupted.data() + sizeof(header), sizeof(entry));
+  entry.rom_size = static_cast<std::uint32_t>(bytes.size());
+  std::memcpy(corrupted.data() + sizeof(header), &entry, sizeof(entry));
+  write_corrupted(corrupted);
+  REQUIRE_THROWS(RomPack(path));
+  write_corrupted(bytes);
+  REQUIRE_NOTHROW(RomPack(path));
+
+  std::filesystem::remove_all(resources);
+}
+
+TEST_CASE ("FRAME RECORDER TEST") {
+  // draws digit in low resolution, switches to high resolution and draws into both XO-CHIP planes
+  std::vector<unsigned char> rom = {0x60, 0x05, 0xD0, 0x15, 0x00, 0xFF, 0xA0, 0x0A, 0xD0, 0x15, 0xF2, 0x01,
+									0x60, 0x7A, 0x61, 0x3C, 0xD0, 0x15, 0xF3, 0x01, 0x00, 0xFB, 0xD1, 0x15};
+  Chip8::CPU cpu;
+  cpu.set_xo_chip(true);
+  cpu.load_rom(rom);
+
+  auto path = (std::filesystem::temp_directory_path() / "chip8_frame_recorder_test.c8r").string();
+  std::vector<Chip8::CPU> captured;
+  {
+	FrameRecorder recorder(path, 2); // small queue, so that capturing waits for the writer
+	for (unsigned int i = 0; i < 12; i++) {
+	  captured.push_back(cpu);
+	  recorder.capture(cpu);
+	  recorder.capture(cpu); // unchanged frame encodes into runs only
+	  cpu.cycle();
+	}
+	recorder.finish();
+	REQUIRE(recorder.frame_count() == 24);
+  }
+  REQUIRE(captured.back().hires());
+  REQUIRE(captured.back().get_planes()[1] != Chip8::Display{});
+
+  RecordingReader reader(path);
+  REQUIRE(reader.rate() == 60);
+  for (const auto &expected : captured) {
+	for (unsigned int repeat = 0; repeat < 2; repeat++) {
+	  REQUIRE(reader.next());
+	  REQUIRE(recorded_hires(reader.frame()) == expected.hires());
+	  unsigned int mismatches = 0;
+	  for (unsigned int y = 0; y < expected.display_height(); y++) {
+		for (unsigned int x = 0; x < expected.display_width(); x++)
+		  mismatches += recorded_color(reader.frame(), x, y) != expected.color(x, y);
+	  }
+	  REQUIRE(mismatches == 0);
+	}
+  }
+  REQUIRE(!reader.next());
+
+  // frame cut off by the end of file
+  std::ofstream(path, std::ofstream::binary | std::ofstream::app).put(static_cast<char>(0x85));
+  RecordingReader truncated(path);
+  for (unsigned int i = 0; i < captured.size() * 2; i++)
+	truncated.next();
+  REQUIRE_THROWS(truncated.next());
+  std::filesystem::remove(path);
+}
+
+TEST_CASE ("FRAME EXPORT TEST") {
+  // switches to high resolution and draws digit into both XO-CHIP planes
+  std::vector<unsigned char> rom = {0x00, 0xFF, 0xF3, 0x01, 0x60, 0x7C, 0x61, 0x02, 0xD0, 0x15, 0xF2, 0x01, 0xD1, 0x15};
+  Chip8::CPU cpu;
+  cpu.set_xo_chip(true);
+  cpu.load_rom(rom);
+  for (unsigned int i = 0; i < 7; i++)
+	cpu.cycle();
+
+  std::string name = "/chip8_frame_export_test_" + std::to_string(getpid());
+  FrameExporter exporter(name);
+  FrameReader reader(name);
+  FrameSnapshot snapshot;
+  REQUIRE(!reader.read(snapshot));
+
+  exporter.publish(cpu, true);
+  REQUIRE(reader.read(snapshot));
+  REQUIRE(snapshot.frame == 1);
+  REQUIRE(snapshot.sound);
+  REQUIRE(snapshot.hires);
+  REQUIRE(snapshot.planes == cpu.get_planes());
+  REQUIRE(snapshot.color(2, 2) == 2);
+  unsigned int mismatches = 0;
+  for (unsigned int y = 0; y < snapshot.height(); y++) {
+	for (unsigned int x = 0; x < snapshot.width(); x++)
+	  mismatches += snapshot.color(x, y) != cpu.color(x, y);
+  }
+  REQUIRE(mismatches == 0);
+
+  exporter.publish(Chip8::CPU(), false);
+  REQUIRE(reader.read(snapshot));
+  REQUIRE(snapshot.frame == 2);
+  REQUIRE(!snapshot.hires);
+  REQUIRE(snapshot.width() == Chip8::SCREEN_WIDTH);
+
+  // writer stopped in the middle of publishing, reader gives up instead of spinning
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  REQUIRE(fd >= 0);
+  void *address = mmap(nullptr, sizeof(SharedFrame), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  REQUIRE(address != MAP_FAILED);
+  auto *shared = static_cast<SharedFrame *>(address);
+  shared->sequence.fetch_add(1);
+  FrameSnapshot stale = snapshot;
+  stale.frame = 42;
+  REQUIRE(!reader.read(stale));
+  REQUIRE(stale.frame == 42);
+  shared->sequence.fetch_add(1);
+  REQUIRE(reader.read(stale));
+  munmap(address, sizeof(SharedFrame));
+}
+
+TEST_CASE ("VEC ENV TEST") {
+  // draws random digit at position moved by the pressed key, waits for the delay timer between draws
+  std::vector<unsigned char> rom = {0x00, 0xE0, 0xC2, 0x0F, 0xF2, 0x29, 0x63, 0x04, 0xE3, 0xA1, 0x70, 0x03,
+									0x63, 0x05, 0xE3, 0xA1, 0x71, 0x02, 0xD0, 0x15, 0x64, 0x02, 0xF4, 0x15,
+									0xF4, 0x07, 0x34, 0x00, 0x12, 0x18, 0x12, 0x00};
+  VecEnvConf conf;
+  conf.rom.rom_data = rom.data();
+  conf.rom.rom_size = rom.size();
+  conf.frame_skip = 3;
+  conf.actions = {action_mask({}), action_mask({4}), action_mask({5}), action_mask({4, 5})};
+  const std::size_t n = 6;
+  const unsigned int steps = 20;
+  std::vector<std::uint32_t> seeds = {1, 2, 3, 4, 5, 6};
+  auto action = [](std::size_t i, unsigned int step) { return static_cast<unsigned int>((i + step / 3) % 4); };
+
+  // every observation of every step, for given number of threads
+  auto run = [&](unsigned int threads) {
+	conf.threads = threads;
+	VecEnv env(conf, n);
+	std::vector<unsigned char> observations(n * env.observation_size());
+	std::vector<unsigned char> history;
+	env.reset(seeds.data(), observations.data());
+	history.insert(history.end(), observations.begin(), observations.end());
+	std::vector<unsigned int> actions(n);
+	for (unsigned int step = 0; step < steps; step++) {
+	  for (std::size_t i = 0; i < n; i++)
+		actions[i] = action(i, step);
+	  env.step(actions.data(), observations.data());
+	  history.insert(history.end(), observations.begin(), observations.end());
+	}
+	return history;
+  };
+  auto single = run(1);
+  REQUIRE(run(4) == single);
+  REQUIRE(run(4) == single);
+
+  // last observation of each instance matches a plain cpu fed with the same input
+  double cycles_per_frame = Chip8::TIMER_PERIOD / conf.rom.emulation_period;
+  std::size_t observation_size = Chip8::SCREEN_WIDTH * Chip8::SCREEN_HEIGHT / 8;
+  for (std::size_t i = 0; i < n; i++) {
+	Chip8::CPU cpu;
+	cpu.load_rom(rom);
+	cpu.seed_random(seeds[i]);
+	std::uint64_t frames = 0;
+	for (unsigned int step = 0; step < steps; step++) {
+	  cpu.set_keys(conf.actions[action(i, step)]);
+	  for (unsigned int frame = 0; frame < conf.frame_skip; frame++, frames++) {
+		auto first = static_cast<std::uint64_t>(std::floor(static_cast<double>(frames) * cycles_per_frame));
+		auto last = static_cast<std::uint64_t>(std::floor(static_cast<double>(frames + 1) * cycles_per_frame));
+		for (auto cycle = first; cycle < last; cycle++)
+		  cpu.cycle();
+		cpu.update_timers();
+	  }
+	}
+	std::vector<unsigned char> expected(observation_size);
+	cpu.pack_display(expected.data());
+	auto offset = single.size() - (n - i) * observation_size;
+	REQUIRE(std::equal(expected.begin(), expected.end(), single.begin() + static_cast<std::ptrdiff_t>(offset)));
+	REQUIRE(expected != std::vector<unsigned char>(observation_size));
+  }
+
+  // XO-CHIP roms run in XO-CHIP mode when they fit into the shared image
+  conf.rom.xo_chip = true;
+  conf.threads = 1;
+  VecEnv xo(conf, 2);
+  REQUIRE(xo.cpu(1).xo());
+  std::vector<unsigned char> large(Chip8::MEMORY_SIZE);
+  conf.rom.rom_data = large.data();
+  conf.rom.rom_size = large.size();
+  REQUIRE_THROWS(VecEnv(conf, 2));
+}
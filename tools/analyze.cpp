@@ -0,0 +1,107 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "analysis.hpp"
+#include "conf.hpp"
+#include "disassembler.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+std::string address_string(unsigned int address) {
+  return Chip8::opcode_string(static_cast<unsigned short>(address)).substr(1);
+}
+
+void print_analysis(const std::string &name, const std::vector<unsigned char> &rom, const Chip8::RomAnalysis &analysis,
+					Chip8::Mode mode, bool listing) {
+  std::cout << name << ": " << analysis.instructions.size() << " instructions in " << analysis.blocks.size()
+			<< " blocks, " << analysis.call_graph.size() - 1 << " subroutines" << std::endl;
+
+  if (listing) {
+	for (const auto &block : analysis.blocks) {
+	  std::cout << "block " << address_string(block.start) << ':' << std::endl;
+	  for (unsigned int address = block.start; address < block.end(); address += 2) {
+		auto opcode = static_cast<unsigned short>((rom[address - Chip8::PC_INIT] << 8u)
+			| rom[address - Chip8::PC_INIT + 1]);
+		std::cout << "  " << address_string(address) << "  " << Chip8::disassemble(opcode, mode) << std::endl;
+	  }
+	  std::cout << "  ->";
+	  for (auto successor : block.successors)
+		std::cout << ' ' << address_string(successor);
+	  if (block.call >= 0)
+		std::cout << " (calls " << address_string(static_cast<unsigned int>(block.call)) << ')';
+	  if (block.returns)
+		std::cout << " return";
+	  if (block.computed_jump)
+		std::cout << " computed jump";
+	  std::cout << std::endl;
+	}
+  }
+
+  std::cout << "call graph:" << std::endl;
+  for (const auto &[caller, callees] : analysis.call_graph) {
+	std::cout << "  " << address_string(caller) << " ->";
+	for (auto callee : callees)
+	  std::cout << ' ' << address_string(callee);
+	std::cout << std::endl;
+  }
+
+  std::cout << "sprites:";
+  for (const auto &region : analysis.sprites)
+	std::cout << ' ' << address_string(region.start) << '+' << region.size;
+  std::cout << std::endl;
+
+  std::cout << "code writes:";
+  for (const auto &write : analysis.code_writes) {
+	std::cout << ' ' << address_string(write.address);
+	if (write.target_known)
+	  std::cout << "->" << address_string(write.first) << '-' << address_string(write.last);
+	else
+	  std::cout << "->?";
+  }
+  std::cout << std::endl;
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <ROM_NAME> [--listing]" << std::endl;
+	std::cout << "prints blocks, call graph, sprites and self-modifying writes of rom from RESOURCES_DIR/roms.json"
+			  << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::string name = argv[2];
+  bool listing = argc > 3 && std::string(argv[3]) == "--listing";
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (!roms.contains(name))
+	  throw std::runtime_error("unknown rom " + name);
+	RomConf config(roms[name], resources_path);
+
+	std::ifstream rom_file(config.rom_location, std::ifstream::binary);
+	if (!rom_file.is_open())
+	  throw std::runtime_error("unable to open rom file at: " + config.rom_location);
+	std::vector<unsigned char> rom(std::istreambuf_iterator<char>(rom_file), {});
+
+	Chip8::AnalysisOptions options;
+	options.load_store_quirk = config.load_store_quirk;
+	options.schip = config.schip;
+	options.xo_chip = config.xo_chip;
+	print_analysis(name, rom, Chip8::analyze(rom.data(), rom.size(), options),
+				   Chip8::mode_of(config.schip, config.xo_chip), listing);
+	return 0;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "analysis.hpp"
+#include "aot.hpp"
+#include "conf.hpp"
+#include "disassembler.hpp"
+#include "instructions.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+std::string hex(unsigned int value, int width) {
+  std::ostringstream text;
+  text << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(width) << value;
+  return text.str();
+}
+
+void write_program(std::ostream &out, const std::string &name, const RomConf &config,
+				   const std::vector<unsigned char> &rom, const std::vector<Chip8::BasicBlock> &blocks) {
+  auto opcode_at = [&](unsigned int address) {
+	std::size_t offset = address - Chip8::PC_INIT;
+	return static_cast<unsigned short>((rom[offset] << 8u) | rom[offset + 1]);
+  };
+  Chip8::Mode mode = Chip8::mode_of(config.schip, config.xo_chip);
+
+  out << "// generated by chip8_aot from rom " << name << ", do not edit\n"
+	  << "#include \"aot.hpp\"\n"
+	  << "#include \"instructions.hpp\"\n\n"
+	  << "using Chip8::Instruction;\n\n"
+	  << "namespace {\n"
+	  << "const unsigned char ROM[] = {";
+  for (std::size_t i = 0; i < rom.size(); i++)
+	out << (i % 16 ? " " : "\n\t") << hex(rom[i], 2) << ',';
+  out << "\n};\n\n";
+
+  out << "const Chip8::AotBlock BLOCKS[] = {\n";
+  for (const auto &block : blocks)
+	out << "\t{" << hex(block.start, 3) << ", " << block.length << "},\n";
+  out << "};\n\n";
+
+  // instructions are entered at offset and left when count runs out
+  out << "void run_block(Chip8::CPU &cpu, std::size_t block, unsigned int offset, unsigned int count) {\n"
+	  << "  switch (block) {\n";
+  for (std::size_t i = 0; i < blocks.size(); i++) {
+	out << "  case " << i << ":\n"
+		<< "\tswitch (offset) {\n";
+	for (unsigned int n = 0; n < blocks[i].length; n++) {
+	  unsigned int address = blocks[i].start + 2 * n;
+	  unsigned short opcode = opcode_at(address);
+	  out << "\tcase " << n << ":\n"
+		  << "\t  Instruction::i_" << Chip8::Instruction::NAMES[Chip8::Instruction::decode(opcode, mode)]
+		  << "(cpu, " << hex(opcode, 4) << "); // " << hex(address, 3) << ' '
+		  << Chip8::disassemble(opcode, mode) << '\n';
+	  if (n + 1 < blocks[i].length)
+		out << "\t  if (--count == 0)\n\t\treturn;\n\t  [[fallthrough]];\n";
+	  else
+		out << "\t  return;\n";
+	}
+	out << "\tdefault:\n\t  return;\n\t}\n";
+  }
+  out << "  default:\n\treturn;\n  }\n}\n}\n\n";
+
+  out << std::boolalpha << std::setprecision(17)
+	  << "extern const Chip8::AotProgram AOT_PROGRAM = {\n"
+	  << "\t\"" << name << "\", ROM, sizeof(ROM), " << config.emulation_period << ",\n"
+	  << "\t" << config.load_store_quirk << ", " << config.shift_quirk << ", " << config.wrapping << ", "
+	  << config.schip << ", " << config.xo_chip << ",\n"
+	  << "\tBLOCKS, sizeof(BLOCKS) / sizeof(BLOCKS[0]), run_block,\n"
+	  << "};\n";
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <ROM_NAME> <OUTPUT_CPP>" << std::endl;
+	std::cout << "compiles rom from RESOURCES_DIR/roms.json into C++ source defining AOT_PROGRAM" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::string name = argv[2];
+  std::string output_path = argv[3];
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (!roms.contains(name))
+	  throw std::runtime_error("unknown rom " + name);
+	RomConf config(roms[name], resources_path);
+
+	std::ifstream rom_file(config.rom_location, std::ifstream::binary);
+	if (!rom_file.is_open())
+	  throw std::runtime_error("unable to open rom file at: " + config.rom_location);
+	std::vector<unsigned char> rom(std::istreambuf_iterator<char>(rom_file), {});
+	if (rom.empty() || rom.size() >= Chip8::MEMORY_SIZE - Chip8::PC_INIT)
+	  throw std::runtime_error("invalid rom size");
+
+	// blocks end after writes, so that the engine notices modified code before executing it
+	Chip8::AnalysisOptions options;
+	options.max_block_length = Chip8::AOT_MAX_BLOCK;
+	options.end_blocks_after_writes = true;
+	options.load_store_quirk = config.load_store_quirk;
+	options.schip = config.schip;
+	options.xo_chip = config.xo_chip;
+	std::vector<Chip8::BasicBlock> blocks = Chip8::analyze(rom.data(), rom.size(), options).blocks;
+
+	std::ofstream output(output_path);
+	if (!output.is_open())
+	  throw std::runtime_error("unable to create " + output_path);
+	write_program(output, name, config, rom, blocks);
+
+	std::size_t instructions = 0;
+	for (const auto &block : blocks)
+	  instructions += block.length;
+	std::cout << name << ": " << blocks.size() << " blocks, " << instructions << " instructions" << std::endl;
+	return 0;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
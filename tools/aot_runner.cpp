@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "aot.hpp"
+#include "perf_counters.hpp"
+
+extern const Chip8::AotProgram AOT_PROGRAM; // defined in source generated by chip8_aot
+
+namespace {
+const std::uint32_t RANDOM_SEED = 0xC8C8C8C8;
+const unsigned int KEY_FRAMES = 7; // frames between key changes
+
+/**
+ * \brief Deterministic keyboard state for given frame, so that games get some input.
+ */
+std::uint16_t keys_at(std::uint64_t frame) {
+  std::uint64_t hash = (frame / KEY_FRAMES + 1) * 0x9E3779B97F4A7C15u;
+  return static_cast<std::uint16_t>(1u << ((hash >> 32u) & 0xFu));
+}
+
+bool same_state(const Chip8::CPU &a, const Chip8::CPU &b) {
+  return a.pc() == b.pc() && a.index() == b.index() && a.sp() == b.sp() && a.registers() == b.registers()
+	  && a.delay_timer() == b.delay_timer() && a.sound_timer() == b.sound_timer() && a.get_planes() == b.get_planes()
+	  && a.hires() == b.hires();
+}
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = 60;
+  bool check = false;
+  bool perf = false;
+
+  for (int i = 1; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--seconds" && i + 1 < argc) {
+	  seconds = std::stod(argv[++i]);
+	} else if (option == "--check") {
+	  check = true;
+	} else if (option == "--perf") {
+	  perf = true;
+	} else {
+	  std::cout << "usage: " << argv[0] << " [--seconds N] [--check] [--perf]" << std::endl;
+	  std::cout << "runs " << AOT_PROGRAM.name << " compiled ahead of time for N emulated seconds, with --check "
+				<< "compares every frame with the interpreter, with --perf prints hardware counters like "
+				<< "chip8_perf_bench" << std::endl;
+	  return 0;
+	}
+  }
+
+  Chip8::CPU cpu(AOT_PROGRAM.load_store_quirk, AOT_PROGRAM.shift_quirk, AOT_PROGRAM.wrapping);
+  cpu.set_schip(AOT_PROGRAM.schip);
+  cpu.set_xo_chip(AOT_PROGRAM.xo_chip);
+  cpu.load_rom(AOT_PROGRAM.rom, AOT_PROGRAM.rom_size);
+  cpu.seed_random(RANDOM_SEED);
+  Chip8::CPU reference = cpu;
+  Chip8::AotEngine engine(cpu, AOT_PROGRAM);
+
+  double cycles_per_frame = Chip8::TIMER_PERIOD / AOT_PROGRAM.emulation_period;
+  auto frames = static_cast<std::uint64_t>(seconds / Chip8::TIMER_PERIOD);
+  std::uint64_t cycles = 0;
+
+  PerfCounters counters;
+  if (perf && !counters.available())
+	std::cerr << "hardware counters unavailable (" << counters.error() << "), printing only speed" << std::endl;
+
+  try {
+	counters.start();
+	auto start = std::chrono::steady_clock::now();
+	for (std::uint64_t frame = 0; frame < frames; frame++) {
+	  auto end = static_cast<std::uint64_t>(std::floor(static_cast<double>(frame + 1) * cycles_per_frame));
+	  cpu.set_keys(keys_at(frame));
+	  engine.run(end - cycles);
+	  cpu.update_timers();
+
+	  if (check) {
+		reference.set_keys(keys_at(frame));
+		for (auto cycle = cycles; cycle < end; cycle++)
+		  reference.cycle();
+		reference.update_timers();
+		if (!same_state(cpu, reference)) {
+		  std::cout << AOT_PROGRAM.name << ": state differs from interpreter after frame " << frame << std::endl;
+		  return 1;
+		}
+	  }
+	  cycles = end;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	PerfSample sample = counters.stop();
+
+	double compiled = static_cast<double>(engine.compiled_cycles()) / static_cast<double>(cycles ? cycles : 1);
+	std::cout << AOT_PROGRAM.name << ": " << cycles << " cycles in " << elapsed.count() << " s, "
+			  << static_cast<double>(cycles) / elapsed.count() / 1e6 << " M cycles/s, " << compiled * 100
+			  << "% compiled" << (check ? ", matches interpreter" : "") << std::endl;
+	if (perf) {
+	  print_perf_header(std::cout);
+	  print_perf_row(std::cout, AOT_PROGRAM.name, "aot", sample, cycles);
+	}
+	return 0;
+  } catch (const std::exception &e) {
+	std::cerr << AOT_PROGRAM.name << ": " << e.what() << " in frame starting at cycle " << cycles << std::endl;
+	return 1;
+  }
+}
@@ -0,0 +1,84 @@
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "calibration.hpp"
+
+using json = nlohmann::json;
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> [ROM_NAME...] [--frames N] [--step N] [--out FILE]"
+			  << std::endl;
+	std::cout << "finds the lowest speed of each rom with output identical to its configured speed and writes "
+				 "roms.json with these speeds, by default into RESOURCES_DIR/roms.calibrated.json" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::filesystem::path out_path = resources_path / "roms.calibrated.json";
+  std::vector<std::string> names;
+  CalibrationConf conf;
+
+  for (int i = 2; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--frames" && i + 1 < argc)
+	  conf.frames = std::stoul(argv[++i]);
+	else if (option == "--step" && i + 1 < argc)
+	  conf.step = std::stoul(argv[++i]);
+	else if (option == "--out" && i + 1 < argc)
+	  out_path = argv[++i];
+	else
+	  names.push_back(option);
+  }
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (names.empty()) {
+	  for (const auto &rom : roms.items())
+		names.push_back(rom.key());
+	}
+
+	double configured_total = 0, recommended_total = 0;
+	std::cout << std::left << std::setw(12) << "rom" << std::right << std::setw(8) << "speed" << std::setw(8) << "idle"
+			  << std::setw(12) << "recommended" << std::endl;
+	for (const auto &name : names) {
+	  if (!roms.contains(name))
+		throw std::runtime_error("unknown rom " + name);
+	  Calibration calibration = calibrate(RomConf(roms[name], resources_path), conf);
+
+	  std::cout << std::left << std::setw(12) << name << std::right << std::setw(8) << calibration.configured_speed
+				<< std::setw(7) << std::fixed << std::setprecision(1) << calibration.reference.idle_fraction() * 100
+				<< "%" << std::setw(12) << calibration.recommended_speed;
+	  if (!calibration.throttled)
+		std::cout << "  (not throttled, " << std::setprecision(0) << calibration.reference.settled_fraction() * 100
+				  << "% settled frames)";
+	  if (calibration.rejected_speed)
+		std::cout << "  (" << calibration.rejected_speed << " differs at frame " << calibration.first_mismatch << ")";
+	  if (!calibration.reference.error.empty())
+		std::cout << "  (stopped: " << calibration.reference.error << ")";
+	  std::cout << std::endl;
+
+	  roms[name]["speed"] = calibration.recommended_speed;
+	  configured_total += calibration.configured_speed;
+	  recommended_total += calibration.recommended_speed;
+	}
+
+	std::ofstream out(out_path);
+	if (!out.is_open())
+	  throw std::runtime_error("unable to write " + out_path.string());
+	out << roms.dump(2) << std::endl;
+	std::cout << "wrote " << out_path.string() << ", " << std::setprecision(1)
+			  << 100 * (1 - recommended_total / configured_total) << "% fewer cycles" << std::endl;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
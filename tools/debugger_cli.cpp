@@ -0,0 +1,184 @@
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "conf.hpp"
+#include "cpu.hpp"
+#include "debugger.hpp"
+#include "disassembler.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+const char *HELP =
+	"b ADDR          break at address\n"
+	"d ADDR          delete breakpoint\n"
+	"w FIRST LAST    stop after write into memory range\n"
+	"u FIRST LAST    delete watchpoint\n"
+	"v X VALUE       stop when VX == VALUE\n"
+	"i FIRST LAST    stop when I is in range\n"
+	"n               delete all conditions\n"
+	"s               single step\n"
+	"c [CYCLES]      continue, at most 100000000 cycles by default\n"
+	"r               show registers\n"
+	"x ADDR [LEN]    show memory\n"
+	"q               quit\n"
+	"numbers are hexadecimal except CYCLES and LEN\n";
+
+const std::uint64_t DEFAULT_CONTINUE = 100000000; // cycles run by continue without argument
+
+const char *REASONS[] = {"finished", "breakpoint", "watchpoint", "condition"};
+
+unsigned int hex(std::istream &in) {
+  std::string text;
+  in >> text;
+  return static_cast<unsigned int>(std::stoul(text, nullptr, 16));
+}
+
+void show_registers(const Chip8::CPU &cpu) {
+  std::cout << std::hex << std::uppercase << std::setfill('0');
+  for (unsigned int x = 0; x < Chip8::N_REGISTERS; x++)
+	std::cout << 'V' << x << '=' << std::setw(2) << static_cast<unsigned int>(cpu.registers()[x])
+			  << (x % 8 == 7 ? '\n' : ' ');
+  std::cout << "PC=" << std::setw(3) << cpu.pc() << " I=" << std::setw(3) << cpu.index()
+			<< " SP=" << static_cast<unsigned int>(cpu.sp()) << " DT=" << std::setw(2)
+			<< static_cast<unsigned int>(cpu.delay_timer()) << " ST=" << std::setw(2)
+			<< static_cast<unsigned int>(cpu.sound_timer()) << std::dec << std::setfill(' ') << std::endl;
+}
+
+void show_memory(const Chip8::CPU &cpu, unsigned int address, unsigned int length) {
+  std::cout << std::hex << std::uppercase << std::setfill('0');
+  for (unsigned int i = 0; i < length && address + i < Chip8::MEMORY_SIZE; i++) {
+	if (i % 16 == 0)
+	  std::cout << (i ? "\n" : "") << std::setw(3) << address + i << ':';
+	std::cout << ' ' << std::setw(2) << static_cast<unsigned int>(cpu.read(address + i));
+  }
+  std::cout << std::dec << std::setfill(' ') << std::endl;
+}
+
+/**
+ * \brief Runs debugger updating timers at 60 Hz of emulated time.
+ *
+ * @param frames number of timers updates done so far, updated
+ */
+Chip8::StopReason run(Chip8::Debugger &debugger, Chip8::CPU &cpu, double cycles_per_frame, std::uint64_t &frames,
+					  std::uint64_t cycles) {
+  std::uint64_t end = debugger.cycle_count() + cycles;
+
+  while (debugger.cycle_count() < end) {
+	auto next_tick = static_cast<std::uint64_t>(std::floor(static_cast<double>(frames + 1) * cycles_per_frame));
+	Chip8::StopReason reason = Chip8::StopReason::FINISHED;
+	if (debugger.cycle_count() < next_tick)
+	  reason = debugger.run(std::min(end, next_tick) - debugger.cycle_count());
+	if (debugger.cycle_count() >= next_tick) {
+	  cpu.update_timers();
+	  frames++;
+	}
+	if (reason != Chip8::StopReason::FINISHED)
+	  return reason;
+  }
+  return Chip8::StopReason::FINISHED;
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <ROM_NAME>" << std::endl;
+	std::cout << "debugs rom from RESOURCES_DIR/roms.json, commands are read from standard input" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::string name = argv[2];
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (!roms.contains(name))
+	  throw std::runtime_error("unknown rom " + name);
+	RomConf config(roms[name], resources_path);
+
+	std::ifstream rom_file(config.rom_location, std::ifstream::binary);
+	if (!rom_file.is_open())
+	  throw std::runtime_error("unable to open rom file at: " + config.rom_location);
+	std::vector<unsigned char> rom(std::istreambuf_iterator<char>(rom_file), {});
+
+	Chip8::CPU cpu(config.load_store_quirk, config.shift_quirk, config.wrapping);
+	cpu.set_schip(config.schip);
+	cpu.set_xo_chip(config.xo_chip);
+	cpu.load_rom(rom);
+	Chip8::Debugger debugger(cpu);
+	double cycles_per_frame = Chip8::TIMER_PERIOD / config.emulation_period;
+	std::uint64_t frames = 0;
+
+	std::string line;
+	std::cout << "> " << std::flush;
+	while (std::getline(std::cin, line)) {
+	  std::istringstream command(line);
+	  char op = 0;
+	  command >> op;
+
+	  try {
+		if (op == 'q') {
+		  break;
+		} else if (op == 'b') {
+		  debugger.add_breakpoint(hex(command));
+		} else if (op == 'd') {
+		  debugger.remove_breakpoint(hex(command));
+		} else if (op == 'w' || op == 'u') {
+		  unsigned int first = hex(command);
+		  unsigned int last = hex(command);
+		  if (op == 'w')
+			debugger.add_watchpoint(first, last);
+		  else
+			debugger.remove_watchpoint(first, last);
+		} else if (op == 'v') {
+		  unsigned int x = hex(command);
+		  debugger.add_condition(Chip8::register_equals(x, static_cast<unsigned char>(hex(command))));
+		} else if (op == 'i') {
+		  unsigned int first = hex(command);
+		  debugger.add_condition(Chip8::index_in_range(first, hex(command)));
+		} else if (op == 'n') {
+		  debugger.clear_conditions();
+		} else if (op == 's' || op == 'c') {
+		  std::uint64_t cycles = 1;
+		  if (op == 'c' && !(command >> cycles))
+			cycles = DEFAULT_CONTINUE;
+		  Chip8::StopReason reason = run(debugger, cpu, cycles_per_frame, frames, cycles);
+		  std::cout << REASONS[static_cast<int>(reason)] << " after " << debugger.cycle_count() << " cycles";
+		  if (reason == Chip8::StopReason::WATCHPOINT)
+			std::cout << ", write to " << Chip8::opcode_string(debugger.watch_address()).substr(1);
+		  std::cout << std::endl;
+		  for (const auto &text : Chip8::disassemble_window(cpu, cpu.pc(), 2, 2))
+			std::cout << text << std::endl;
+		} else if (op == 'r') {
+		  show_registers(cpu);
+		} else if (op == 'x') {
+		  unsigned int address = hex(command);
+		  unsigned int length = 16;
+		  command >> length;
+		  show_memory(cpu, address, length);
+		} else if (op != 0) {
+		  std::cout << HELP;
+		}
+	  } catch (const std::logic_error &) {
+		std::cout << HELP;
+	  } catch (const std::runtime_error &e) {
+		std::cout << e.what() << std::endl;
+	  }
+	  std::cout << "> " << std::flush;
+	}
+	return 0;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
@@ -0,0 +1,253 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "conf.hpp"
+#include "cpu.hpp"
+#include "disassembler.hpp"
+#include "predecoded.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+const unsigned KEY_PERIOD = 97; // cycles between key changes
+const unsigned TIMER_PERIOD = 8; // cycles between timers updates
+const std::uint32_t RANDOM_SEED = 0xC8C8C8C8;
+
+/**
+ * \brief Reference cpu and candidate engine executed in lockstep.
+ */
+struct Lockstep {
+  Chip8::CPU reference;
+  Chip8::CPU candidate;
+  Chip8::PredecodedEngine engine{candidate};
+  std::string reference_error;
+  std::string candidate_error;
+
+  /**
+   * \brief Gives both cpus the same input and executes one cycle on each.
+   *
+   * Input depends only on the cycle number, so running again from a snapshot reproduces it exactly.
+   */
+  void step(std::uint64_t cycle) {
+	if (cycle % KEY_PERIOD == 0) {
+	  std::uint64_t hash = (cycle + 1) * 0x9E3779B97F4A7C15u;
+	  auto key = static_cast<unsigned int>((hash >> 32u) & 0xFu);
+	  bool value = (hash >> 40u) & 1u;
+	  reference.set_key(key, value);
+	  candidate.set_key(key, value);
+	}
+	if (cycle % TIMER_PERIOD == 0) {
+	  reference.update_timers();
+	  candidate.update_timers();
+	}
+
+	try {
+	  reference.cycle();
+	} catch (const std::runtime_error &e) {
+	  reference_error = e.what();
+	}
+	try {
+	  engine.cycle();
+	} catch (const std::runtime_error &e) {
+	  candidate_error = e.what();
+	}
+  }
+
+  bool faulted() const { return !reference_error.empty() || !candidate_error.empty(); }
+};
+
+std::string hex(unsigned int value) {
+  std::string digits = Chip8::opcode_string(static_cast<unsigned short>(value));
+  return "0x" + digits;
+}
+
+/**
+ * \brief Compares whole state of two cpus.
+ *
+ * Covers everything captured by CPU::state() and whether the cpu waits in Fx0A for a key.
+ *
+ * @return description of the first difference or empty string if states are equal
+ */
+std::string compare(const Chip8::CPU &cpu_a, const Chip8::CPU &cpu_b) {
+  Chip8::CPUState a = cpu_a.state();
+  Chip8::CPUState b = cpu_b.state();
+  auto number = [](unsigned int value) { return std::to_string(value); };
+  auto flag = [](bool value) { return std::string(value ? "true" : "false"); };
+
+  if (a.pc != b.pc)
+	return "PC " + hex(a.pc) + " != " + hex(b.pc);
+  if (a.index != b.index)
+	return "I " + hex(a.index) + " != " + hex(b.index);
+  if (a.sp != b.sp)
+	return "SP " + number(a.sp) + " != " + number(b.sp);
+  if (a.delay_timer != b.delay_timer)
+	return "DT " + number(a.delay_timer) + " != " + number(b.delay_timer);
+  if (a.sound_timer != b.sound_timer)
+	return "ST " + number(a.sound_timer) + " != " + number(b.sound_timer);
+  for (unsigned int i = 0; i < Chip8::N_REGISTERS; i++) {
+	if (a.registers[i] != b.registers[i])
+	  return "V" + number(i) + " " + number(a.registers[i]) + " != " + number(b.registers[i]);
+  }
+  for (unsigned int i = 0; i < a.sp; i++) {
+	if (a.stack[i] != b.stack[i])
+	  return "stack[" + number(i) + "] " + hex(a.stack[i]) + " != " + hex(b.stack[i]);
+  }
+  if (a.keyboard != b.keyboard)
+	return "keys " + hex(a.keyboard) + " != " + hex(b.keyboard);
+  if (cpu_a.waiting_for_key() != cpu_b.waiting_for_key())
+	return "waiting for key " + flag(cpu_a.waiting_for_key()) + " != " + flag(cpu_b.waiting_for_key());
+  if (a.halted != b.halted)
+	return "exited " + flag(a.halted) + " != " + flag(b.halted);
+  if (a.rng != b.rng)
+	return "rng " + std::to_string(a.rng) + " != " + std::to_string(b.rng);
+  for (unsigned int address = 0; address < a.memory.size() && address < b.memory.size(); address++) {
+	if (a.memory[address] != b.memory[address])
+	  return "memory at " + hex(address) + " " + number(a.memory[address]) + " != " + number(b.memory[address]);
+  }
+  if (a.memory.size() != b.memory.size())
+	return "memory size " + std::to_string(a.memory.size()) + " != " + std::to_string(b.memory.size());
+  if (a.plane_mask != b.plane_mask)
+	return "planes " + number(a.plane_mask) + " != " + number(b.plane_mask);
+  if (a.high_resolution != b.high_resolution || a.planes != b.planes)
+	return "display";
+  if (a.has_pattern != b.has_pattern || a.pattern != b.pattern)
+	return "audio pattern";
+  if (a.pitch != b.pitch)
+	return "pitch " + number(a.pitch) + " != " + number(b.pitch);
+  return "";
+}
+
+/**
+ * \brief Runs rom on both engines and reports the first divergence.
+ *
+ * State is compared every `every` cycles. After a mismatch both cpus are restored from the last matching snapshot and
+ * run again comparing after every cycle to find the exact cycle of divergence.
+ *
+ * @return true when engines never diverged
+ */
+bool check_rom(const std::string &name, const RomConf &config, std::uint64_t cycles, std::uint64_t every) {
+  std::ifstream rom_file(config.rom_location, std::ifstream::binary);
+  if (!rom_file.is_open())
+	throw std::runtime_error("unable to open rom file at: " + config.rom_location);
+  std::vector<unsigned char> rom(std::istreambuf_iterator<char>(rom_file), {});
+
+  Lockstep lockstep;
+  for (Chip8::CPU *cpu : {&lockstep.reference, &lockstep.candidate}) {
+	cpu->set_quirks(config.load_store_quirk, config.shift_quirk, config.wrapping);
+	cpu->set_schip(config.schip);
+	cpu->set_xo_chip(config.xo_chip);
+	cpu->seed_random(RANDOM_SEED);
+	cpu->load_rom(rom);
+  }
+
+  Chip8::CPU reference_snapshot = lockstep.reference;
+  Chip8::CPU candidate_snapshot = lockstep.candidate;
+  std::uint64_t snapshot_cycle = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  std::uint64_t cycle = 0;
+  std::string difference;
+
+  for (; cycle < cycles && !lockstep.faulted(); cycle++) {
+	lockstep.step(cycle);
+
+	bool last = cycle + 1 == cycles || lockstep.faulted();
+	if ((cycle + 1) % every != 0 && !last)
+	  continue;
+
+	difference = compare(lockstep.reference, lockstep.candidate);
+	if (difference.empty() && lockstep.reference_error == lockstep.candidate_error) {
+	  reference_snapshot = lockstep.reference;
+	  candidate_snapshot = lockstep.candidate;
+	  snapshot_cycle = cycle + 1;
+	  continue;
+	}
+
+	// find exact cycle of the divergence
+	lockstep.reference = reference_snapshot;
+	lockstep.candidate = candidate_snapshot;
+	lockstep.reference_error.clear();
+	lockstep.candidate_error.clear();
+	unsigned short pc = 0;
+	for (cycle = snapshot_cycle;; cycle++) {
+	  pc = lockstep.reference.pc();
+	  lockstep.step(cycle);
+	  difference = compare(lockstep.reference, lockstep.candidate);
+	  if (!difference.empty() || lockstep.reference_error != lockstep.candidate_error)
+		break;
+	}
+
+	std::cout << name << ": DIVERGED at cycle " << cycle << std::endl;
+	if (!difference.empty())
+	  std::cout << "  state: " << difference << std::endl;
+	if (lockstep.reference_error != lockstep.candidate_error)
+	  std::cout << "  errors: \"" << lockstep.reference_error << "\" != \"" << lockstep.candidate_error << "\""
+				<< std::endl;
+	std::cout << "  reference before the cycle:" << std::endl;
+	for (const auto &line : Chip8::disassemble_window(reference_snapshot, pc))
+	  std::cout << "    " << line << std::endl;
+	return false;
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << name << ": ok, " << cycle << " cycles in lockstep, " << static_cast<double>(cycle) / elapsed.count()
+			<< " cycles/s";
+  if (!lockstep.reference_error.empty())
+	std::cout << ", both faulted with \"" << lockstep.reference_error << "\"";
+  std::cout << std::endl;
+  return true;
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> [--cycles N] [--every N] [ROM_NAME...]" << std::endl;
+	std::cout << "runs roms from RESOURCES_DIR/roms.json on reference cpu and predecoded engine in lockstep"
+			  << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::uint64_t cycles = 1000000;
+  std::uint64_t every = 1000;
+  std::vector<std::string> names;
+
+  for (int i = 2; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--cycles" && i + 1 < argc)
+	  cycles = std::stoull(argv[++i]);
+	else if (option == "--every" && i + 1 < argc)
+	  every = std::max<std::uint64_t>(1, std::stoull(argv[++i]));
+	else
+	  names.push_back(option);
+  }
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+
+	if (names.empty()) {
+	  for (const auto &item : roms.items())
+		names.push_back(item.key());
+	}
+
+	bool all_matched = true;
+	for (const auto &name : names) {
+	  if (!roms.contains(name))
+		throw std::runtime_error("unknown rom " + name);
+	  all_matched &= check_rom(name, RomConf(roms[name], resources_path), cycles, every);
+	}
+	return all_matched ? 0 : 1;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <json.hpp>
+#include "session_executor.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+struct HostConf {
+  RomConf rom;
+  std::size_t sessions;
+  unsigned int frames;
+  unsigned int press_period; // average number of frames between key presses of a session
+};
+
+struct HostResult {
+  double seconds = 0.0;
+  std::uint64_t emulated = 0;
+  std::uint64_t skipped = 0;
+};
+
+// presses a random key for one frame, same sequence in both modes
+template<typename Press>
+void script_input(std::mt19937 &random, const HostConf &conf, std::vector<int> &held, Press press) {
+  for (std::size_t id = 0; id < held.size(); id++) {
+	if (held[id] >= 0) {
+	  press(id, static_cast<unsigned int>(held[id]), false);
+	  held[id] = -1;
+	} else if (random() % conf.press_period == 0) {
+	  held[id] = static_cast<int>(random() % Chip8::KEYBOARD_SIZE);
+	  press(id, static_cast<unsigned int>(held[id]), true);
+	}
+  }
+}
+
+HostResult host_sessions(const HostConf &conf, unsigned int seed) {
+  SessionExecutor executor;
+  for (std::size_t i = 0; i < conf.sessions; i++)
+	executor.spawn(conf.rom, static_cast<std::uint32_t>(seed + i));
+
+  std::mt19937 random(seed);
+  std::vector<int> held(conf.sessions, -1);
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int frame = 0; frame < conf.frames; frame++) {
+	script_input(random, conf, held, [&](std::size_t id, unsigned int key, bool value) {
+	  executor.set_key(id, key, value);
+	});
+	executor.tick();
+  }
+
+  HostResult result;
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.emulated = executor.emulated_frames();
+  result.skipped = executor.skipped_frames();
+  return result;
+}
+
+HostResult run_emulators(const HostConf &conf, unsigned int seed) {
+  std::vector<Emulator> emulators(conf.sessions);
+  for (std::size_t i = 0; i < conf.sessions; i++)
+	emulators[i].load_config(conf.rom, static_cast<std::uint32_t>(seed + i));
+
+  std::mt19937 random(seed);
+  std::vector<int> held(conf.sessions, -1);
+  const std::chrono::duration<double> frame_duration(Chip8::TIMER_PERIOD);
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int frame = 0; frame < conf.frames; frame++) {
+	script_input(random, conf, held, [&](std::size_t id, unsigned int key, bool value) {
+	  emulators[id].set_key(key, value);
+	});
+	for (auto &emulator : emulators)
+	  emulator.run(frame_duration, Emulator::Clock::time_point{});
+  }
+
+  HostResult result;
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.emulated = static_cast<std::uint64_t>(conf.sessions) * conf.frames;
+  return result;
+}
+
+// one executor or set of emulators per thread, returns slowest thread's time
+template<typename Run>
+HostResult run_threads(const HostConf &conf, unsigned int threads, Run run) {
+  std::vector<HostResult> results(threads);
+  std::vector<std::thread> workers;
+  for (unsigned int t = 0; t < threads; t++)
+	workers.emplace_back([&, t]() { results[t] = run(conf, 1000 * t + 1); });
+  for (auto &worker : workers)
+	worker.join();
+
+  HostResult total;
+  for (const auto &result : results) {
+	total.seconds = std::max(total.seconds, result.seconds);
+	total.emulated += result.emulated;
+	total.skipped += result.skipped;
+  }
+  return total;
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <ROM_NAME> [--sessions N] [--frames N] [--threads N] "
+			  << "[--press-period N]" << std::endl;
+	std::cout << "hosts N sessions per thread with random key presses, with coroutine executor and frame by frame"
+			  << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::string name = argv[2];
+  HostConf conf{RomConf(), 2000, 600, 120};
+  unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (int i = 3; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--sessions" && i + 1 < argc)
+	  conf.sessions = std::stoul(argv[++i]);
+	else if (option == "--frames" && i + 1 < argc)
+	  conf.frames = std::stoul(argv[++i]);
+	else if (option == "--threads" && i + 1 < argc)
+	  threads = std::max(1ul, std::stoul(argv[++i]));
+	else if (option == "--press-period" && i + 1 < argc)
+	  conf.press_period = std::max(1ul, std::stoul(argv[++i]));
+  }
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (!roms.contains(name))
+	  throw std::runtime_error("unknown rom " + name);
+	conf.rom = RomConf(roms[name], resources_path);
+
+	double session_frames = static_cast<double>(conf.sessions) * conf.frames * threads;
+	std::cout << name << ": " << conf.sessions << " sessions on each of " << threads << " threads, " << conf.frames
+			  << " frames" << std::endl;
+
+	HostResult plain = run_threads(conf, threads, run_emulators);
+	std::cout << "frame by frame: " << session_frames / plain.seconds << " session frames/s" << std::endl;
+
+	HostResult hosted = run_threads(conf, threads, host_sessions);
+	std::cout << "coroutines: " << session_frames / hosted.seconds << " session frames/s, "
+			  << 100.0 * static_cast<double>(hosted.emulated) / session_frames << "% of frames emulated" << std::endl;
+  } catch (const std::runtime_error &error) {
+	std::cerr << error.what() << std::endl;
+	return 1;
+  }
+
+  return 0;
+}
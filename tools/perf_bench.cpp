@@ -0,0 +1,118 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "conf.hpp"
+#include "cpu.hpp"
+#include "perf_counters.hpp"
+#include "predecoded.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+const std::uint32_t RANDOM_SEED = 0xC8C8C8C8;
+const unsigned int KEY_FRAMES = 7; // frames between key changes, same input as chip8_aot_<ROM_NAME>
+
+std::uint16_t keys_at(std::uint64_t frame) {
+  std::uint64_t hash = (frame / KEY_FRAMES + 1) * 0x9E3779B97F4A7C15u;
+  return static_cast<std::uint16_t>(1u << ((hash >> 32u) & 0xFu));
+}
+
+/**
+ * \brief Runs cpu for given number of instructions with one engine.
+ *
+ * Timers are updated and keys changed every frame worth of cycles, so roms get past their title screens.
+ *
+ * @return number of instructions executed before the end or the first error
+ */
+template<typename Cycle>
+std::uint64_t run(Chip8::CPU &cpu, const RomConf &rom, std::uint64_t instructions, Cycle cycle) {
+  double cycles_per_frame = Chip8::TIMER_PERIOD / rom.emulation_period;
+  std::uint64_t executed = 0;
+  try {
+	for (std::uint64_t frame = 0; executed < instructions; frame++) {
+	  auto end = static_cast<std::uint64_t>(std::floor(static_cast<double>(frame + 1) * cycles_per_frame));
+	  cpu.set_keys(keys_at(frame));
+	  for (; executed < end && executed < instructions; executed++)
+		cycle();
+	  cpu.update_timers();
+	}
+  } catch (const std::runtime_error &) {}
+  return executed;
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> [ROM_NAME...] [--instructions N]" << std::endl;
+	std::cout << "runs every rom in roms.json (or given ones) with each engine and prints hardware counters per "
+			  << "emulated instruction" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::vector<std::string> names;
+  std::uint64_t instructions = 20000000;
+
+  for (int i = 2; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--instructions" && i + 1 < argc)
+	  instructions = std::stoull(argv[++i]);
+	else
+	  names.push_back(option);
+  }
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (names.empty()) {
+	  for (const auto &rom : roms.items())
+		names.push_back(rom.key());
+	}
+
+	PerfCounters counters;
+	if (!counters.available())
+	  std::cerr << "hardware counters unavailable (" << counters.error() << "), printing only speed" << std::endl;
+	print_perf_header(std::cout);
+
+	for (const auto &name : names) {
+	  if (!roms.contains(name))
+		throw std::runtime_error("unknown rom " + name);
+	  RomConf rom(roms[name], resources_path);
+	  std::ifstream file(rom.rom_location, std::ifstream::binary);
+	  if (!file.is_open())
+		throw std::runtime_error("unable to open rom file at: " + rom.rom_location);
+	  std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(file), {});
+
+	  Chip8::CPU initial(rom.load_store_quirk, rom.shift_quirk, rom.wrapping);
+	  initial.set_schip(rom.schip);
+	  initial.set_xo_chip(rom.xo_chip);
+	  initial.load_rom(buffer);
+	  initial.seed_random(RANDOM_SEED);
+
+	  Chip8::CPU interpreted = initial;
+	  counters.start();
+	  auto executed = run(interpreted, rom, instructions, [&]() { interpreted.cycle(); });
+	  print_perf_row(std::cout, name, "interpreter", counters.stop(), executed);
+
+	  Chip8::CPU predecoded = initial;
+	  Chip8::PredecodedEngine engine(predecoded);
+	  counters.start();
+	  executed = run(predecoded, rom, instructions, [&]() { engine.cycle(); });
+	  print_perf_row(std::cout, name, "predecoded", counters.stop(), executed);
+	}
+  } catch (const std::runtime_error &error) {
+	std::cerr << error.what() << std::endl;
+	return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "conf.hpp"
+#include "instance_pool.hpp"
+
+using json = nlohmann::json;
+
+namespace {
+// runs cpu for a while like a short episode, faults end it early
+void run_episode(Chip8::CPU &cpu, std::uint32_t seed, unsigned int cycles) {
+  cpu.seed_random(seed);
+  try {
+	for (unsigned int i = 0; i < cycles; i++)
+	  cpu.cycle();
+  } catch (const std::runtime_error &) {}
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <ROM_NAME> [--instances N] [--rounds N] [--cycles N] "
+			  << "[--numa NODE] [--no-huge-pages]" << std::endl;
+	std::cout << "creates and destroys short lived cpus, once on the heap and once in instance pool" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::string name = argv[2];
+  std::size_t instances = 4096;
+  unsigned int rounds = 20;
+  unsigned int cycles = 100;
+  InstancePoolConf pool_conf;
+
+  for (int i = 3; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--instances" && i + 1 < argc)
+	  instances = std::stoul(argv[++i]);
+	else if (option == "--rounds" && i + 1 < argc)
+	  rounds = std::stoul(argv[++i]);
+	else if (option == "--cycles" && i + 1 < argc)
+	  cycles = std::stoul(argv[++i]);
+	else if (option == "--numa" && i + 1 < argc)
+	  pool_conf.numa_node = std::stoi(argv[++i]);
+	else if (option == "--no-huge-pages")
+	  pool_conf.huge_pages = false;
+  }
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (!roms.contains(name))
+	  throw std::runtime_error("unknown rom " + name);
+	RomConf rom(roms[name], resources_path);
+
+	std::ifstream file(rom.rom_location, std::ifstream::binary);
+	if (!file.is_open())
+	  throw std::runtime_error("unable to open rom file at: " + rom.rom_location);
+	std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(file), {});
+	auto image = Chip8::MemoryImage::create(buffer.data(), buffer.size());
+
+	using Clock = std::chrono::steady_clock;
+	std::vector<std::unique_ptr<Chip8::CPU>> heap(instances);
+	auto start = Clock::now();
+	for (unsigned int round = 0; round < rounds; round++) {
+	  for (std::size_t i = 0; i < instances; i++) {
+		heap[i] = std::make_unique<Chip8::CPU>(image, rom.load_store_quirk, rom.shift_quirk, rom.wrapping);
+		heap[i]->set_schip(rom.schip);
+		run_episode(*heap[i], static_cast<std::uint32_t>(i + 1), cycles);
+	  }
+	  for (auto &cpu : heap)
+		cpu.reset();
+	}
+	std::chrono::duration<double> heap_time = Clock::now() - start;
+
+	InstancePool pool(instances, image, rom, pool_conf);
+	std::vector<Chip8::CPU *> acquired(instances);
+	start = Clock::now();
+	for (unsigned int round = 0; round < rounds; round++) {
+	  for (std::size_t i = 0; i < instances; i++) {
+		acquired[i] = &pool.acquire();
+		run_episode(*acquired[i], static_cast<std::uint32_t>(i + 1), cycles);
+	  }
+	  for (auto *cpu : acquired)
+		pool.release(*cpu);
+	}
+	std::chrono::duration<double> pool_time = Clock::now() - start;
+
+	double episodes = static_cast<double>(instances) * rounds;
+	std::cout << name << ": " << instances << " instances, " << sizeof(Chip8::CPU) << " bytes each" << std::endl;
+	std::cout << "heap: " << episodes / heap_time.count() << " episodes/s" << std::endl;
+	std::cout << "pool: " << episodes / pool_time.count() << " episodes/s, " << pool.memory_size() / 1024
+			  << " KB arena in " << pool.page_backing() << std::endl;
+  } catch (const std::runtime_error &error) {
+	std::cerr << error.what() << std::endl;
+	return 1;
+  }
+
+  return 0;
+}
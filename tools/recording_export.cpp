@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "frame_recorder.hpp"
+#include "upscaler.hpp"
+
+namespace {
+const unsigned int GIF_MIN_CODE_SIZE = 2; // palette has a color for every combination of planes
+const unsigned int GIF_MAX_CODE = 4095;
+const unsigned int N_COLORS = 1u << Chip8::N_PLANES;
+
+/**
+ * \brief Expands frame into one color index per pixel at 128x64 times scale, scaled by nearest neighbour.
+ *
+ * Low resolution frames are doubled, so that the output size doesn't change when the rom switches resolution.
+ */
+void expand(const RecordedFrame &frame, unsigned int scale, std::vector<unsigned char> &pixels) {
+  unsigned int width = Chip8::HIRES_WIDTH * scale;
+  unsigned int pixel_size = recorded_hires(frame) ? scale : 2 * scale;
+  pixels.resize(static_cast<std::size_t>(width) * Chip8::HIRES_HEIGHT * scale);
+
+  for (unsigned int y = 0; y < Chip8::HIRES_HEIGHT * scale; y++) {
+	for (unsigned int x = 0; x < width; x++) {
+	  auto color = recorded_color(frame, x / pixel_size, y / pixel_size);
+	  pixels[static_cast<std::size_t>(y) * width + x] = static_cast<unsigned char>(color);
+	}
+  }
+}
+
+void write_u16(std::ostream &out, unsigned int value) {
+  out.put(static_cast<char>(value & 0xFFu));
+  out.put(static_cast<char>((value >> 8u) & 0xFFu));
+}
+
+/**
+ * \brief Writes variable length codes in GIF's data sub-blocks.
+ */
+class GifCodeWriter {
+  std::ostream &out;
+  std::array<char, 255> block{};
+  std::size_t size = 0;
+  std::uint32_t bits = 0;
+  unsigned int n_bits = 0;
+
+  void put(unsigned char byte) {
+	block[size++] = static_cast<char>(byte);
+	if (size == block.size())
+	  flush_block();
+  }
+
+  void flush_block() {
+	if (size == 0)
+	  return;
+	out.put(static_cast<char>(size));
+	out.write(block.data(), static_cast<std::streamsize>(size));
+	size = 0;
+  }
+
+public:
+  explicit GifCodeWriter(std::ostream &out) : out(out) {}
+
+  void write(unsigned int code, unsigned int code_size) {
+	bits |= static_cast<std::uint32_t>(code) << n_bits;
+	n_bits += code_size;
+	while (n_bits >= 8) {
+	  put(static_cast<unsigned char>(bits & 0xFFu));
+	  bits >>= 8u;
+	  n_bits -= 8;
+	}
+  }
+
+  void finish() {
+	if (n_bits > 0)
+	  put(static_cast<unsigned char>(bits & 0xFFu));
+	bits = 0;
+	n_bits = 0;
+	flush_block();
+	out.put(0); // block terminator
+  }
+};
+
+/**
+ * \brief Compresses image of color indices 0 and 1 with GIF's LZW variant.
+ */
+void write_lzw(std::ostream &out, const std::vector<unsigned char> &pixels) {
+  const unsigned int clear = 1u << GIF_MIN_CODE_SIZE;
+  const unsigned int end = clear + 1;
+
+  // children[code][index] is the code of string code + index, 0 when not present
+  std::vector<std::array<std::uint16_t, N_COLORS>> children(GIF_MAX_CODE + 1);
+  unsigned int code_size = GIF_MIN_CODE_SIZE + 1;
+  unsigned int max_code = end;
+
+  out.put(static_cast<char>(GIF_MIN_CODE_SIZE));
+  GifCodeWriter writer(out);
+  writer.write(clear, code_size);
+
+  unsigned int current = pixels.front();
+  for (std::size_t i = 1; i < pixels.size(); i++) {
+	unsigned char index = pixels[i];
+	if (children[current][index]) {
+	  current = children[current][index];
+	  continue;
+	}
+
+	writer.write(current, code_size);
+	children[current][index] = static_cast<std::uint16_t>(++max_code);
+	if (max_code >= (1u << code_size))
+	  code_size++;
+	if (max_code == GIF_MAX_CODE) {
+	  writer.write(clear, code_size);
+	  std::fill(children.begin(), children.end(), std::array<std::uint16_t, N_COLORS>{});
+	  code_size = GIF_MIN_CODE_SIZE + 1;
+	  max_code = end;
+	}
+	current = index;
+  }
+
+  writer.write(current, code_size);
+  writer.write(end, code_size);
+  writer.finish();
+}
+
+void write_gif_frame(std::ostream &out, const RecordedFrame &frame, unsigned int scale, unsigned int delay) {
+  std::vector<unsigned char> pixels;
+  expand(frame, scale, pixels);
+
+  // graphic control extension with frame delay in 1/100 s
+  out.put(0x21);
+  out.put(static_cast<char>(0xF9));
+  out.put(4);
+  out.put(0);
+  write_u16(out, delay);
+  out.put(0);
+  out.put(0);
+
+  out.put(0x2C);
+  write_u16(out, 0);
+  write_u16(out, 0);
+  write_u16(out, Chip8::HIRES_WIDTH * scale);
+  write_u16(out, Chip8::HIRES_HEIGHT * scale);
+  out.put(0); // no local palette, not interlaced
+  write_lzw(out, pixels);
+}
+
+std::uint64_t export_gif(RecordingReader &reader, std::ostream &out, unsigned int scale) {
+  out.write("GIF89a", 6);
+  write_u16(out, Chip8::HIRES_WIDTH * scale);
+  write_u16(out, Chip8::HIRES_HEIGHT * scale);
+  out.put(static_cast<char>(0x81)); // global palette of four colors
+  out.put(0);
+  out.put(0);
+  for (auto color : UPSCALE_PALETTE) {
+	out.put(static_cast<char>((color >> 16u) & 0xFFu));
+	out.put(static_cast<char>((color >> 8u) & 0xFFu));
+	out.put(static_cast<char>(color & 0xFFu));
+  }
+
+  // loop forever
+  out.put(0x21);
+  out.put(static_cast<char>(0xFF));
+  out.put(11);
+  out.write("NETSCAPE2.0", 11);
+  out.put(3);
+  out.put(1);
+  write_u16(out, 0);
+  out.put(0);
+
+  // unchanged frames are merged into the previous one, delays are rounded so that their sum follows frame rate
+  std::uint64_t frames = 0;
+  std::uint64_t shown_since = 0;
+  std::uint64_t delay_written = 0;
+  RecordedFrame shown{};
+  bool pending = false;
+
+  auto flush = [&](std::uint64_t until) {
+	std::uint64_t delay = until * 100 / reader.rate() - delay_written;
+	write_gif_frame(out, shown, scale, static_cast<unsigned int>(std::min<std::uint64_t>(delay, 0xFFFF)));
+	delay_written += delay;
+  };
+
+  while (reader.next()) {
+	if (!pending || reader.frame() != shown) {
+	  if (pending)
+		flush(frames);
+	  shown = reader.frame();
+	  shown_since = frames;
+	  pending = true;
+	}
+	frames++;
+  }
+  if (pending && frames > shown_since)
+	flush(frames);
+
+  out.put(0x3B);
+  return frames;
+}
+
+std::uint64_t export_y4m(RecordingReader &reader, std::ostream &out, unsigned int scale) {
+  out << "YUV4MPEG2 W" << Chip8::HIRES_WIDTH * scale << " H" << Chip8::HIRES_HEIGHT * scale << " F"
+	  << reader.rate() << ":1 Ip A1:1 Cmono\n";
+
+  std::uint64_t frames = 0;
+  std::vector<unsigned char> pixels;
+  while (reader.next()) {
+	expand(reader.frame(), scale, pixels);
+	for (auto &pixel : pixels)
+	  pixel = static_cast<unsigned char>(UPSCALE_PALETTE[pixel] & 0xFFu); // palette is gray
+	out << "FRAME\n";
+	out.write(reinterpret_cast<const char *>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+	frames++;
+  }
+  return frames;
+}
+
+bool ends_with(const std::string &text, const std::string &suffix) {
+  return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RECORDING> <OUTPUT.y4m|OUTPUT.gif> [--scale N]" << std::endl;
+	std::cout << "exports recording made with --capture into a video or an animated image" << std::endl;
+	return 0;
+  }
+
+  std::string output_path = argv[2];
+  unsigned int scale = 1;
+  if (argc > 4 && std::string(argv[3]) == "--scale")
+	scale = std::max(1ul, std::stoul(argv[4]));
+
+  try {
+	RecordingReader reader(argv[1]);
+	std::ofstream output(output_path, std::ofstream::binary);
+	if (!output.is_open())
+	  throw std::runtime_error("unable to create " + output_path);
+
+	std::uint64_t frames;
+	if (ends_with(output_path, ".gif"))
+	  frames = export_gif(reader, output, scale);
+	else if (ends_with(output_path, ".y4m"))
+	  frames = export_y4m(reader, output, scale);
+	else
+	  throw std::runtime_error("unknown output format of " + output_path);
+
+	std::cout << "exported " << frames << " frames" << std::endl;
+	return 0;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
@@ -0,0 +1,46 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <json.hpp>
+#include "rom_pack.hpp"
+
+using json = nlohmann::json;
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <OUTPUT>" << std::endl;
+	std::cout << "packs every rom listed in RESOURCES_DIR/roms.json into a single rom pack file" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms_json;
+	roms_file >> roms_json;
+
+	std::vector<RomPackSource> roms;
+	for (const auto &item : roms_json.items()) {
+	  RomPackSource source{item.key(), item.value().at("location"), item.value().value("snapshot", ""),
+						   RomConf(item.value(), resources_path), {}};
+
+	  std::ifstream rom(source.config.rom_location, std::ifstream::binary);
+	  if (!rom.is_open())
+		throw std::runtime_error("unable to open rom file at: " + source.config.rom_location);
+	  source.rom.assign(std::istreambuf_iterator<char>(rom), {});
+
+	  roms.push_back(std::move(source));
+	}
+
+	write_rom_pack(argv[2], std::move(roms));
+	std::cout << "packed " << roms_json.size() << " roms into " << argv[2] << std::endl;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "frame_export.hpp"
+
+namespace {
+const char COLOR_CHARS[] = " #+*"; // character for each XO-CHIP color index
+
+void print_frame(const FrameSnapshot &snapshot) {
+  std::string text;
+  for (unsigned int y = 0; y < snapshot.height(); y++) {
+	for (unsigned int x = 0; x < snapshot.width(); x++)
+	  text += COLOR_CHARS[snapshot.color(x, y)];
+	text += '\n';
+  }
+  std::cout << "frame " << snapshot.frame << (snapshot.sound ? " sound on" : "") << '\n' << text << std::flush;
+}
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+	std::cout << "usage: " << argv[0] << " <SEGMENT_NAME> [--once]" << std::endl;
+	std::cout << "prints frames exported by chip8_emu_cpp --export-shm" << std::endl;
+	return 0;
+  }
+
+  bool once = argc > 2 && std::string(argv[2]) == "--once";
+
+  try {
+	FrameReader reader(argv[1]);
+	FrameSnapshot snapshot;
+	std::uint64_t shown = 0;
+
+	while (true) {
+	  if (reader.read(snapshot) && snapshot.frame != shown) {
+		if (!once)
+		  std::cout << "\x1b[H\x1b[2J";
+		print_frame(snapshot);
+		shown = snapshot.frame;
+		if (once)
+		  return 0;
+	  }
+	  std::this_thread::sleep_for(std::chrono::milliseconds(16));
+	}
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
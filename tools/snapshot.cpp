@@ -0,0 +1,77 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <json.hpp>
+#include "emulator.hpp"
+#include "movie.hpp"
+
+using json = nlohmann::json;
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <ROM_NAME> [--frames N | --movie MOVIE] [--out FILE]"
+			  << std::endl;
+	std::cout << "boots ROM_NAME for N frames without input, or replays MOVIE recorded from boot, and saves warm start "
+				 "snapshot, by default into RESOURCES_DIR/snapshots/ROM_NAME.c8s" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::string name = argv[2];
+  std::filesystem::path relative_out = std::filesystem::path("snapshots") / (name + ".c8s");
+  std::filesystem::path out_path;
+  std::string movie_path;
+  unsigned int frames = 180;
+
+  for (int i = 3; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--frames" && i + 1 < argc)
+	  frames = std::stoul(argv[++i]);
+	else if (option == "--movie" && i + 1 < argc)
+	  movie_path = argv[++i];
+	else if (option == "--out" && i + 1 < argc)
+	  out_path = argv[++i];
+  }
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (!roms.contains(name))
+	  throw std::runtime_error("unknown rom " + name);
+	RomConf config(roms[name], resources_path);
+
+	Emulator emulator;
+	if (movie_path.empty()) {
+	  emulator.load_config(config);
+	  emulator.run_until(static_cast<std::uint64_t>(frames * Chip8::TIMER_PERIOD / config.emulation_period));
+	} else {
+	  Movie movie = Movie::load(movie_path, resources_path);
+	  emulator.load_config(config, movie.seed);
+	  for (const auto &event : movie.events) {
+		emulator.run_until(event.cycle);
+		emulator.set_key(event.key, event.value);
+	  }
+	  emulator.run_until(movie.length);
+	}
+
+	if (out_path.empty()) {
+	  out_path = resources_path / relative_out;
+	  std::filesystem::create_directories(out_path.parent_path());
+	}
+	emulator.snapshot().save(out_path.string());
+
+	double skipped = static_cast<double>(emulator.cycle_count()) * config.emulation_period;
+	std::cout << "saved " << name << " after " << emulator.cycle_count() << " cycles (" << skipped << " s) into "
+			  << out_path.string() << std::endl;
+	if (roms[name].value("snapshot", "") != relative_out.string())
+	  std::cout << "to start from it add \"snapshot\": \"" << relative_out.string() << "\" to " << name
+				<< " in roms.json" << std::endl;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
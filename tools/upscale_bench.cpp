@@ -0,0 +1,73 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "emulator.hpp"
+#include "upscaler.hpp"
+
+using json = nlohmann::json;
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <ROM_NAME> [--size WxH] [--frames N] [--portable]"
+			  << std::endl;
+	std::cout << "runs ROM_NAME for a while and prints time each upscale filter takes per frame" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::string name = argv[2];
+  unsigned int width = 1280, height = 640;
+  unsigned int frames = 1000;
+  bool simd = true;
+
+  for (int i = 3; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--size" && i + 1 < argc) {
+	  std::string size = argv[++i];
+	  width = std::stoul(size);
+	  height = std::stoul(size.substr(size.find('x') + 1));
+	} else if (option == "--frames" && i + 1 < argc) {
+	  frames = std::stoul(argv[++i]);
+	} else if (option == "--portable") {
+	  simd = false;
+	}
+  }
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (!roms.contains(name))
+	  throw std::runtime_error("unknown rom " + name);
+
+	Emulator emulator;
+	emulator.load_config(RomConf(roms[name], resources_path));
+	auto now = Emulator::Clock::now();
+	for (int frame = 0; frame < 300; frame++) // get past the title screen
+	  emulator.run(std::chrono::duration<double>(1.0 / 60), now);
+
+	std::vector<std::uint32_t> pixels(static_cast<std::size_t>(width) * height);
+	for (const char *filter_name : {"nearest", "scale2x", "scale3x"}) {
+	  Upscaler upscaler(parse_upscale_filter(filter_name), width, height, simd);
+	  upscaler.render(emulator.cpu, pixels.data(), width * sizeof(std::uint32_t)); // prepares buffers
+
+	  auto start = std::chrono::steady_clock::now();
+	  for (unsigned int frame = 0; frame < frames; frame++)
+		upscaler.render(emulator.cpu, pixels.data(), width * sizeof(std::uint32_t));
+	  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+	  std::cout << name << " " << filter_name << " " << width << "x" << height << " (" << upscaler.instruction_set()
+				<< "): " << elapsed.count() / frames << " us/frame" << std::endl;
+	}
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}
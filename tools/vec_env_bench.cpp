@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <json.hpp>
+#include "vec_env.hpp"
+
+using json = nlohmann::json;
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+	std::cout << "usage: " << argv[0] << " <RESOURCES_DIR> <ROM_NAME> [--envs N] [--steps N] [--threads N] [--bytes]"
+			  << std::endl;
+	std::cout << "steps ROM_NAME in N environments with random actions and prints throughput" << std::endl;
+	return 0;
+  }
+
+  std::filesystem::path resources_path = argv[1];
+  std::string name = argv[2];
+  std::size_t envs = 64;
+  unsigned int steps = 1000;
+  VecEnvConf conf;
+  // no-op plus single keys, enough to move in most games
+  conf.actions = {0};
+  for (unsigned int key = 0; key < Chip8::KEYBOARD_SIZE; key++)
+	conf.actions.push_back(action_mask({key}));
+
+  for (int i = 3; i < argc; i++) {
+	std::string option = argv[i];
+	if (option == "--envs" && i + 1 < argc)
+	  envs = std::stoul(argv[++i]);
+	else if (option == "--steps" && i + 1 < argc)
+	  steps = std::stoul(argv[++i]);
+	else if (option == "--threads" && i + 1 < argc)
+	  conf.threads = std::stoul(argv[++i]);
+	else if (option == "--bytes")
+	  conf.format = ObservationFormat::BYTES;
+  }
+
+  try {
+	std::ifstream roms_file(resources_path / "roms.json");
+	if (!roms_file.is_open())
+	  throw std::runtime_error("unable to open roms.json in " + resources_path.string());
+	json roms;
+	roms_file >> roms;
+	if (!roms.contains(name))
+	  throw std::runtime_error("unknown rom " + name);
+	conf.rom = RomConf(roms[name], resources_path);
+
+	VecEnv env(conf, envs);
+	std::vector<unsigned char> observations(env.size() * env.observation_size());
+	std::vector<unsigned char> done(env.size());
+	std::vector<unsigned int> actions(env.size());
+	std::vector<std::uint32_t> seeds(env.size());
+	for (std::size_t i = 0; i < seeds.size(); i++)
+	  seeds[i] = static_cast<std::uint32_t>(i + 1);
+	env.reset(seeds.data(), observations.data());
+
+	std::uint32_t rng = 0xC8C8C8C8;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int step = 0; step < steps; step++) {
+	  for (auto &action : actions) {
+		rng ^= rng << 13u;
+		rng ^= rng >> 17u;
+		rng ^= rng << 5u;
+		action = rng % env.action_count();
+	  }
+	  env.step(actions.data(), observations.data(), done.data());
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::size_t faulted = 0;
+	for (auto d : done)
+	  faulted += d;
+	double total = static_cast<double>(steps) * static_cast<double>(env.size());
+	std::cout << name << ": " << total / elapsed.count() << " steps/s, "
+			  << total * conf.frame_skip / elapsed.count() << " frames/s, " << faulted << " faulted" << std::endl;
+	return 0;
+  } catch (const std::exception &e) {
+	std::cerr << e.what() << std::endl;
+	return 1;
+  }
+}